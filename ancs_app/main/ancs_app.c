@@ -8,8 +8,10 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_system.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "esp_bt.h"
 
 #include "esp_gap_ble_api.h"
@@ -21,8 +23,14 @@
 #include "esp_gatt_defs.h"
 #include "esp_gatt_common_api.h"
 #include "ble_ancs.h"
-#include "esp_timer.h"
+#include "ancs_protocol.h"
+#include "ancs_request_queue.h"
+#include "notification_store.h"
+#include "text_arena.h"
+#include "app_name_cache.h"
+#include "spsc_ring.h"
 #include "t_glass.h"
+#include "battery_measurement.h"
 
 #define BLE_ANCS_TAG "BLE_ANCS"
 #define EXAMPLE_DEVICE_NAME "T-Glass ANCS"
@@ -33,28 +41,77 @@
 #define INVALID_HANDLE 0
 
 static notification_callback_t user_callback = NULL;
-static NotificationAttributes notifications[MAX_NOTIFICATIONS];
+static notification_removed_callback_t user_removed_callback = NULL;
 
 static uint8_t adv_config_done = 0;
 static bool get_service = false;
 static esp_gattc_char_elem_t *char_elem_result = NULL;
 static esp_gattc_descr_elem_t *descr_elem_result = NULL;
-static void periodic_timer_callback(void *arg);
-esp_timer_handle_t periodic_timer;
-uint8_t notification_index = 0;
-
-const esp_timer_create_args_t periodic_timer_args = {
-    .callback = &periodic_timer_callback,
-    /* name is optional, but may help identify the timer when debugging */
-    .name = "periodic"};
 
-struct data_source_buffer
+// Reassembles Data Source responses as fragments arrive
+static ancs_stream_t data_stream;
+static NotificationAttributes *pending_notification = NULL; // Slot in the notification store being filled
+static notification_event_t pending_event;
+static bool pending_app = false;            // The response being parsed answers Get App Attributes
+static char pending_app_id[ANCS_APP_ID_MAX];
+static char pending_app_name[APP_NAME_LEN];
+
+// Attribute requests waiting for, or holding, a Control Point slot. Only the ANCS worker task touches the queue,
+// the UI hands its message requests over through fetch_ring.
+static ancs_request_queue_t request_queue;
+static void request_pending_attributes(void);
+static bool esp_get_app_attributes(const char *appidentifier, uint8_t num_attr, const uint8_t *p_app_attrs);
+
+// The BTC task only copies notify payloads into event_ring, parsing, the store and the UI run on the ANCS worker
+#define ANCS_EVENT_RING_SIZE        (8 * 1024)
+#define ANCS_STATS_INTERVAL_MS      10000
+#define ANCS_WORKER_WAKE_MS         1000    // Longest sleep of the worker, in-flight request timeouts are checked this often
+
+typedef enum
 {
-    uint8_t buffer[1024];
-    uint16_t len;
-};
-
-static struct data_source_buffer data_buffer = {0};
+    ANCS_EVENT_NOTIFICATION_SOURCE = 0, // Raw Notification Source packet
+    ANCS_EVENT_DATA_SOURCE,             // Raw Data Source fragment
+    ANCS_EVENT_WRITE_RESULT,            // Control Point write finished, 1 byte esp_gatt_status_t
+    ANCS_EVENT_DISCONNECT,
+    ANCS_EVENT_BLE_STATUS,              // Pairing finished, 1 byte success flag
+    ANCS_EVENT_FETCH_MESSAGE,           // From the UI: NotificationUID (4 bytes LE), urgent flag (1 byte)
+} ancs_event_type_t;
+
+static _Alignas(SPSC_RING_ALIGN) uint8_t event_ring_buf[ANCS_EVENT_RING_SIZE];
+static spsc_ring_t event_ring;
+// Message requests of the UI, pushed with the LVGL lock held so there is one producer at a time.
+// The UI never waits for the worker or the BT stack.
+#define ANCS_FETCH_RING_SIZE        1024
+static _Alignas(SPSC_RING_ALIGN) uint8_t fetch_ring_buf[ANCS_FETCH_RING_SIZE];
+static spsc_ring_t fetch_ring;
+static TaskHandle_t worker_task = NULL;
+// Each side writes only its own counters, the other side and ancs_app_get_worker_stats() read them
+static struct
+{
+    _Atomic uint32_t events;
+    _Atomic uint32_t dropped;
+    _Atomic uint32_t max_depth;
+    _Atomic uint32_t max_ring_bytes;
+    _Atomic uint32_t avg_callback_us;
+    _Atomic uint32_t max_callback_us;
+} producer_stats;   // BTC task
+static uint64_t callback_total_us = 0;
+
+static struct
+{
+    _Atomic uint32_t events_done;
+    _Atomic uint32_t avg_latency_us;
+    _Atomic uint32_t max_latency_us;
+} worker_stats;     // ANCS worker task
+static uint64_t latency_total_us = 0;
+// Ring offset at which a disconnect that found the ring full belongs, handled once the worker reads up to it
+#define DISCONNECT_NONE UINT32_MAX
+static _Atomic uint32_t disconnect_lost_at = DISCONNECT_NONE;
+// Same for dropped events: the Data Source stream is reset where the first unhandled drop happened, and again
+// where the last one of the burst did. Fragments queued before the gap still belong to their response.
+#define STREAM_INTACT UINT32_MAX
+static _Atomic uint32_t stream_lost_at = STREAM_INTACT;
+static _Atomic uint32_t stream_lost_last = STREAM_INTACT;
 
 // In its basic form, the ANCS exposes three characteristics:
 //  service UUID: 7905F431-B5CE-4E99-A40F-4B1E122D00D0
@@ -147,182 +204,276 @@ static struct gattc_profile_inst gl_profile_tab[PROFILE_NUM] = {
     },
 };
 
-esp_noti_attr_list_t p_attr[8] = {
-    [attr_appidentifier_index] = {
-        .noti_attribute_id = NotificationAttributeIDAppIdentifier,
-        .attribute_len = 0,
-    },
-    [attr_title_index] = {
-        .noti_attribute_id = NotificationAttributeIDTitle,
-        .attribute_len = 0xFFFF,
-    },
-    [attr_subtitle_index] = {
-        .noti_attribute_id = NotificationAttributeIDSubtitle,
-        .attribute_len = 0xFFFF,
-    },
-    [attr_message_index] = {
-        .noti_attribute_id = NotificationAttributeIDMessage,
-        .attribute_len = 0xFFFF,
-    },
-    [attr_messagesize_index] = {
-        .noti_attribute_id = NotificationAttributeIDMessageSize,
-        .attribute_len = 0,
-    },
-    [attr_date_index] = {
-        .noti_attribute_id = NotificationAttributeIDDate,
-        .attribute_len = 0,
-    },
-    [attr_positiveactionlabel_index] = {
-        .noti_attribute_id = NotificationAttributeIDPositiveActionLabel,
-        .attribute_len = 0,
-    },
-    [attr_negativeactionlabel_index] = {
-        .noti_attribute_id = NotificationAttributeIDNegativeActionLabel,
-        .attribute_len = 0,
-    },
+// Attributes of the two fetch phases, the maximum lengths are set from the tile layout in ancs_app().
+// Every notification gets a header fetch, the message only once its tile is viewed.
+static ancs_attr_request_t header_attrs[] = {
+    {.id = NotificationAttributeIDAppIdentifier},
+    {.id = NotificationAttributeIDTitle},
+    {.id = NotificationAttributeIDDate},
+};
 
+static ancs_attr_request_t body_attrs[] = {
+    {.id = NotificationAttributeIDSubtitle},
+    {.id = NotificationAttributeIDMessage},
 };
 
-void esp_receive_apple_data_source_custom(uint8_t *message, uint16_t message_len)
+// Asked for once per app, the answer is cached in NVS
+static const uint8_t app_attrs[] = {AppAttributeIDDisplayName};
+
+static uint8_t data_source_begin(void *ctx, uint32_t NotificationUID)
 {
-    if (!message || message_len == 0)
+    ESP_LOGI(BLE_ANCS_TAG, "recevice Notification Attributes response NotificationUID %" PRIu32, NotificationUID);
+
+    // Responses come back in request order, the slot can take the next request right away
+    ancs_fetch_t fetch;
+    bool wanted = ancs_request_queue_complete(&request_queue, NotificationUID, &fetch);
+    request_pending_attributes();
+    pending_app = false;
+
+    uint8_t attr_count = (fetch == ANCS_FETCH_BODY) ? sizeof(body_attrs) / sizeof(body_attrs[0])
+                                                    : sizeof(header_attrs) / sizeof(header_attrs[0]);
+    if (!wanted)
     {
-        return;
+        // Not requested, or removed on the phone while the request was in flight; the response is still consumed
+        ESP_LOGW(BLE_ANCS_TAG, "Response for NotificationUID %" PRIu32 " ignored", NotificationUID);
+        pending_notification = NULL;
+        return attr_count;
     }
 
-    // Ignore notifications if index exceeds MAX_NOTIFICATIONS
-    if (notification_index >= MAX_NOTIFICATIONS)
+    notification_store_lock();
+    pending_notification = notification_store_find(NotificationUID);
+    if (fetch == ANCS_FETCH_BODY)
     {
-        ESP_LOGW(BLE_ANCS_TAG, "Notification ignored: MAX_NOTIFICATIONS reached.");
-        return;
+        // Dropped from the store while the message was on its way
+        pending_event = NOTIFICATION_MESSAGE;
+        notification_store_unlock();
+        return attr_count;
     }
 
-    uint8_t Command_id = message[0];
-    switch (Command_id)
+    // A modified notification is refreshed in place, its message is fetched again when viewed
+    if (pending_notification != NULL)
     {
-    case CommandIDGetNotificationAttributes:
+        notification_store_release_text(pending_notification);
+        pending_event = NOTIFICATION_MODIFIED;
+        notification_store_unlock();
+        return attr_count;
+    }
+
+    bool evicted;
+    uint32_t evicted_uid;
+    pending_notification = notification_store_insert(NotificationUID, &evicted, &evicted_uid);
+    pending_event = NOTIFICATION_ADDED;
+    notification_store_unlock();
+    if (evicted)
     {
-        uint32_t NotificationUID = (message[1]) | (message[2] << 8) | (message[3] << 16) | (message[4] << 24);
-        uint32_t remian_attr_len = message_len - 5;
-        uint8_t *attrs = &message[5];
+        ESP_LOGI(BLE_ANCS_TAG, "Store full, dropped oldest NotificationUID %" PRIu32, evicted_uid);
+        if (user_removed_callback != NULL)
+        {
+            user_removed_callback(evicted_uid);
+        }
+    }
+    return attr_count;
+}
 
-        ESP_LOGI(BLE_ANCS_TAG, "recevice Notification Attributes response Command_id %d NotificationUID %" PRIu32, Command_id, NotificationUID);
+static uint8_t data_source_app_begin(void *ctx, const char *app_id)
+{
+    ESP_LOGI(BLE_ANCS_TAG, "recevice App Attributes response %s", app_id);
 
-        // Get the current notification slot
-        NotificationAttributes *current_notification = &notifications[notification_index];
-        memset(current_notification, 0, sizeof(NotificationAttributes)); // Clear the slot
+    bool wanted = ancs_request_queue_complete_app(&request_queue, app_name_cache_key(app_id));
+    request_pending_attributes();
 
-        current_notification->NotificationUID = NotificationUID;
+    pending_notification = NULL;
+    pending_app = wanted;
+    strlcpy(pending_app_id, app_id, sizeof(pending_app_id));
+    pending_app_name[0] = '\0';
+    return sizeof(app_attrs);
+}
 
-        while (remian_attr_len > 0)
+static void data_source_attribute(void *ctx, const ancs_attribute_t *attr)
+{
+    if (pending_app)
+    {
+        if (attr->id == AppAttributeIDDisplayName)
         {
-            uint8_t AttributeID = attrs[0];
-            uint16_t len = attrs[1] | (attrs[2] << 8);
-            if (len > (remian_attr_len - 3))
-            {
-                ESP_LOGE(BLE_ANCS_TAG, "data error");
-                break;
-            }
+            ancs_copy_text(pending_app_name, sizeof(pending_app_name), attr->value, attr->len, true);
+        }
+        return;
+    }
 
-            switch (AttributeID)
-            {
-            case NotificationAttributeIDAppIdentifier:
-                strncpy(current_notification->Identifier, (char *)&attrs[3], len);
-                current_notification->Identifier[len] = '\0'; // Null-terminate
-                break;
-            case NotificationAttributeIDTitle:
-                strncpy(current_notification->Title, (char *)&attrs[3], len);
-                current_notification->Title[len] = '\0'; // Null-terminate
-                break;
-            case NotificationAttributeIDSubtitle:
-                strncpy(current_notification->Subtitle, (char *)&attrs[3], len);
-                current_notification->Subtitle[len] = '\0'; // Null-terminate
-                break;
-            case NotificationAttributeIDMessage:
-            {
-                char sanitized_message[len + 1];
-                int sanitized_len = 0;
+    NotificationAttributes *current_notification = pending_notification;
+    if (current_notification == NULL)
+    {
+        return;
+    }
 
-                for (int i = 0; i < len; i++)
-                {
-                    if (attrs[3 + i] == '\n')
-                    {
-                        sanitized_message[sanitized_len++] = ' '; // Replace newline with space
-                    }
-                    else
-                    {
-                        sanitized_message[sanitized_len++] = attrs[3 + i];
-                    }
-                }
-                sanitized_message[sanitized_len] = '\0'; // Null-terminate
+    const char **field;
+    switch (attr->id)
+    {
+    case NotificationAttributeIDAppIdentifier:
+        field = &current_notification->Identifier;
+        break;
+    case NotificationAttributeIDTitle:
+        field = &current_notification->Title;
+        break;
+    case NotificationAttributeIDSubtitle:
+        field = &current_notification->Subtitle;
+        break;
+    case NotificationAttributeIDMessage:
+        field = &current_notification->Message;
+        break;
+    case NotificationAttributeIDDate:
+        field = &current_notification->Date;
+        break;
+    default:
+        return;
+    }
 
-                // Append to the current message
-                strncat(current_notification->Message, sanitized_message, sizeof(current_notification->Message) - strlen(current_notification->Message) - 1);
-                break;
-            }
-            default:
-                ESP_LOGW(BLE_ANCS_TAG, "Unknown attribute ID: %d", AttributeID);
-                break;
-            }
+    // Each value takes only the space it needs in the text arena
+    notification_store_lock();
+    char *text = text_arena_alloc(field, attr->len + 1);
+    if (text != NULL)
+    {
+        ancs_copy_text(text, attr->len + 1, attr->value, attr->len, attr->id != NotificationAttributeIDAppIdentifier);
+    }
+    notification_store_unlock();
+    if (text == NULL)
+    {
+        ESP_LOGW(BLE_ANCS_TAG, "Text arena full, attribute %d of NotificationUID %" PRIu32 " dropped", attr->id, current_notification->NotificationUID);
+    }
+}
 
-            attrs += (1 + 2 + len);
-            remian_attr_len -= (1 + 2 + len);
-        }
+// Called with the store locked
+static bool set_app_name(NotificationAttributes *notification, const char *name)
+{
+    size_t len = strlen(name);
+    char *text = text_arena_alloc(&notification->AppName, len + 1);
+    if (text == NULL)
+    {
+        return false;
+    }
+    memcpy(text, name, len + 1);
+    return true;
+}
 
-        ESP_LOGI(BLE_ANCS_TAG, "Notification stored: UID=%d, Identifier=%s, Title=%s, Subtitle=%s, Message=%s",
-                 (int)current_notification->NotificationUID,
-                 current_notification->Identifier, current_notification->Title,
-                 current_notification->Subtitle, current_notification->Message);
+// Notifications of an app that arrived before its name did, the store is locked
+static void apply_app_name(NotificationAttributes *notification, void *ctx)
+{
+    if (strcmp(notification->Identifier, pending_app_id) == 0 && notification->AppName[0] == '\0')
+    {
+        set_app_name(notification, pending_app_name);
+    }
+}
 
-        ++notification_index;
+// Runs unlocked, only this task changes the store
+static void report_app_name(NotificationAttributes *notification, void *ctx)
+{
+    if (strcmp(notification->Identifier, pending_app_id) == 0 && strcmp(notification->AppName, pending_app_name) == 0)
+    {
+        user_callback(notification, NOTIFICATION_APP_NAME);
+    }
+}
 
-        ESP_LOGI(BLE_ANCS_TAG, "NEXT Notification INDEX: %d", notification_index);
+static void data_source_app_complete(void)
+{
+    pending_app = false;
+    if (pending_app_name[0] == '\0')
+    {
+        // An app without a name (e.g. no longer installed) is asked for again with its next notification
+        app_name_cache_fetch_failed(app_name_cache_key(pending_app_id));
+        return;
+    }
+    app_name_cache_set(pending_app_id, pending_app_name);
+    notification_store_lock();
+    notification_store_for_each(apply_app_name, NULL);
+    notification_store_unlock();
+    if (user_callback != NULL)
+    {
+        notification_store_for_each(report_app_name, NULL);
+    }
+}
 
-        // Call the callback function if it's registered
-        if (user_callback != NULL)
-        {
-            user_callback(current_notification); // Pass the new notification to the callback
-        }
+// Names of apps seen before come from the cache, the first notification of a new app requests it
+static void resolve_app_name(NotificationAttributes *notification)
+{
+    char name[APP_NAME_LEN];
+    bool fetch;
+    if (app_name_cache_lookup(notification->Identifier, name, sizeof(name), &fetch))
+    {
+        notification_store_lock();
+        set_app_name(notification, name);
+        notification_store_unlock();
+    }
+    else if (fetch)
+    {
+        ancs_request_queue_push(&request_queue, app_name_cache_key(notification->Identifier), ANCS_FETCH_APP, false);
+        request_pending_attributes();
+    }
+}
 
-        break;
+static void data_source_complete(void *ctx)
+{
+    if (pending_app)
+    {
+        data_source_app_complete();
+        return;
     }
 
-    case CommandIDGetAppAttributes:
-        ESP_LOGI(BLE_ANCS_TAG, "recevice APP Attributes response");
-        break;
+    NotificationAttributes *current_notification = pending_notification;
+    pending_notification = NULL;
+    if (current_notification == NULL)
+    {
+        return;
+    }
 
-    case CommandIDPerformNotificationAction:
-        ESP_LOGI(BLE_ANCS_TAG, "recevice Perform Notification Action");
-        break;
+    if (pending_event != NOTIFICATION_MESSAGE)
+    {
+        resolve_app_name(current_notification);
+    }
 
-    default:
-        ESP_LOGI(BLE_ANCS_TAG, "unknown Command ID");
-        break;
+    if (pending_event == NOTIFICATION_MESSAGE)
+    {
+        ESP_LOGI(BLE_ANCS_TAG, "Message fetched: UID=%d, Subtitle=%s, Message=%s",
+                 (int)current_notification->NotificationUID, current_notification->Subtitle, current_notification->Message);
+    }
+    else
+    {
+        ESP_LOGI(BLE_ANCS_TAG, "Notification stored: UID=%d, Identifier=%s, Title=%s, Date=%s",
+                 (int)current_notification->NotificationUID,
+                 current_notification->Identifier, current_notification->Title, current_notification->Date);
+    }
+
+    text_arena_stats_t text_stats;
+    text_arena_get_stats(&text_stats);
+    ESP_LOGI(BLE_ANCS_TAG, "Notifications stored: %d, text %" PRIu32 "/%" PRIu32 " bytes (peak %" PRIu32 ", freed %" PRIu32 ", %" PRIu32 " compactions)",
+             notification_store_count(), text_stats.live, text_stats.size, text_stats.high_water,
+             text_stats.used - text_stats.live, text_stats.compactions);
+
+    // Call the callback function if it's registered
+    if (user_callback != NULL)
+    {
+        user_callback(current_notification, pending_event); // Pass the notification to the callback
     }
 }
 
+static const ancs_stream_handler_t data_stream_handler = {
+    .begin = data_source_begin,
+    .app_begin = data_source_app_begin,
+    .attribute = data_source_attribute,
+    .complete = data_source_complete,
+};
+
 /*
     | CommandID(1 Byte) | NotificationUID(4 Bytes) | AttributeIDs |
 */
 
-void esp_get_notification_attributes(uint8_t *notificationUID, uint8_t num_attr, esp_noti_attr_list_t *p_attr)
+void esp_get_notification_attributes(uint32_t NotificationUID, uint8_t num_attr, const ancs_attr_request_t *p_attr)
 {
-    uint8_t cmd[600] = {0};
-    uint32_t index = 0;
-    cmd[0] = CommandIDGetNotificationAttributes;
-    index++;
-    memcpy(&cmd[index], notificationUID, ESP_NOTIFICATIONUID_LEN);
-    index += ESP_NOTIFICATIONUID_LEN;
-    while (num_attr > 0)
+    uint8_t cmd[ANCS_REQUEST_MAX_LEN];
+    size_t index = ancs_encode_get_notification_attributes(cmd, sizeof(cmd), NotificationUID, p_attr, num_attr);
+    if (index == 0)
     {
-        cmd[index++] = p_attr->noti_attribute_id;
-        if (p_attr->attribute_len > 0)
-        {
-            cmd[index++] = p_attr->attribute_len;
-            cmd[index++] = (p_attr->attribute_len << 8);
-        }
-        p_attr++;
-        num_attr--;
+        ESP_LOGE(BLE_ANCS_TAG, "Too many attributes requested: %d", num_attr);
+        return;
     }
 
     esp_ble_gattc_write_char(gl_profile_tab[PROFILE_A_APP_ID].gattc_if,
@@ -334,16 +485,56 @@ void esp_get_notification_attributes(uint8_t *notificationUID, uint8_t num_attr,
                              ESP_GATT_AUTH_REQ_NONE);
 }
 
-void esp_get_app_attributes(uint8_t *appidentifier, uint16_t appidentifier_len, uint8_t num_attr, uint8_t *p_app_attrs)
+static void request_pending_attributes(void)
 {
-    uint8_t buffer[600] = {0};
-    uint32_t index = 0;
-    buffer[0] = CommandIDGetAppAttributes;
-    index++;
-    memcpy(&buffer[index], appidentifier, appidentifier_len);
-    index += appidentifier_len;
-    memcpy(&buffer[index], p_app_attrs, num_attr);
-    index += num_attr;
+    ancs_request_t req;
+    while (ancs_request_queue_next(&request_queue, (uint32_t)(esp_timer_get_time() / 1000), &req))
+    {
+        ESP_LOGI(BLE_ANCS_TAG, "Get %s, NotificationUID %" PRIu32 ", %d queued",
+                 (req.fetch == ANCS_FETCH_BODY) ? "message" : "detailed information", req.uid, request_queue.pending_count);
+        if (req.fetch == ANCS_FETCH_APP)
+        {
+            const char *app_id = app_name_cache_pending_id(req.uid);
+            if (app_id == NULL || !esp_get_app_attributes(app_id, sizeof(app_attrs), app_attrs))
+            {
+                ancs_request_queue_complete_app(&request_queue, req.uid);
+            }
+        }
+        else if (req.fetch == ANCS_FETCH_BODY)
+        {
+            esp_get_notification_attributes(req.uid, sizeof(body_attrs) / sizeof(body_attrs[0]), body_attrs);
+        }
+        else
+        {
+            esp_get_notification_attributes(req.uid, sizeof(header_attrs) / sizeof(header_attrs[0]), header_attrs);
+        }
+    }
+}
+
+void ancs_app_fetch_message(uint32_t NotificationUID, bool urgent)
+{
+    uint8_t rec[5] = {NotificationUID & 0xFF, (NotificationUID >> 8) & 0xFF, (NotificationUID >> 16) & 0xFF, NotificationUID >> 24, urgent};
+    if (!spsc_ring_push(&fetch_ring, ANCS_EVENT_FETCH_MESSAGE, rec, sizeof(rec), (uint32_t)esp_timer_get_time()))
+    {
+        ESP_LOGW(BLE_ANCS_TAG, "Message request for NotificationUID %" PRIu32 " dropped, ANCS worker too slow", NotificationUID);
+        return;
+    }
+    xTaskNotifyGive(worker_task);
+}
+
+/*
+    | CommandID(1 Byte) | AppIdentifier(NUL-terminated) | AttributeIDs |
+*/
+
+static bool esp_get_app_attributes(const char *appidentifier, uint8_t num_attr, const uint8_t *p_app_attrs)
+{
+    uint8_t buffer[ANCS_APP_REQUEST_MAX_LEN];
+    size_t index = ancs_encode_get_app_attributes(buffer, sizeof(buffer), appidentifier, p_app_attrs, num_attr);
+    if (index == 0)
+    {
+        ESP_LOGE(BLE_ANCS_TAG, "Too many attributes requested: %d", num_attr);
+        return false;
+    }
 
     esp_ble_gattc_write_char(gl_profile_tab[PROFILE_A_APP_ID].gattc_if,
                              gl_profile_tab[PROFILE_A_APP_ID].conn_id,
@@ -352,6 +543,7 @@ void esp_get_app_attributes(uint8_t *appidentifier, uint16_t appidentifier_len,
                              buffer,
                              ESP_GATT_WRITE_TYPE_RSP,
                              ESP_GATT_AUTH_REQ_NONE);
+    return true;
 }
 
 void esp_perform_notification_action(uint8_t *notificationUID, uint8_t ActionID)
@@ -373,17 +565,308 @@ void esp_perform_notification_action(uint8_t *notificationUID, uint8_t ActionID)
                              ESP_GATT_AUTH_REQ_NONE);
 }
 
-static void periodic_timer_callback(void *arg)
+static void handle_notification_source(const uint8_t *data, uint16_t len)
+{
+    ancs_notification_source_t source;
+    if (!ancs_parse_notification_source(data, len, &source))
+    {
+        ESP_LOGE(BLE_ANCS_TAG, "short notification source packet");
+        return;
+    }
+    esp_receive_apple_notification_source((uint8_t *)data, len);
+
+    // if (source.event_id == EventIDNotificationAdded && source.category_id == CategoryIDIncomingCall) {
+    //      ESP_LOGI(BLE_ANCS_TAG, "IncomingCall, reject");
+    //      //Call reject
+    //      esp_perform_notification_action(notificationUID, ActionIDNegative);
+    //  } else
+
+    if (source.event_id == EventIDNotificationAdded || source.event_id == EventIDNotificationModified)
+    {
+        // get more information, repeated events for a UID still waiting collapse into one request
+        bool urgent = (source.event_flags & EventFlagImportant) || source.category_id == CategoryIDIncomingCall;
+        ancs_request_queue_push(&request_queue, source.notification_uid, ANCS_FETCH_HEADER, urgent);
+        request_pending_attributes();
+    }
+    else if (source.event_id == EventIDNotificationRemoved)
+    {
+        ESP_LOGI(BLE_ANCS_TAG, "Removed message");
+        ancs_request_queue_cancel(&request_queue, source.notification_uid);
+        if (pending_notification != NULL && pending_notification->NotificationUID == source.notification_uid)
+        {
+            pending_notification = NULL;
+        }
+        notification_store_lock();
+        bool removed = notification_store_remove(source.notification_uid);
+        notification_store_unlock();
+        if (removed && user_removed_callback != NULL)
+        {
+            user_removed_callback(source.notification_uid);
+        }
+    }
+}
+
+static void handle_data_source(const uint8_t *data, uint16_t len)
+{
+    // A response may span several notifications, it is dispatched as soon as its last attribute arrives
+    if (!ancs_stream_feed(&data_stream, data, len))
+    {
+        ESP_LOGE(BLE_ANCS_TAG, "data error, unexpected Data Source response dropped");
+        pending_notification = NULL;
+    }
+}
+
+static void handle_write_result(esp_gatt_status_t status)
+{
+    ancs_request_t req;
+    bool tracked = ancs_request_queue_write_result(&request_queue, status == ESP_GATT_OK, &req);
+    if (tracked && status != ESP_GATT_OK)
+    {
+        // No response will follow (e.g. the notification is already gone), free the slot
+        request_pending_attributes();
+    }
+    if (status == ESP_GATT_OK)
+    {
+        return;
+    }
+
+    char *Errstr = Errcode_to_String(status);
+    if (Errstr)
+    {
+        ESP_LOGE(BLE_ANCS_TAG, "write control point error %s", Errstr);
+    }
+    if (tracked && req.fetch == ANCS_FETCH_APP)
+    {
+        ESP_LOGW(BLE_ANCS_TAG, "App name request failed");
+        app_name_cache_fetch_failed(req.uid);
+    }
+    else if (tracked)
+    {
+        ESP_LOGW(BLE_ANCS_TAG, "Request for NotificationUID %" PRIu32 " failed", req.uid);
+    }
+}
+
+// Takes back in-flight requests written at least 'max_age_ms' ago (0 for all of them) and asks again.
+// Used when a response is overdue and when the Data Source stream is reset, which loses the responses under way.
+static void reclaim_in_flight(uint32_t max_age_ms)
+{
+    uint32_t now = (uint32_t)(esp_timer_get_time() / 1000);
+    while (1)
+    {
+        ancs_request_t req;
+        bool stale = ancs_request_queue_take_stale(&request_queue, now, max_age_ms, &req);
+        bool retried = stale && ancs_request_queue_retry(&request_queue, &req);
+        if (!stale)
+        {
+            request_pending_attributes();
+            break;
+        }
+
+        if (retried)
+        {
+            ESP_LOGW(BLE_ANCS_TAG, "No response for NotificationUID %" PRIu32 ", asking again", req.uid);
+        }
+        else if (req.fetch == ANCS_FETCH_APP)
+        {
+            ESP_LOGW(BLE_ANCS_TAG, "App name request gave no response");
+            app_name_cache_fetch_failed(req.uid);
+        }
+        else
+        {
+            ESP_LOGW(BLE_ANCS_TAG, "No response for NotificationUID %" PRIu32 ", giving up", req.uid);
+        }
+    }
+}
+
+static void handle_disconnect(void)
+{
+    ancs_stream_reset(&data_stream);
+    ancs_request_queue_clear(&request_queue);
+    app_name_cache_abort_fetches();
+    notification_store_lock();
+    notification_store_clear();
+    notification_store_unlock();
+    pending_notification = NULL;
+    pending_app = false;
+    lv_gui_ble_status(false);
+}
+
+static void handle_event(const spsc_record_t *rec)
+{
+    switch (rec->type)
+    {
+    case ANCS_EVENT_NOTIFICATION_SOURCE:
+        handle_notification_source(rec->data, rec->len);
+        break;
+    case ANCS_EVENT_DATA_SOURCE:
+        handle_data_source(rec->data, rec->len);
+        break;
+    case ANCS_EVENT_WRITE_RESULT:
+        handle_write_result((esp_gatt_status_t)rec->data[0]);
+        break;
+    case ANCS_EVENT_DISCONNECT:
+        handle_disconnect();
+        break;
+    case ANCS_EVENT_BLE_STATUS:
+        lv_gui_ble_status(rec->data[0] != 0);
+        break;
+    case ANCS_EVENT_FETCH_MESSAGE:
+    {
+        uint32_t uid = (uint32_t)rec->data[0] | ((uint32_t)rec->data[1] << 8) | ((uint32_t)rec->data[2] << 16) | ((uint32_t)rec->data[3] << 24);
+        ancs_request_queue_push(&request_queue, uid, ANCS_FETCH_BODY, rec->data[4] != 0);
+        request_pending_attributes();
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// For counters with a single writer, no compare-and-swap needed
+static inline void store_max(_Atomic uint32_t *max, uint32_t value)
+{
+    if (value > atomic_load_explicit(max, memory_order_relaxed))
+    {
+        atomic_store_explicit(max, value, memory_order_relaxed);
+    }
+}
+
+// Called on the BTC task only, never blocks
+static void post_event(ancs_event_type_t type, const uint8_t *data, uint16_t len)
 {
-    esp_timer_stop(periodic_timer);
-    if (data_buffer.len > 0)
+    int64_t start_time = esp_timer_get_time();
+    if (!spsc_ring_push(&event_ring, type, data, len, (uint32_t)start_time))
     {
-        esp_receive_apple_data_source_custom(data_buffer.buffer, data_buffer.len);
-        memset(data_buffer.buffer, 0, data_buffer.len);
-        data_buffer.len = 0;
+        // The worker resets the Data Source stream once it has read up to the gap
+        atomic_fetch_add_explicit(&producer_stats.dropped, 1, memory_order_relaxed);
+        uint32_t gap = spsc_ring_write_pos(&event_ring);
+        uint32_t intact = STREAM_INTACT;
+        atomic_store_explicit(&stream_lost_last, gap, memory_order_release);
+        atomic_compare_exchange_strong(&stream_lost_at, &intact, gap);
+        if (type == ANCS_EVENT_DISCONNECT)
+        {
+            // Should an earlier one still be waiting, it moves here: the state ends up cleared either way
+            atomic_store_explicit(&disconnect_lost_at, spsc_ring_write_pos(&event_ring), memory_order_release);
+        }
+        xTaskNotifyGive(worker_task);
+        return;
+    }
+
+    uint32_t events = atomic_fetch_add_explicit(&producer_stats.events, 1, memory_order_relaxed) + 1;
+    uint32_t depth = events - atomic_load_explicit(&worker_stats.events_done, memory_order_relaxed);
+    store_max(&producer_stats.max_depth, depth);
+    store_max(&producer_stats.max_ring_bytes, spsc_ring_used(&event_ring));
+    xTaskNotifyGive(worker_task);
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start_time);
+    callback_total_us += elapsed;
+    atomic_store_explicit(&producer_stats.avg_callback_us, callback_total_us / events, memory_order_relaxed);
+    store_max(&producer_stats.max_callback_us, elapsed);
+}
+
+// Called when the worker has read everything queued before the gap at 'lost_at'
+static void handle_stream_gap(uint32_t lost_at, uint32_t *dropped_seen)
+{
+    // A lost Data Source fragment would corrupt the response being reassembled
+    uint32_t dropped = atomic_load_explicit(&producer_stats.dropped, memory_order_relaxed);
+    ESP_LOGW(BLE_ANCS_TAG, "%" PRIu32 " events dropped, ANCS worker too slow", dropped - *dropped_seen);
+    *dropped_seen = dropped;
+    ancs_stream_reset(&data_stream);
+    pending_notification = NULL;
+    pending_app = false;
+    reclaim_in_flight(0);
+
+    // Only the BTC task arms stream_lost_at while it is clear, so the worker may move it to a later gap
+    uint32_t last = atomic_load_explicit(&stream_lost_last, memory_order_acquire);
+    if (last != lost_at)
+    {
+        atomic_store_explicit(&stream_lost_at, last, memory_order_release);
+        return;
+    }
+    atomic_store_explicit(&stream_lost_at, STREAM_INTACT, memory_order_release);
+    // A drop between the two loads found the position still armed and only updated stream_lost_last
+    last = atomic_load_explicit(&stream_lost_last, memory_order_acquire);
+    uint32_t intact = STREAM_INTACT;
+    if (last != lost_at)
+    {
+        atomic_compare_exchange_strong(&stream_lost_at, &intact, last);
+    }
+}
+
+static void ancs_worker_task(void *param)
+{
+    uint32_t dropped_seen = 0;
+    int64_t last_report = esp_timer_get_time();
+
+    while (1)
+    {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(ANCS_WORKER_WAKE_MS));
+
+        spsc_record_t rec;
+        while (spsc_ring_peek(&fetch_ring, &rec))
+        {
+            handle_event(&rec);
+            spsc_ring_pop(&fetch_ring);
+        }
+
+        while (1)
+        {
+            uint32_t lost_at = atomic_load_explicit(&disconnect_lost_at, memory_order_acquire);
+            if (lost_at != DISCONNECT_NONE && spsc_ring_read_pos(&event_ring) == lost_at)
+            {
+                // Everything queued before the lost disconnect has been handled, nothing of a later connection yet
+                atomic_compare_exchange_strong(&disconnect_lost_at, &lost_at, DISCONNECT_NONE);
+                handle_disconnect();
+            }
+            uint32_t gap = atomic_load_explicit(&stream_lost_at, memory_order_acquire);
+            if (gap != STREAM_INTACT && spsc_ring_read_pos(&event_ring) == gap)
+            {
+                handle_stream_gap(gap, &dropped_seen);
+            }
+            if (!spsc_ring_peek(&event_ring, &rec))
+            {
+                break;
+            }
+
+            uint32_t latency = (uint32_t)esp_timer_get_time() - rec.stamp;
+            handle_event(&rec);
+            spsc_ring_pop(&event_ring);
+
+            uint32_t done = atomic_load_explicit(&worker_stats.events_done, memory_order_relaxed) + 1;
+            atomic_store_explicit(&worker_stats.events_done, done, memory_order_relaxed);
+            latency_total_us += latency;
+            atomic_store_explicit(&worker_stats.avg_latency_us, latency_total_us / done, memory_order_relaxed);
+            store_max(&worker_stats.max_latency_us, latency);
+        }
+
+        reclaim_in_flight(ANCS_REQUEST_TIMEOUT_MS);
+
+        ancs_worker_stats_t stats;
+        ancs_app_get_worker_stats(&stats);
+        if (esp_timer_get_time() - last_report >= ANCS_STATS_INTERVAL_MS * 1000LL && stats.events > 0)
+        {
+            last_report = esp_timer_get_time();
+            ESP_LOGI(BLE_ANCS_TAG, "Events: %" PRIu32 ", dropped: %" PRIu32 ", max depth: %" PRIu32 " (%" PRIu32 " bytes)",
+                     stats.events, stats.dropped, stats.max_depth, stats.max_ring_bytes);
+            ESP_LOGI(BLE_ANCS_TAG, "Worker latency avg/max: %" PRIu32 "/%" PRIu32 " us, callback avg/max: %" PRIu32 "/%" PRIu32 " us",
+                     stats.avg_latency_us, stats.max_latency_us, stats.avg_callback_us, stats.max_callback_us);
+        }
     }
 }
 
+void ancs_app_get_worker_stats(ancs_worker_stats_t *stats)
+{
+    // Each field is read atomically, the fields together are not a consistent snapshot
+    stats->events = atomic_load_explicit(&producer_stats.events, memory_order_relaxed);
+    stats->dropped = atomic_load_explicit(&producer_stats.dropped, memory_order_relaxed);
+    stats->max_depth = atomic_load_explicit(&producer_stats.max_depth, memory_order_relaxed);
+    stats->max_ring_bytes = atomic_load_explicit(&producer_stats.max_ring_bytes, memory_order_relaxed);
+    stats->avg_callback_us = atomic_load_explicit(&producer_stats.avg_callback_us, memory_order_relaxed);
+    stats->max_callback_us = atomic_load_explicit(&producer_stats.max_callback_us, memory_order_relaxed);
+    stats->avg_latency_us = atomic_load_explicit(&worker_stats.avg_latency_us, memory_order_relaxed);
+    stats->max_latency_us = atomic_load_explicit(&worker_stats.max_latency_us, memory_order_relaxed);
+}
+
 static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param_t *param)
 {
     ESP_LOGV(BLE_ANCS_TAG, "GAP_EVT, event %d", event);
@@ -444,7 +927,8 @@ static void gap_event_handler(esp_gap_ble_cb_event_t event, esp_ble_gap_cb_param
     {
         esp_log_buffer_hex("addr", param->ble_security.auth_cmpl.bd_addr, ESP_BD_ADDR_LEN);
         ESP_LOGI(BLE_ANCS_TAG, "pair status = %s", param->ble_security.auth_cmpl.success ? "success" : "fail");
-        lv_gui_ble_status(param->ble_security.auth_cmpl.success);
+        uint8_t success = param->ble_security.auth_cmpl.success;
+        post_event(ANCS_EVENT_BLE_STATUS, &success, sizeof(success));
         if (!param->ble_security.auth_cmpl.success)
         {
             ESP_LOGI(BLE_ANCS_TAG, "fail reason = 0x%x", param->ble_security.auth_cmpl.fail_reason);
@@ -692,43 +1176,11 @@ static void gattc_profile_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_
         // esp_log_buffer_hex(BLE_ANCS_TAG, param->notify.value, param->notify.value_len);
         if (param->notify.handle == gl_profile_tab[PROFILE_A_APP_ID].notification_source_handle)
         {
-            esp_receive_apple_notification_source(param->notify.value, param->notify.value_len);
-            uint8_t *notificationUID = &param->notify.value[4];
-
-            // if (param->notify.value[0] == EventIDNotificationAdded && param->notify.value[2] == CategoryIDIncomingCall) {
-            //      ESP_LOGI(BLE_ANCS_TAG, "IncomingCall, reject");
-            //      //Call reject
-            //      esp_perform_notification_action(notificationUID, ActionIDNegative);
-            //  } else
-
-            if (param->notify.value[0] == EventIDNotificationAdded)
-            {
-                // get more information
-                ESP_LOGI(BLE_ANCS_TAG, "Get detailed information");
-                esp_get_notification_attributes(notificationUID, sizeof(p_attr) / sizeof(esp_noti_attr_list_t), p_attr);
-            }
-            else if (param->notify.value[0] == EventIDNotificationRemoved)
-            {
-                // get more information
-                ESP_LOGI(BLE_ANCS_TAG, "Removed message");
-            }
+            post_event(ANCS_EVENT_NOTIFICATION_SOURCE, param->notify.value, param->notify.value_len);
         }
         else if (param->notify.handle == gl_profile_tab[PROFILE_A_APP_ID].data_source_handle)
         {
-            memcpy(&data_buffer.buffer[data_buffer.len], param->notify.value, param->notify.value_len);
-            data_buffer.len += param->notify.value_len;
-            if (param->notify.value_len == (gl_profile_tab[PROFILE_A_APP_ID].MTU_size - 3))
-            {
-                // copy and wait next packet, start timer 500ms
-                esp_timer_start_periodic(periodic_timer, 500000);
-            }
-            else
-            {
-                esp_timer_stop(periodic_timer);
-                esp_receive_apple_data_source_custom(data_buffer.buffer, data_buffer.len);
-                memset(data_buffer.buffer, 0, data_buffer.len);
-                data_buffer.len = 0;
-            }
+            post_event(ANCS_EVENT_DATA_SOURCE, param->notify.value, param->notify.value_len);
         }
         else
         {
@@ -750,27 +1202,35 @@ static void gattc_profile_event_handler(esp_gattc_cb_event_t event, esp_gatt_if_
         break;
     }
     case ESP_GATTC_WRITE_CHAR_EVT:
-        if (param->write.status != ESP_GATT_OK)
+    {
+        // Only attribute requests are written to the Control Point while the queue is in use
+        if (param->write.handle == gl_profile_tab[PROFILE_A_APP_ID].contol_point_handle)
+        {
+            uint8_t status = param->write.status;
+            post_event(ANCS_EVENT_WRITE_RESULT, &status, sizeof(status));
+        }
+        else if (param->write.status != ESP_GATT_OK)
         {
             char *Errstr = Errcode_to_String(param->write.status);
             if (Errstr)
             {
-                ESP_LOGE(BLE_ANCS_TAG, "write control point error %s", Errstr);
+                ESP_LOGE(BLE_ANCS_TAG, "write char error %s", Errstr);
             }
-            break;
         }
-        // ESP_LOGI(BLE_ANCS_TAG, "Write char success ");
         break;
+    }
     case ESP_GATTC_DISCONNECT_EVT:
         ESP_LOGI(BLE_ANCS_TAG, "ESP_GATTC_DISCONNECT_EVT, reason = 0x%x", param->disconnect.reason);
         get_service = false;
+        battery_set_radio_load(false);
+        post_event(ANCS_EVENT_DISCONNECT, NULL, 0);
         esp_ble_gap_start_advertising(&adv_params);
-        lv_gui_ble_status(false);
         break;
     case ESP_GATTC_CONNECT_EVT:
         // ESP_LOGI(BLE_ANCS_TAG, "ESP_GATTC_CONNECT_EVT");
         // esp_log_buffer_hex("bda", param->connect.remote_bda, 6);
         memcpy(gl_profile_tab[PROFILE_A_APP_ID].remote_bda, param->connect.remote_bda, 6);
+        battery_set_radio_load(true);
         // create gattc virtual connection
         esp_ble_gattc_open(gl_profile_tab[PROFILE_A_APP_ID].gattc_if, gl_profile_tab[PROFILE_A_APP_ID].remote_bda, BLE_ADDR_TYPE_RANDOM, true);
         break;
@@ -819,18 +1279,38 @@ static void esp_gattc_cb(esp_gattc_cb_event_t event, esp_gatt_if_t gattc_if, esp
     } while (0);
 }
 
-void init_timer(void)
-{
-    ESP_ERROR_CHECK(esp_timer_create(&periodic_timer_args, &periodic_timer));
-}
-
-void ancs_app(notification_callback_t callback)
+void ancs_app(notification_callback_t callback, notification_removed_callback_t removed_callback)
 {
     esp_err_t ret;
     user_callback = callback; // Store the user-defined callback
+    user_removed_callback = removed_callback;
+
+    ret = notification_store_init(MAX_NOTIFICATIONS, NOTIFICATION_TEXT_ARENA_SIZE, NOTIFICATION_STORE_CAPS);
+    if (ret)
+    {
+        ESP_LOGE(BLE_ANCS_TAG, "%s init notification store failed: %s", __func__, esp_err_to_name(ret));
+        return;
+    }
 
-    // init timer
-    init_timer();
+    // Names of apps seen on earlier connections, needs NVS
+    app_name_cache_init();
+
+    // Every Get Notification Attributes request asks for the attributes in p_attr
+    // Ask only for as much text as the notification tile can show
+    uint16_t title_len, message_len;
+    lv_gui_get_text_budget(&title_len, &message_len);
+    header_attrs[1].max_len = title_len;
+    body_attrs[0].max_len = title_len;
+    body_attrs[1].max_len = message_len;
+    ESP_LOGI(BLE_ANCS_TAG, "Requesting titles up to %d bytes, messages up to %d bytes", title_len, message_len);
+
+    ancs_stream_init(&data_stream, &data_stream_handler);
+    ancs_request_queue_init(&request_queue);
+
+    // Started before Bluedroid so no GATT event can arrive without a consumer
+    spsc_ring_init(&event_ring, event_ring_buf, sizeof(event_ring_buf));
+    spsc_ring_init(&fetch_ring, fetch_ring_buf, sizeof(fetch_ring_buf));
+    xTaskCreatePinnedToCore(ancs_worker_task, "ANCS_Worker", 6144, NULL, 3, &worker_task, 1);
 
     ESP_ERROR_CHECK(esp_bt_controller_mem_release(ESP_BT_MODE_CLASSIC_BT));
 
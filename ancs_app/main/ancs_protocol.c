@@ -0,0 +1,305 @@
+#include <string.h>
+#include "ancs_protocol.h"
+
+static inline uint16_t read_le16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t read_le32(const uint8_t *p)
+{
+    return (uint32_t)p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline uint8_t *write_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = v >> 8;
+    return p + 2;
+}
+
+static inline uint8_t *write_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v & 0xFF;
+    p[1] = (v >> 8) & 0xFF;
+    p[2] = (v >> 16) & 0xFF;
+    p[3] = v >> 24;
+    return p + 4;
+}
+
+bool ancs_parse_notification_source(const uint8_t *data, size_t len, ancs_notification_source_t *out)
+{
+    if (!data || len < ANCS_NOTIFICATION_SOURCE_LEN)
+    {
+        return false;
+    }
+
+    out->event_id = data[0];
+    out->event_flags = data[1];
+    out->category_id = data[2];
+    out->category_count = data[3];
+    out->notification_uid = read_le32(&data[4]);
+    return true;
+}
+
+ancs_parse_result_t ancs_parse_attributes_header(const uint8_t *data, size_t len, uint8_t *command_id, uint32_t *uid, ancs_attr_iter_t *it)
+{
+    if (!data || len < ANCS_ATTRIBUTES_HEADER_LEN)
+    {
+        return ANCS_PARSE_TRUNCATED;
+    }
+
+    *command_id = data[0];
+    *uid = read_le32(&data[1]);
+    it->pos = data + ANCS_ATTRIBUTES_HEADER_LEN;
+    it->end = data + len;
+    return ANCS_PARSE_OK;
+}
+
+ancs_parse_result_t ancs_attr_next(ancs_attr_iter_t *it, ancs_attribute_t *attr)
+{
+    size_t remaining = it->end - it->pos;
+    if (remaining == 0)
+    {
+        return ANCS_PARSE_END;
+    }
+    if (remaining < ANCS_ATTRIBUTE_HEADER_LEN)
+    {
+        return ANCS_PARSE_TRUNCATED;
+    }
+
+    uint16_t len = read_le16(&it->pos[1]);
+    if (len > remaining - ANCS_ATTRIBUTE_HEADER_LEN)
+    {
+        return ANCS_PARSE_TRUNCATED;
+    }
+
+    attr->id = it->pos[0];
+    attr->len = len;
+    attr->value = it->pos + ANCS_ATTRIBUTE_HEADER_LEN;
+    it->pos += ANCS_ATTRIBUTE_HEADER_LEN + len;
+    return ANCS_PARSE_OK;
+}
+
+size_t ancs_encode_get_notification_attributes(uint8_t *out, size_t out_size, uint32_t uid, const ancs_attr_request_t *attrs, size_t count)
+{
+    size_t len = ANCS_ATTRIBUTES_HEADER_LEN;
+    for (size_t i = 0; i < count; i++)
+    {
+        len += ancs_attr_takes_max_len(attrs[i].id) ? ANCS_ATTRIBUTE_HEADER_LEN : 1;
+    }
+    if (len > out_size)
+    {
+        return 0;
+    }
+
+    uint8_t *p = out;
+    *p++ = ANCS_COMMAND_GET_NOTIFICATION_ATTRIBUTES;
+    p = write_le32(p, uid);
+    for (size_t i = 0; i < count; i++)
+    {
+        *p++ = attrs[i].id;
+        if (ancs_attr_takes_max_len(attrs[i].id))
+        {
+            p = write_le16(p, attrs[i].max_len);
+        }
+    }
+    return len;
+}
+
+size_t ancs_encode_get_app_attributes(uint8_t *out, size_t out_size, const char *app_id, const uint8_t *attr_ids, size_t count)
+{
+    // strnlen() is POSIX, not C11; memchr() stops at the terminator just the same
+    const char *nul = memchr(app_id, '\0', ANCS_APP_ID_MAX - 1);
+    size_t id_len = nul ? (size_t)(nul - app_id) : ANCS_APP_ID_MAX - 1;
+    size_t len = 1 + id_len + 1 + count;
+    if (len > out_size)
+    {
+        return 0;
+    }
+
+    uint8_t *p = out;
+    *p++ = ANCS_COMMAND_GET_APP_ATTRIBUTES;
+    memcpy(p, app_id, id_len);
+    p += id_len;
+    *p++ = '\0';
+    memcpy(p, attr_ids, count);
+    return len;
+}
+
+size_t ancs_copy_text(char *dst, size_t dst_size, const uint8_t *src, size_t len, bool flatten_newlines)
+{
+    if (dst_size == 0)
+    {
+        return 0;
+    }
+
+    size_t n = (len < dst_size - 1) ? len : dst_size - 1;
+    if (n < len)
+    {
+        // Back up to the start of the sequence the cut falls into, continuation bytes are 10xxxxxx
+        while (n > 0 && (src[n] & 0xC0) == 0x80)
+        {
+            n--;
+        }
+    }
+
+    memcpy(dst, src, n);
+    if (flatten_newlines)
+    {
+        for (size_t i = 0; i < n; i++)
+        {
+            if (dst[i] == '\n' || dst[i] == '\r')
+            {
+                dst[i] = ' ';
+            }
+        }
+    }
+    dst[n] = '\0';
+    return n;
+}
+
+void ancs_stream_init(ancs_stream_t *st, const ancs_stream_handler_t *handler)
+{
+    memset(st, 0, sizeof(*st));
+    st->handler = *handler;
+}
+
+void ancs_stream_reset(ancs_stream_t *st)
+{
+    st->state = ANCS_STREAM_HEADER;
+    st->header_len = 0;
+    st->attrs_done = 0;
+    st->app_id_len = 0;
+}
+
+static void finish_response(ancs_stream_t *st)
+{
+    st->handler.complete(st->handler.ctx);
+    ancs_stream_reset(st);
+}
+
+static void finish_attribute(ancs_stream_t *st)
+{
+    ancs_attribute_t attr = {
+        .id = st->attr_id,
+        .len = (st->attr_len < ANCS_STREAM_VALUE_MAX) ? st->attr_len : ANCS_STREAM_VALUE_MAX,
+        .value = st->value,
+    };
+    st->handler.attribute(st->handler.ctx, &attr);
+
+    if (++st->attrs_done == st->attr_count)
+    {
+        finish_response(st);
+    }
+    else
+    {
+        st->state = ANCS_STREAM_ATTR_HEADER;
+        st->header_len = 0;
+    }
+}
+
+bool ancs_stream_feed(ancs_stream_t *st, const uint8_t *data, size_t len)
+{
+    const uint8_t *end = data + len;
+
+    if (st->state == ANCS_STREAM_DISCARD)
+    {
+        // A response always starts at the beginning of a notification
+        ancs_stream_reset(st);
+    }
+
+    while (data < end)
+    {
+        switch (st->state)
+        {
+        case ANCS_STREAM_HEADER:
+            st->header[st->header_len++] = *data++;
+            if (st->header_len == 1 && st->header[0] != ANCS_COMMAND_GET_NOTIFICATION_ATTRIBUTES)
+            {
+                if (st->header[0] != ANCS_COMMAND_GET_APP_ATTRIBUTES || st->handler.app_begin == NULL)
+                {
+                    st->state = ANCS_STREAM_DISCARD;
+                    return false;
+                }
+                st->state = ANCS_STREAM_APP_ID;
+                st->app_id_len = 0;
+            }
+            else if (st->header_len == ANCS_ATTRIBUTES_HEADER_LEN)
+            {
+                st->attr_count = st->handler.begin(st->handler.ctx, read_le32(&st->header[1]));
+                st->state = ANCS_STREAM_ATTR_HEADER;
+                st->header_len = 0;
+                if (st->attr_count == 0)
+                {
+                    finish_response(st);
+                }
+            }
+            break;
+
+        case ANCS_STREAM_APP_ID:
+        {
+            uint8_t c = *data++;
+            if (c != '\0')
+            {
+                // Characters beyond the limit are dropped, the response still parses
+                if (st->app_id_len < ANCS_APP_ID_MAX - 1)
+                {
+                    st->app_id[st->app_id_len++] = c;
+                }
+                break;
+            }
+            st->app_id[st->app_id_len] = '\0';
+            st->attr_count = st->handler.app_begin(st->handler.ctx, st->app_id);
+            st->state = ANCS_STREAM_ATTR_HEADER;
+            st->header_len = 0;
+            if (st->attr_count == 0)
+            {
+                finish_response(st);
+            }
+            break;
+        }
+
+        case ANCS_STREAM_ATTR_HEADER:
+            st->header[st->header_len++] = *data++;
+            if (st->header_len == ANCS_ATTRIBUTE_HEADER_LEN)
+            {
+                st->attr_id = st->header[0];
+                st->attr_len = read_le16(&st->header[1]);
+                st->attr_pos = 0;
+                st->state = ANCS_STREAM_ATTR_VALUE;
+                if (st->attr_len == 0)
+                {
+                    finish_attribute(st);
+                }
+            }
+            break;
+
+        case ANCS_STREAM_ATTR_VALUE:
+        {
+            size_t take = st->attr_len - st->attr_pos;
+            if (take > (size_t)(end - data))
+            {
+                take = end - data;
+            }
+            // Keep what fits, skip the rest of an oversized value
+            if (st->attr_pos < ANCS_STREAM_VALUE_MAX)
+            {
+                size_t keep = ANCS_STREAM_VALUE_MAX - st->attr_pos;
+                memcpy(&st->value[st->attr_pos], data, (take < keep) ? take : keep);
+            }
+            st->attr_pos += take;
+            data += take;
+            if (st->attr_pos == st->attr_len)
+            {
+                finish_attribute(st);
+            }
+            break;
+        }
+
+        default:
+            return false;
+        }
+    }
+    return true;
+}
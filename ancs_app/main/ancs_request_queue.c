@@ -0,0 +1,249 @@
+#include <string.h>
+#include "ancs_request_queue.h"
+
+void ancs_request_queue_init(ancs_request_queue_t *q)
+{
+    memset(q, 0, sizeof(*q));
+}
+
+void ancs_request_queue_clear(ancs_request_queue_t *q)
+{
+    q->pending_count = 0;
+    q->in_flight_count = 0;
+}
+
+static int find_pending(const ancs_request_queue_t *q, uint32_t uid, ancs_fetch_t fetch)
+{
+    for (int i = 0; i < q->pending_count; i++)
+    {
+        if (q->pending[i].uid == uid && q->pending[i].fetch == fetch)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+// Oldest in-flight notification request for 'uid', whatever it fetches
+static int find_in_flight(const ancs_request_queue_t *q, uint32_t uid)
+{
+    for (int i = 0; i < q->in_flight_count; i++)
+    {
+        if (q->in_flight[i].uid == uid && q->in_flight[i].fetch != ANCS_FETCH_APP)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void remove_pending(ancs_request_queue_t *q, int i)
+{
+    memmove(&q->pending[i], &q->pending[i + 1], (q->pending_count - i - 1) * sizeof(q->pending[0]));
+    q->pending_count--;
+}
+
+static void remove_in_flight(ancs_request_queue_t *q, int i)
+{
+    memmove(&q->in_flight[i], &q->in_flight[i + 1], (q->in_flight_count - i - 1) * sizeof(q->in_flight[0]));
+    q->in_flight_count--;
+}
+
+static bool is_in_flight(const ancs_request_queue_t *q, uint32_t uid, ancs_fetch_t fetch)
+{
+    for (int i = 0; i < q->in_flight_count; i++)
+    {
+        if (q->in_flight[i].uid == uid && q->in_flight[i].fetch == fetch && !q->in_flight[i].cancelled)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+// Urgent requests go behind the urgent ones already waiting, normal ones at the end.
+// A retried request goes in front of its group, it was written before any of them.
+static void insert_pending(ancs_request_queue_t *q, const ancs_request_t *req, bool first)
+{
+    int pos = q->pending_count;
+    if (req->urgent || first)
+    {
+        pos = 0;
+        while (pos < q->pending_count && q->pending[pos].urgent && !(first && req->urgent))
+        {
+            pos++;
+        }
+    }
+    memmove(&q->pending[pos + 1], &q->pending[pos], (q->pending_count - pos) * sizeof(q->pending[0]));
+    q->pending[pos] = *req;
+    q->pending_count++;
+}
+
+bool ancs_request_queue_push(ancs_request_queue_t *q, uint32_t uid, ancs_fetch_t fetch, bool urgent)
+{
+    int i = find_pending(q, uid, fetch);
+    if (i >= 0)
+    {
+        // A repeated event may raise the priority of a request that is still waiting
+        if (urgent && !q->pending[i].urgent)
+        {
+            remove_pending(q, i);
+        }
+        else
+        {
+            q->duplicates++;
+            return false;
+        }
+    }
+    else if (is_in_flight(q, uid, fetch))
+    {
+        q->duplicates++;
+        return false;
+    }
+
+    if (q->pending_count == ANCS_REQUEST_QUEUE_LEN)
+    {
+        if (!urgent || q->pending[q->pending_count - 1].urgent)
+        {
+            q->dropped++;
+            return false;
+        }
+        q->pending_count--;
+        q->dropped++;
+    }
+
+    ancs_request_t req = {
+        .uid = uid,
+        .fetch = fetch,
+        .urgent = urgent,
+    };
+    insert_pending(q, &req, false);
+    return true;
+}
+
+void ancs_request_queue_cancel(ancs_request_queue_t *q, uint32_t uid)
+{
+    for (int i = q->pending_count - 1; i >= 0; i--)
+    {
+        if (q->pending[i].uid == uid && q->pending[i].fetch != ANCS_FETCH_APP)
+        {
+            remove_pending(q, i);
+        }
+    }
+
+    for (int i = 0; i < q->in_flight_count; i++)
+    {
+        if (q->in_flight[i].uid == uid && q->in_flight[i].fetch != ANCS_FETCH_APP)
+        {
+            q->in_flight[i].cancelled = true;
+        }
+    }
+}
+
+bool ancs_request_queue_next(ancs_request_queue_t *q, uint32_t now_ms, ancs_request_t *req)
+{
+    if (q->pending_count == 0 || q->in_flight_count == ANCS_REQUEST_MAX_IN_FLIGHT)
+    {
+        return false;
+    }
+
+    *req = q->pending[0];
+    remove_pending(q, 0);
+    req->attempts++;
+    ancs_in_flight_t *entry = &q->in_flight[q->in_flight_count++];
+    entry->uid = req->uid;
+    entry->fetch = req->fetch;
+    entry->urgent = req->urgent;
+    entry->attempts = req->attempts;
+    entry->acked = false;
+    entry->cancelled = false;
+    entry->sent_ms = now_ms;
+    return true;
+}
+
+bool ancs_request_queue_take_stale(ancs_request_queue_t *q, uint32_t now_ms, uint32_t max_age_ms, ancs_request_t *req)
+{
+    // Entries are in write order, the first one is the oldest
+    while (q->in_flight_count > 0 && now_ms - q->in_flight[0].sent_ms >= max_age_ms)
+    {
+        ancs_in_flight_t entry = q->in_flight[0];
+        remove_in_flight(q, 0);
+        q->timeouts++;
+        if (!entry.cancelled)
+        {
+            req->uid = entry.uid;
+            req->fetch = entry.fetch;
+            req->urgent = entry.urgent;
+            req->attempts = entry.attempts;
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ancs_request_queue_retry(ancs_request_queue_t *q, const ancs_request_t *req)
+{
+    if (req->attempts >= ANCS_REQUEST_MAX_ATTEMPTS || q->pending_count == ANCS_REQUEST_QUEUE_LEN)
+    {
+        q->dropped++;
+        return false;
+    }
+    if (find_pending(q, req->uid, req->fetch) >= 0)
+    {
+        // Asked for again while it was in flight
+        return true;
+    }
+    insert_pending(q, req, true);
+    return true;
+}
+
+bool ancs_request_queue_write_result(ancs_request_queue_t *q, bool ok, ancs_request_t *req)
+{
+    for (int i = 0; i < q->in_flight_count; i++)
+    {
+        if (!q->in_flight[i].acked)
+        {
+            req->uid = q->in_flight[i].uid;
+            req->fetch = q->in_flight[i].fetch;
+            req->urgent = q->in_flight[i].urgent;
+            req->attempts = q->in_flight[i].attempts;
+            if (ok)
+            {
+                q->in_flight[i].acked = true;
+            }
+            else
+            {
+                remove_in_flight(q, i);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ancs_request_queue_complete(ancs_request_queue_t *q, uint32_t uid, ancs_fetch_t *fetch)
+{
+    int i = find_in_flight(q, uid);
+    if (i < 0)
+    {
+        *fetch = ANCS_FETCH_HEADER;
+        return false;
+    }
+    *fetch = q->in_flight[i].fetch;
+    bool wanted = !q->in_flight[i].cancelled;
+    remove_in_flight(q, i);
+    return wanted;
+}
+
+bool ancs_request_queue_complete_app(ancs_request_queue_t *q, uint32_t key)
+{
+    for (int i = 0; i < q->in_flight_count; i++)
+    {
+        if (q->in_flight[i].uid == key && q->in_flight[i].fetch == ANCS_FETCH_APP)
+        {
+            remove_in_flight(q, i);
+            return true;
+        }
+    }
+    return false;
+}
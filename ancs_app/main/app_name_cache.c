@@ -0,0 +1,200 @@
+#include <string.h>
+#include "esp_log.h"
+#include "nvs_manager.h"
+#include "app_name_cache.h"
+
+#define TAG "[App Names]"
+
+typedef enum
+{
+    APP_NAME_FREE = 0,
+    APP_NAME_FETCHING,  // Request queued or in flight, never persisted or evicted
+    APP_NAME_KNOWN,
+} app_name_state_t;
+
+typedef struct
+{
+    char app_id[APP_NAME_ID_LEN];
+    char name[APP_NAME_LEN];
+    uint32_t last_used; // LRU clock
+    uint8_t state;      // app_name_state_t
+} app_name_entry_t;
+
+static app_name_entry_t entries[APP_NAME_CACHE_SIZE];
+static uint32_t lru_clock = 0;
+
+uint32_t app_name_cache_key(const char *app_id)
+{
+    // FNV-1a
+    uint32_t h = 2166136261u;
+    while (*app_id)
+    {
+        h = (h ^ (uint8_t)*app_id++) * 16777619u;
+    }
+    return h;
+}
+
+static app_name_entry_t *find(const char *app_id)
+{
+    for (int i = 0; i < APP_NAME_CACHE_SIZE; i++)
+    {
+        if (entries[i].state != APP_NAME_FREE && strncmp(entries[i].app_id, app_id, APP_NAME_ID_LEN - 1) == 0)
+        {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static app_name_entry_t *find_key(uint32_t key)
+{
+    for (int i = 0; i < APP_NAME_CACHE_SIZE; i++)
+    {
+        if (entries[i].state == APP_NAME_FETCHING && app_name_cache_key(entries[i].app_id) == key)
+        {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+// A free entry, or the least recently used known one
+static app_name_entry_t *victim(void)
+{
+    app_name_entry_t *lru = NULL;
+    for (int i = 0; i < APP_NAME_CACHE_SIZE; i++)
+    {
+        if (entries[i].state == APP_NAME_FREE)
+        {
+            return &entries[i];
+        }
+        if (entries[i].state == APP_NAME_KNOWN && (lru == NULL || entries[i].last_used < lru->last_used))
+        {
+            lru = &entries[i];
+        }
+    }
+    return lru;
+}
+
+static void persist(void)
+{
+    // Outstanding fetches are not worth keeping across a reboot
+    static app_name_entry_t snapshot[APP_NAME_CACHE_SIZE];
+    memcpy(snapshot, entries, sizeof(snapshot));
+    for (int i = 0; i < APP_NAME_CACHE_SIZE; i++)
+    {
+        if (snapshot[i].state == APP_NAME_FETCHING)
+        {
+            memset(&snapshot[i], 0, sizeof(snapshot[i]));
+        }
+    }
+    nvs_manager_store_blob(APP_NAME_CACHE_NVS_KEY, snapshot, sizeof(snapshot));
+}
+
+esp_err_t app_name_cache_init(void)
+{
+    size_t length = sizeof(entries);
+    if (nvs_manager_get_blob(APP_NAME_CACHE_NVS_KEY, entries, &length) != ESP_OK || length != sizeof(entries))
+    {
+        // Nothing stored yet, or written by a build with a different layout
+        memset(entries, 0, sizeof(entries));
+        return ESP_OK;
+    }
+
+    int known = 0;
+    for (int i = 0; i < APP_NAME_CACHE_SIZE; i++)
+    {
+        if (entries[i].state != APP_NAME_KNOWN)
+        {
+            memset(&entries[i], 0, sizeof(entries[i]));
+            continue;
+        }
+        entries[i].app_id[APP_NAME_ID_LEN - 1] = '\0';
+        entries[i].name[APP_NAME_LEN - 1] = '\0';
+        if (entries[i].last_used > lru_clock)
+        {
+            lru_clock = entries[i].last_used;
+        }
+        known++;
+    }
+    ESP_LOGI(TAG, "%d app names loaded", known);
+    return ESP_OK;
+}
+
+bool app_name_cache_lookup(const char *app_id, char *name, size_t name_size, bool *fetch)
+{
+    *fetch = false;
+    if (app_id[0] == '\0')
+    {
+        return false;
+    }
+
+    app_name_entry_t *entry = find(app_id);
+    if (entry != NULL && entry->state == APP_NAME_KNOWN)
+    {
+        entry->last_used = ++lru_clock;
+        strlcpy(name, entry->name, name_size);
+        return true;
+    }
+    if (entry != NULL)
+    {
+        return false; // Already on its way
+    }
+
+    entry = victim();
+    if (entry == NULL)
+    {
+        return false; // Every entry is waiting for a response
+    }
+    memset(entry, 0, sizeof(*entry));
+    strlcpy(entry->app_id, app_id, sizeof(entry->app_id));
+    entry->state = APP_NAME_FETCHING;
+    *fetch = true;
+    return false;
+}
+
+const char *app_name_cache_pending_id(uint32_t key)
+{
+    app_name_entry_t *entry = find_key(key);
+    return entry ? entry->app_id : NULL;
+}
+
+void app_name_cache_set(const char *app_id, const char *name)
+{
+    app_name_entry_t *entry = find(app_id);
+    if (entry == NULL)
+    {
+        entry = victim();
+        if (entry == NULL)
+        {
+            return;
+        }
+        memset(entry, 0, sizeof(*entry));
+        strlcpy(entry->app_id, app_id, sizeof(entry->app_id));
+    }
+    strlcpy(entry->name, name, sizeof(entry->name));
+    entry->state = APP_NAME_KNOWN;
+    entry->last_used = ++lru_clock;
+    ESP_LOGI(TAG, "%s is \"%s\"", entry->app_id, entry->name);
+    persist();
+}
+
+void app_name_cache_fetch_failed(uint32_t key)
+{
+    app_name_entry_t *entry = find_key(key);
+    if (entry != NULL)
+    {
+        memset(entry, 0, sizeof(*entry));
+    }
+}
+
+void app_name_cache_abort_fetches(void)
+{
+    for (int i = 0; i < APP_NAME_CACHE_SIZE; i++)
+    {
+        if (entries[i].state == APP_NAME_FETCHING)
+        {
+            memset(&entries[i], 0, sizeof(entries[i]));
+        }
+    }
+}
@@ -1,3 +1,6 @@
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
 #include "battery_measurement.h"
 #include "esp_adc/adc_oneshot.h"
 #include "esp_adc/adc_cali.h"
@@ -8,62 +11,111 @@
 #define ADC_ATTEN ADC_ATTEN_DB_12
 #define ADC_BITWIDTH ADC_BITWIDTH_12
 #define REF_VOLTAGE 1100  // Reference voltage in mV (adjust based on ESP32's factory calibration)
-#define DIVIDER_RATIO 2.0 // Resistor divider ratio (adjust based on your resistor values)
+#define DIVIDER_RATIO 2 // Resistor divider ratio (adjust based on your resistor values)
+
+// A sampler task reads a burst of samples every BATTERY_SAMPLE_PERIOD_MS, takes their median and smooths
+// successive medians with a first order IIR filter. Consumers read the result without touching the ADC.
+#define BATTERY_BURST_SAMPLES       15      // Odd, the median is the middle sample
+#ifndef BATTERY_SAMPLE_PERIOD_MS
+#define BATTERY_SAMPLE_PERIOD_MS    2000    // The host tests replay traces with a shorter period
+#endif
+#define BATTERY_IIR_SHIFT           2       // Each burst moves the filtered voltage a quarter of the way
+#define BATTERY_IIR_FRAC_BITS       4       // Fractional bits of the filter state
+
+// Snapshot word: voltage in mV (bits 0-15), percentage (bits 16-23), valid flag (bit 24)
+#define SNAPSHOT_PERCENT_SHIFT      16
+#define SNAPSHOT_VALID              (1u << 24)
 
 static const char *TAG = "BATTERY_MEASUREMENT";
 
 static adc_oneshot_unit_handle_t adc_handle = NULL;
 static adc_cali_handle_t cali_handle = NULL;
 static bool calibration_enabled = false;
+static TaskHandle_t sampler_task = NULL;
+static _Atomic uint32_t snapshot = 0;
+static void battery_sampler_task(void *arg);
 
-// Battery voltage-to-percentage lookup table
+// Open-circuit voltage of the cell to state of charge, interpolated into soc_lut at init
 typedef struct
 {
-    float voltage;  // Battery voltage in volts
-    int percentage; // Corresponding battery percentage
+    uint16_t mv;
+    uint8_t percentage;
 } battery_level_t;
 
-// Battery voltage-to-percentage lookup table
-const battery_level_t battery_curve[] = {
-    {4.20, 100},
-    {4.00, 90},
-    {3.85, 75},
-    {3.70, 50},
-    {3.60, 25},
-    {3.50, 10},
-    {3.30, 0},
+static const battery_level_t battery_curve[] = {
+    {4200, 100},
+    {4000, 90},
+    {3850, 75},
+    {3700, 50},
+    {3600, 25},
+    {3500, 10},
+    {3300, 0},
 };
 
 #define NUM_POINTS (sizeof(battery_curve) / sizeof(battery_curve[0]))
+#define SOC_LUT_MIN_MV 3300
+#define SOC_LUT_MAX_MV 4200
+
+// State of charge for every millivolt between SOC_LUT_MIN_MV and SOC_LUT_MAX_MV
+static uint8_t soc_lut[SOC_LUT_MAX_MV - SOC_LUT_MIN_MV + 1];
+
+// Under load the cell voltage sags by the load current times its internal resistance. The currents are
+// estimates for the glasses, the sampler adds the resulting drop back before looking up the charge.
+#define BATTERY_INTERNAL_RESISTANCE_MOHM    250
+#define BATTERY_BASE_LOAD_MA                40  // CPU, PSRAM and sensors
+#define BATTERY_DISPLAY_LOAD_MA             8   // Panel on at brightness 0
+#define BATTERY_BRIGHTNESS_LOAD_MA          60  // Added at brightness 255, linear in between
+#define BATTERY_RADIO_LOAD_MA               15  // BLE connected
+
+static _Atomic uint32_t display_load_ma = 0;
+static _Atomic uint32_t radio_load_ma = 0;
+
+static void build_soc_lut(void)
+{
+    for (size_t i = 0; i < NUM_POINTS - 1; i++)
+    {
+        const battery_level_t *hi = &battery_curve[i];
+        const battery_level_t *lo = &battery_curve[i + 1];
+        int span = hi->mv - lo->mv;
+        for (int mv = lo->mv; mv <= hi->mv; mv++)
+        {
+            // Rounded linear interpolation
+            soc_lut[mv - SOC_LUT_MIN_MV] = lo->percentage + ((mv - lo->mv) * (hi->percentage - lo->percentage) + span / 2) / span;
+        }
+    }
+}
 
-// Helper function to get battery percentage from voltage
-int battery_voltage_to_percentage(float voltage)
+int battery_mv_to_percentage(int mv)
 {
-    if (voltage >= battery_curve[0].voltage)
+    if (mv >= SOC_LUT_MAX_MV)
     {
         return 100; // Above the max voltage, assume full charge
     }
-    if (voltage <= battery_curve[NUM_POINTS - 1].voltage)
+    if (mv <= SOC_LUT_MIN_MV)
     {
         return 0; // Below the minimum voltage, assume empty
     }
+    return soc_lut[mv - SOC_LUT_MIN_MV];
+}
 
-    // Linear interpolation between points
-    for (int i = 0; i < NUM_POINTS - 1; i++)
-    {
-        if (voltage <= battery_curve[i].voltage && voltage > battery_curve[i + 1].voltage)
-        {
-            float v1 = battery_curve[i].voltage;
-            float v2 = battery_curve[i + 1].voltage;
-            int p1 = battery_curve[i].percentage;
-            int p2 = battery_curve[i + 1].percentage;
+void battery_set_display_load(bool on, uint8_t brightness)
+{
+    uint32_t ma = on ? BATTERY_DISPLAY_LOAD_MA + BATTERY_BRIGHTNESS_LOAD_MA * brightness / 255 : 0;
+    atomic_store_explicit(&display_load_ma, ma, memory_order_relaxed);
+}
 
-            // Linear interpolation formula
-            return p1 + (voltage - v1) * (p2 - p1) / (v2 - v1);
-        }
-    }
+void battery_set_radio_load(bool active)
+{
+    atomic_store_explicit(&radio_load_ma, active ? BATTERY_RADIO_LOAD_MA : 0, memory_order_relaxed);
+}
 
-    return 0; // Default, should never reach here
+// Voltage the cell would show without the current loads
+static int compensate_load(int mv)
+{
+    uint32_t load_ma = BATTERY_BASE_LOAD_MA +
+                       atomic_load_explicit(&display_load_ma, memory_order_relaxed) +
+                       atomic_load_explicit(&radio_load_ma, memory_order_relaxed);
+    return mv + load_ma * BATTERY_INTERNAL_RESISTANCE_MOHM / 1000;
 }
 
 esp_err_t battery_measurement_init(void)
@@ -111,18 +163,21 @@ esp_err_t battery_measurement_init(void)
         ESP_LOGW(TAG, "Calibration not supported on this device. Proceeding without calibration");
     }
 
+    build_soc_lut();
+    if (xTaskCreatePinnedToCore(battery_sampler_task, "Battery_Task", 4096, NULL, 1, &sampler_task, 1) != pdPASS)
+    {
+        ESP_LOGE(TAG, "Failed to start the battery sampler");
+        return ESP_ERR_NO_MEM;
+    }
+
     ESP_LOGI(TAG, "ADC initialization successful");
     return ESP_OK;
 }
 
-float battery_measurement_read(void)
+// ADC reading to battery voltage in mV
+static int raw_to_battery_mv(int raw_reading)
 {
-    int raw_reading = 0;
     int voltage = 0;
-
-    // Read raw ADC value
-    ESP_ERROR_CHECK(adc_oneshot_read(adc_handle, ADC_CHANNEL, &raw_reading));
-
     if (calibration_enabled)
     {
         // Convert raw value to voltage using calibration
@@ -133,15 +188,114 @@ float battery_measurement_read(void)
         // Approximate voltage calculation
         voltage = (raw_reading * REF_VOLTAGE) / (1 << ADC_BITWIDTH);
     }
+    return voltage * DIVIDER_RATIO;
+}
+
+float battery_measurement_read(void)
+{
+    int raw_reading = 0;
+
+    // Read raw ADC value
+    ESP_ERROR_CHECK(adc_oneshot_read(adc_handle, ADC_CHANNEL, &raw_reading));
 
-    float battery_voltage = voltage * DIVIDER_RATIO / 1000.0; // Calculate battery voltage in volts
-    // ESP_LOGI(TAG, "Raw ADC Value: %d, Voltage: %d mV, Battery Voltage: %.2f V", raw_reading, voltage, battery_voltage);
+    float battery_voltage = raw_to_battery_mv(raw_reading) / 1000.0; // Calculate battery voltage in volts
+    // ESP_LOGI(TAG, "Raw ADC Value: %d, Battery Voltage: %.2f V", raw_reading, battery_voltage);
 
     return battery_voltage;
 }
 
+// Median of one burst, false if the ADC gave no sample (ADC2 is shared with the radio and may time out)
+static bool read_burst_median(int *median)
+{
+    int samples[BATTERY_BURST_SAMPLES];
+    int count = 0;
+
+    for (int i = 0; i < BATTERY_BURST_SAMPLES; i++)
+    {
+        int raw = 0;
+        if (adc_oneshot_read(adc_handle, ADC_CHANNEL, &raw) != ESP_OK)
+        {
+            continue;
+        }
+
+        // Insertion sort, the burst is short
+        int j = count++;
+        while (j > 0 && samples[j - 1] > raw)
+        {
+            samples[j] = samples[j - 1];
+            j--;
+        }
+        samples[j] = raw;
+    }
+
+    if (count == 0)
+    {
+        return false;
+    }
+    *median = samples[count / 2];
+    return true;
+}
+
+// One step of the first order IIR filter, the state is in mV with BATTERY_IIR_FRAC_BITS fractional bits
+static int32_t iir_step(int32_t state, int mv)
+{
+    int32_t sample = mv << BATTERY_IIR_FRAC_BITS;
+    return (state < 0) ? sample : state + (sample - state) / (1 << BATTERY_IIR_SHIFT);
+}
+
+static uint32_t iir_mv(int32_t state)
+{
+    return (state + (1 << (BATTERY_IIR_FRAC_BITS - 1))) >> BATTERY_IIR_FRAC_BITS;
+}
+
+static void battery_sampler_task(void *arg)
+{
+    // -1 before the first burst. Each burst is compensated with the loads at its time before it is filtered,
+    // compensating the filtered voltage would turn every load step into a jump while the filter catches up.
+    int32_t filtered = -1;      // Terminal voltage, as reported
+    int32_t filtered_ocv = -1;  // Load compensated, for the percentage
+
+    while (1)
+    {
+        int median;
+        if (read_burst_median(&median))
+        {
+            int mv = raw_to_battery_mv(median);
+            filtered = iir_step(filtered, mv);
+            filtered_ocv = iir_step(filtered_ocv, compensate_load(mv));
+
+            uint32_t voltage_mv = iir_mv(filtered);
+            uint32_t percentage = battery_mv_to_percentage(iir_mv(filtered_ocv));
+            atomic_store_explicit(&snapshot, SNAPSHOT_VALID | (percentage << SNAPSHOT_PERCENT_SHIFT) | voltage_mv, memory_order_relaxed);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "No ADC sample in this burst");
+        }
+
+        vTaskDelay(pdMS_TO_TICKS(BATTERY_SAMPLE_PERIOD_MS));
+    }
+}
+
+bool battery_measurement_get(battery_snapshot_t *out)
+{
+    uint32_t word = atomic_load_explicit(&snapshot, memory_order_relaxed);
+    if (!(word & SNAPSHOT_VALID))
+    {
+        return false;
+    }
+    out->voltage_mv = word & 0xFFFF;
+    out->percentage = (word >> SNAPSHOT_PERCENT_SHIFT) & 0xFF;
+    return true;
+}
+
 void battery_measurement_deinit(void)
 {
+    if (sampler_task != NULL)
+    {
+        vTaskDelete(sampler_task);
+        sampler_task = NULL;
+    }
     if (calibration_enabled)
     {
         adc_cali_delete_scheme_curve_fitting(cali_handle);
@@ -9,6 +9,7 @@
 #include <inttypes.h>
 #include "esp_log.h"
 #include "ble_ancs.h"
+#include "ancs_protocol.h"
 
 #define BLE_ANCS_TAG "BLE_ANCS"
 
@@ -104,80 +105,73 @@ char *CategoryID_to_String(uint8_t CategoryID)
 
 void esp_receive_apple_notification_source(uint8_t *message, uint16_t message_len)
 {
-    if (!message || message_len < 5)
+    ancs_notification_source_t source;
+    if (!ancs_parse_notification_source(message, message_len, &source))
     {
         return;
     }
 
-    uint8_t EventID = message[0];
-    char *EventIDS = EventID_to_String(EventID);
-    uint8_t EventFlags = message[1];
-    uint8_t CategoryID = message[2];
-    char *Cidstr = CategoryID_to_String(CategoryID);
-    uint8_t CategoryCount = message[3];
-    uint32_t NotificationUID = (message[4]) | (message[5] << 8) | (message[6] << 16) | (message[7] << 24);
-    ESP_LOGI(BLE_ANCS_TAG, "EventID:%s EventFlags:0x%x CategoryID:%s CategoryCount:%d NotificationUID:%" PRIu32, EventIDS, EventFlags, Cidstr, CategoryCount, NotificationUID);
+    ESP_LOGI(BLE_ANCS_TAG, "EventID:%s EventFlags:0x%x CategoryID:%s CategoryCount:%d NotificationUID:%" PRIu32,
+             EventID_to_String(source.event_id), source.event_flags, CategoryID_to_String(source.category_id),
+             source.category_count, source.notification_uid);
 }
 
 void esp_receive_apple_data_source(uint8_t *message, uint16_t message_len)
 {
     // esp_log_buffer_hex("data source", message, message_len);
-    if (!message || message_len == 0)
+    uint8_t Command_id;
+    uint32_t NotificationUID;
+    ancs_attr_iter_t it;
+    if (ancs_parse_attributes_header(message, message_len, &Command_id, &NotificationUID, &it) != ANCS_PARSE_OK)
     {
         return;
     }
-    uint8_t Command_id = message[0];
     switch (Command_id)
     {
     case CommandIDGetNotificationAttributes:
     {
-        uint32_t NotificationUID = (message[1]) | (message[2] << 8) | (message[3] << 16) | (message[4] << 24);
-        uint32_t remian_attr_len = message_len - 5;
-        uint8_t *attrs = &message[5];
         ESP_LOGI(BLE_ANCS_TAG, "recevice Notification Attributes response Command_id %d NotificationUID %" PRIu32, Command_id, NotificationUID);
-        while (remian_attr_len > 0)
+        ancs_attribute_t attr;
+        ancs_parse_result_t res;
+        while ((res = ancs_attr_next(&it, &attr)) == ANCS_PARSE_OK)
         {
-            uint8_t AttributeID = attrs[0];
-            uint16_t len = attrs[1] | (attrs[2] << 8);
-            if (len > (remian_attr_len - 3))
-            {
-                ESP_LOGE(BLE_ANCS_TAG, "data error");
-                break;
-            }
-            switch (AttributeID)
+            const uint8_t *value = attr.value;
+            uint16_t len = attr.len;
+            switch (attr.id)
             {
             case NotificationAttributeIDAppIdentifier:
-                esp_log_buffer_char("Identifier", &attrs[3], len);
+                esp_log_buffer_char("Identifier", value, len);
                 break;
             case NotificationAttributeIDTitle:
-                esp_log_buffer_char("Title", &attrs[3], len);
+                esp_log_buffer_char("Title", value, len);
                 break;
             case NotificationAttributeIDSubtitle:
-                esp_log_buffer_char("Subtitle", &attrs[3], len);
+                esp_log_buffer_char("Subtitle", value, len);
                 break;
             case NotificationAttributeIDMessage:
-                esp_log_buffer_char("Message", &attrs[3], len);
+                esp_log_buffer_char("Message", value, len);
                 break;
             case NotificationAttributeIDMessageSize:
-                esp_log_buffer_char("MessageSize", &attrs[3], len);
+                esp_log_buffer_char("MessageSize", value, len);
                 break;
             case NotificationAttributeIDDate:
                 // yyyyMMdd'T'HHmmSS
-                esp_log_buffer_char("Date", &attrs[3], len);
+                esp_log_buffer_char("Date", value, len);
                 break;
             case NotificationAttributeIDPositiveActionLabel:
-                esp_log_buffer_hex("PActionLabel", &attrs[3], len);
+                esp_log_buffer_hex("PActionLabel", value, len);
                 break;
             case NotificationAttributeIDNegativeActionLabel:
-                esp_log_buffer_hex("NActionLabel", &attrs[3], len);
+                esp_log_buffer_hex("NActionLabel", value, len);
                 break;
             default:
-                esp_log_buffer_hex("unknownAttributeID", &attrs[3], len);
+                esp_log_buffer_hex("unknownAttributeID", value, len);
                 break;
             }
-
-            attrs += (1 + 2 + len);
-            remian_attr_len -= (1 + 2 + len);
+        }
+        if (res == ANCS_PARSE_TRUNCATED)
+        {
+            ESP_LOGE(BLE_ANCS_TAG, "data error");
         }
 
         break;
@@ -1,23 +1,55 @@
 #pragma once
 
+#include <stdint.h>
 #include <string.h>
+#include <stdbool.h>
 
-#define MAX_NOTIFICATIONS 10
-extern uint8_t notification_index;
+#define MAX_NOTIFICATIONS 200 // Notifications kept at once, the oldest one is dropped for a new one
 
+// Text is kept in the notification store's arena (see text_arena.h), never NULL
 typedef struct
 {
     uint32_t NotificationUID;
-    char Identifier[64];
-    char Title[64];
-    char Subtitle[64];
-    char Message[256];
+    const char *Identifier;
+    const char *AppName;    // Display name of the app, empty until it is known
+    const char *Title;
+    const char *Subtitle;   // Subtitle and Message are fetched with ancs_app_fetch_message()
+    const char *Message;
+    const char *Date;       // yyyyMMdd'T'HHmmSS
 } NotificationAttributes;
 
+typedef enum
+{
+    NOTIFICATION_ADDED = 0, // A new notification with its app, title and date
+    NOTIFICATION_MODIFIED,  // Title or date changed, a message fetched before is gone
+    NOTIFICATION_MESSAGE,   // The message asked for with ancs_app_fetch_message() arrived
+    NOTIFICATION_APP_NAME,  // The app's display name arrived, nothing else changed
+} notification_event_t;
+
 // Define the callback type
-typedef void (*notification_callback_t)(NotificationAttributes *notification);
+typedef void (*notification_callback_t)(NotificationAttributes *notification, notification_event_t event);
+typedef void (*notification_removed_callback_t)(uint32_t NotificationUID);     // Removed on the phone or dropped as the oldest
 
 // Function to receive notification data
 void esp_receive_apple_data_source(uint8_t *message, uint16_t message_len);
 
-void ancs_app(notification_callback_t callback);
\ No newline at end of file
+void ancs_app(notification_callback_t callback, notification_removed_callback_t removed_callback);
+
+// Requests the message of a stored notification. Call with the LVGL lock held, which keeps the callers to one at a time;
+// never blocks: the request is handed to the ANCS worker task, which queues it and writes the Control Point
+void ancs_app_fetch_message(uint32_t NotificationUID, bool urgent);
+
+// GATT notifications are handed from the BTC task to the ANCS worker task through a lock-free ring
+typedef struct
+{
+    uint32_t events;            // Events queued by the BTC task
+    uint32_t dropped;           // Events lost because the ring was full
+    uint32_t max_depth;         // Most events waiting at once
+    uint32_t max_ring_bytes;    // Most ring bytes in use at once
+    uint32_t avg_latency_us;    // Time from queueing to the start of handling
+    uint32_t max_latency_us;
+    uint32_t avg_callback_us;   // Time the BTC task spends queueing an event
+    uint32_t max_callback_us;
+} ancs_worker_stats_t;
+
+void ancs_app_get_worker_stats(ancs_worker_stats_t *stats);
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+    Wire format parsing for the Apple Notification Center Service.
+    Pure C without ESP-IDF dependencies, nothing is allocated and every read is bounds-checked
+    against the buffer it was given.
+
+    Notification Source:
+    | EventID(1 Byte) | EventFlags(1 Byte) | CategoryID(1 Byte) | CategoryCount(1 Byte) | NotificationUID(4 Bytes) |
+
+    Data Source, response to Get Notification Attributes:
+    | CommandID(1 Byte) | NotificationUID(4 Bytes) | { AttributeID(1 Byte) | Length(2 Bytes) | Value } * N |
+
+    Data Source, response to Get App Attributes:
+    | CommandID(1 Byte) | AppIdentifier(NUL-terminated) | { AttributeID(1 Byte) | Length(2 Bytes) | Value } * N |
+
+    All multi-byte fields are little endian, attribute values are UTF-8 without a terminator.
+*/
+#define ANCS_COMMAND_GET_NOTIFICATION_ATTRIBUTES    0
+#define ANCS_COMMAND_GET_APP_ATTRIBUTES             1
+
+#define ANCS_NOTIFICATION_SOURCE_LEN    8
+#define ANCS_ATTRIBUTES_HEADER_LEN      5
+#define ANCS_ATTRIBUTE_HEADER_LEN       3
+
+typedef enum
+{
+    ANCS_PARSE_OK = 0,
+    ANCS_PARSE_END,         // No attributes left
+    ANCS_PARSE_TRUNCATED,   // The buffer ends inside a header or an attribute value
+} ancs_parse_result_t;
+
+typedef struct
+{
+    uint8_t event_id;
+    uint8_t event_flags;
+    uint8_t category_id;
+    uint8_t category_count;
+    uint32_t notification_uid;
+} ancs_notification_source_t;
+
+typedef struct
+{
+    uint8_t id;
+    uint16_t len;
+    const uint8_t *value;   // Points into the parsed buffer
+} ancs_attribute_t;
+
+// Walks the attributes of a response in place
+typedef struct
+{
+    const uint8_t *pos;
+    const uint8_t *end;
+} ancs_attr_iter_t;
+
+bool ancs_parse_notification_source(const uint8_t *data, size_t len, ancs_notification_source_t *out);
+
+// Reads the response header and prepares 'it' for ancs_attr_next()
+ancs_parse_result_t ancs_parse_attributes_header(const uint8_t *data, size_t len, uint8_t *command_id, uint32_t *uid, ancs_attr_iter_t *it);
+ancs_parse_result_t ancs_attr_next(ancs_attr_iter_t *it, ancs_attribute_t *attr);
+
+/*
+    Control Point, Get Notification Attributes:
+    | CommandID(1 Byte) | NotificationUID(4 Bytes) | { AttributeID(1 Byte) | MaxLength(2 Bytes, Title/Subtitle/Message only) } * N |
+*/
+#define ANCS_MAX_REQUESTED_ATTRIBUTES   8
+#define ANCS_REQUEST_MAX_LEN            (ANCS_ATTRIBUTES_HEADER_LEN + ANCS_MAX_REQUESTED_ATTRIBUTES * ANCS_ATTRIBUTE_HEADER_LEN)
+
+typedef struct
+{
+    uint8_t id;
+    uint16_t max_len;   // Ignored for attributes without a length parameter
+} ancs_attr_request_t;
+
+// Title, Subtitle and Message must be followed by a maximum length, the other attributes must not
+static inline bool ancs_attr_takes_max_len(uint8_t id)
+{
+    return id >= 1 && id <= 3;
+}
+
+// Returns the request length, 0 if it does not fit into 'out_size' bytes
+size_t ancs_encode_get_notification_attributes(uint8_t *out, size_t out_size, uint32_t uid, const ancs_attr_request_t *attrs, size_t count);
+
+/*
+    Control Point, Get App Attributes:
+    | CommandID(1 Byte) | AppIdentifier(NUL-terminated) | AttributeID(1 Byte) * N |
+*/
+#define ANCS_APP_ID_MAX                 64  // Including the terminator, longer identifiers are truncated
+#define ANCS_APP_REQUEST_MAX_LEN        (1 + ANCS_APP_ID_MAX + ANCS_MAX_REQUESTED_ATTRIBUTES)
+
+// Returns the request length, 0 if it does not fit into 'out_size' bytes
+size_t ancs_encode_get_app_attributes(uint8_t *out, size_t out_size, const char *app_id, const uint8_t *attr_ids, size_t count);
+
+// Copies a UTF-8 value into a fixed-size field, always NUL-terminated. Truncation never splits a
+// multi-byte sequence. With flatten_newlines, line breaks become spaces. Returns the bytes written.
+size_t ancs_copy_text(char *dst, size_t dst_size, const uint8_t *src, size_t len, bool flatten_newlines);
+
+/*
+    Incremental reassembly of Get Notification Attributes and Get App Attributes responses from Data Source fragments.
+    A response carries no total length, it is complete once every requested attribute arrived, so the
+    handler tells the stream how many attributes the request it answers asked for. Values are collected in a scratch buffer
+    of ANCS_STREAM_VALUE_MAX bytes, longer ones are delivered truncated; memory use does not depend on
+    what the phone sends.
+*/
+#define ANCS_STREAM_VALUE_MAX   1024
+
+typedef struct
+{
+    uint8_t (*begin)(void *ctx, uint32_t uid);                   // Response header parsed, returns the attribute count
+    uint8_t (*app_begin)(void *ctx, const char *app_id);         // Same for an app response, NULL to drop them
+    void (*attribute)(void *ctx, const ancs_attribute_t *attr);  // attr->len is the stored, possibly truncated length
+    void (*complete)(void *ctx);                                 // Last requested attribute delivered
+    void *ctx;
+} ancs_stream_handler_t;
+
+typedef enum
+{
+    ANCS_STREAM_HEADER = 0,
+    ANCS_STREAM_APP_ID,     // Collecting the identifier of an app response
+    ANCS_STREAM_ATTR_HEADER,
+    ANCS_STREAM_ATTR_VALUE,
+    ANCS_STREAM_DISCARD,    // Malformed or unsupported response, dropped until the next fragment boundary
+} ancs_stream_state_t;
+
+typedef struct
+{
+    ancs_stream_handler_t handler;
+    uint8_t attr_count;     // Attributes in the current response
+    ancs_stream_state_t state;
+    uint8_t header[ANCS_ATTRIBUTES_HEADER_LEN];
+    uint8_t header_len;
+    uint8_t attrs_done;
+    uint8_t attr_id;
+    uint16_t attr_len;      // Length announced on the wire
+    uint16_t attr_pos;      // Bytes of the value received so far
+    uint8_t app_id_len;
+    char app_id[ANCS_APP_ID_MAX];
+    uint8_t value[ANCS_STREAM_VALUE_MAX];
+} ancs_stream_t;
+
+void ancs_stream_init(ancs_stream_t *st, const ancs_stream_handler_t *handler);
+void ancs_stream_reset(ancs_stream_t *st);
+
+// Consumes one Data Source fragment. Returns false if the fragment was not a valid continuation,
+// in which case the response is dropped and the next fragment is expected to start a new one.
+bool ancs_stream_feed(ancs_stream_t *st, const uint8_t *data, size_t len);
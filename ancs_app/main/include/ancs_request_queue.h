@@ -0,0 +1,93 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/*
+    Scheduling of Get Notification Attributes and Get App Attributes requests on the Control Point.
+    Requests wait in 'pending' until one of the ANCS_REQUEST_MAX_IN_FLIGHT slots is free.
+    Urgent requests (important notifications, incoming calls, the message on screen) are queued
+    ahead of normal ones, each group stays in arrival order. The same fetch for a UID is never
+    queued or in flight twice.
+    The phone answers requests in the order they were written, so in-flight entries are kept
+    in write order as well. A response that never arrives would hold its slot forever, so the
+    caller takes back entries older than ANCS_REQUEST_TIMEOUT_MS and queues them again.
+*/
+#define ANCS_REQUEST_QUEUE_LEN      224 // A header fetch for every notification the store keeps (MAX_NOTIFICATIONS) and some more
+#define ANCS_REQUEST_MAX_IN_FLIGHT  2
+#define ANCS_REQUEST_TIMEOUT_MS     3000
+#define ANCS_REQUEST_MAX_ATTEMPTS   2   // Writes of the same request before it is given up
+
+// What a request asks for, notifications are fetched in two phases
+typedef enum
+{
+    ANCS_FETCH_HEADER = 0,  // App, title and date, requested for every notification
+    ANCS_FETCH_BODY,        // Subtitle and message, requested once the notification is viewed
+    ANCS_FETCH_APP,         // Display name of an app, 'uid' is the key the caller gave the app
+} ancs_fetch_t;
+
+typedef struct
+{
+    uint32_t uid;
+    uint8_t fetch;  // ancs_fetch_t
+    bool urgent;
+    uint8_t attempts;   // Times it has been written to the Control Point
+} ancs_request_t;
+
+typedef struct
+{
+    uint32_t uid;
+    uint8_t fetch;
+    bool urgent;
+    uint8_t attempts;
+    bool acked;     // The Control Point write has been confirmed
+    bool cancelled; // The notification went away, its response is unwanted
+    uint32_t sent_ms;
+} ancs_in_flight_t;
+
+typedef struct
+{
+    ancs_request_t pending[ANCS_REQUEST_QUEUE_LEN];
+    uint16_t pending_count;
+    ancs_in_flight_t in_flight[ANCS_REQUEST_MAX_IN_FLIGHT];
+    uint8_t in_flight_count;
+    uint32_t dropped;       // Requests lost because the queue was full
+    uint32_t duplicates;    // Requests that were already queued or in flight
+    uint32_t timeouts;      // In-flight requests taken back without a response
+} ancs_request_queue_t;
+
+void ancs_request_queue_init(ancs_request_queue_t *q);
+
+// Drops everything, pending and in flight (the connection is gone)
+void ancs_request_queue_clear(ancs_request_queue_t *q);
+
+// Returns false if the request is already known or the queue is full. When full, an urgent
+// request displaces the newest normal one.
+bool ancs_request_queue_push(ancs_request_queue_t *q, uint32_t uid, ancs_fetch_t fetch, bool urgent);
+
+// Forgets every notification request for 'uid', e.g. when the notification was removed before it was fetched.
+// A request already in flight keeps its slot until the response arrives, which is then reported as unwanted.
+void ancs_request_queue_cancel(ancs_request_queue_t *q, uint32_t uid);
+
+// Moves the next pending request in flight if a slot is free. The caller writes it to the Control Point
+// at 'now_ms', which starts its timeout.
+bool ancs_request_queue_next(ancs_request_queue_t *q, uint32_t now_ms, ancs_request_t *req);
+
+// Takes the oldest in-flight request back if it was written at least 'max_age_ms' before 'now_ms'
+// (0 takes any). Cancelled requests are dropped on the way. Returns false if none is that old.
+bool ancs_request_queue_take_stale(ancs_request_queue_t *q, uint32_t now_ms, uint32_t max_age_ms, ancs_request_t *req);
+
+// Queues a request taken back from flight again, ahead of the others of its priority. Returns false,
+// dropping it, once it was written ANCS_REQUEST_MAX_ATTEMPTS times or if the queue is full.
+bool ancs_request_queue_retry(ancs_request_queue_t *q, const ancs_request_t *req);
+
+// Result of the oldest unconfirmed Control Point write. A failed request is dropped
+// and returned through 'req'.
+bool ancs_request_queue_write_result(ancs_request_queue_t *q, bool ok, ancs_request_t *req);
+
+// A response for 'uid' arrived, 'fetch' tells what it was asked for (ANCS_FETCH_HEADER if it
+// was not requested). Returns false if it was not requested or has been cancelled.
+bool ancs_request_queue_complete(ancs_request_queue_t *q, uint32_t uid, ancs_fetch_t *fetch);
+
+// An app response arrived, returns false if it was not requested
+bool ancs_request_queue_complete_app(ancs_request_queue_t *q, uint32_t key);
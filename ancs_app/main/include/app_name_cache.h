@@ -0,0 +1,38 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/*
+    Display names of apps by bundle identifier, filled from Get App Attributes responses.
+    The least recently used name makes room for a new one. The cache is written to NVS whenever
+    a name arrives and loaded again at boot, so apps seen before cost no request at all.
+    Only used from the ANCS worker task.
+*/
+#define APP_NAME_CACHE_SIZE     16
+#define APP_NAME_ID_LEN         64  // Bundle identifier including the terminator
+#define APP_NAME_LEN            32
+#define APP_NAME_CACHE_NVS_KEY  "app_names"
+
+esp_err_t app_name_cache_init(void);
+
+// Key the request queue tracks a fetch under
+uint32_t app_name_cache_key(const char *app_id);
+
+// Copies the display name of 'app_id' if it is known. Otherwise reserves an entry for it, returns false
+// and sets *fetch if no request is outstanding for it yet.
+bool app_name_cache_lookup(const char *app_id, char *name, size_t name_size, bool *fetch);
+
+// Identifier of the entry a fetch was queued for, NULL if it is not waiting anymore
+const char *app_name_cache_pending_id(uint32_t key);
+
+// Stores the name from a response and persists the cache
+void app_name_cache_set(const char *app_id, const char *name);
+
+// The request for 'key' failed, the next notification of that app tries again
+void app_name_cache_fetch_failed(uint32_t key);
+
+// Forgets every outstanding fetch, the connection is gone
+void app_name_cache_abort_fetches(void);
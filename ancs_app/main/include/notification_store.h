@@ -0,0 +1,54 @@
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "ancs_app.h"
+
+/*
+    Notifications currently known, looked up by NotificationUID.
+    Slots are linked into a ring in arrival order, an open-addressing hash table (linear probing,
+    backward-shift deletion) maps UIDs to slots. Insert, lookup and remove are O(1); when every slot
+    is taken the oldest notification makes room for the new one.
+    The text of all notifications shares one compacting arena of NOTIFICATION_TEXT_ARENA_SIZE bytes.
+    Slots and text are allocated with NOTIFICATION_STORE_CAPS, use MALLOC_CAP_INTERNAL to keep them out of PSRAM.
+
+    The ANCS worker task is the only writer. It holds notification_store_lock() while it changes a notification or
+    its text (text may move on any allocation), other tasks hold it while they read. The lock is taken after
+    the LVGL lock, never call into the UI while holding it.
+*/
+#define NOTIFICATION_STORE_CAPS         (MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT)
+#define NOTIFICATION_TEXT_ARENA_SIZE    (64 * 1024)
+
+typedef struct
+{
+    uint16_t capacity;
+    uint16_t count;
+    uint32_t inserted;
+    uint32_t removed;   // Removed by the phone
+    uint32_t evicted;   // Replaced by a newer notification
+} notification_store_stats_t;
+
+esp_err_t notification_store_init(uint16_t capacity, size_t text_size, uint32_t caps);
+void notification_store_clear(void);
+
+void notification_store_lock(void);
+void notification_store_unlock(void);
+
+NotificationAttributes *notification_store_find(uint32_t uid);
+
+// Returns an empty slot for a UID that is not stored yet, or its current slot if it is. If the store
+// was full, the oldest notification is dropped first and its UID written to 'evicted_uid' (may be NULL).
+NotificationAttributes *notification_store_insert(uint32_t uid, bool *evicted, uint32_t *evicted_uid);
+
+bool notification_store_remove(uint32_t uid);
+
+// Gives the text of a stored notification back to the arena, all fields become empty strings
+void notification_store_release_text(NotificationAttributes *notification);
+
+// Calls 'fn' for every stored notification, oldest first. The store must not be changed from 'fn'.
+void notification_store_for_each(void (*fn)(NotificationAttributes *notification, void *ctx), void *ctx);
+
+uint16_t notification_store_count(void);
+void notification_store_get_stats(notification_store_stats_t *stats);
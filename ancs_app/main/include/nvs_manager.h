@@ -9,5 +9,7 @@
 esp_err_t nvs_manager_init(void);
 esp_err_t nvs_manager_store_string(const char *key, const char *value);
 esp_err_t nvs_manager_get_string(const char *key, char *buffer, size_t buffer_size);
+esp_err_t nvs_manager_store_blob(const char *key, const void *value, size_t length);
+esp_err_t nvs_manager_get_blob(const char *key, void *buffer, size_t *length); // *length: buffer size in, blob size out
 esp_err_t nvs_manager_erase_key(const char *key);
 esp_err_t nvs_manager_erase_all(void);
\ No newline at end of file
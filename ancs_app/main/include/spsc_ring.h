@@ -0,0 +1,58 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+/*
+    Lock-free ring of variable-length records between exactly one producer and one consumer task.
+    Records are stored contiguously behind a small header, a record that does not fit before the
+    end of the buffer starts over at offset 0. The consumer reads records in place and releases
+    them with spsc_ring_pop(), nothing is copied twice.
+*/
+#define SPSC_RING_ALIGN 4
+
+typedef struct
+{
+    uint16_t len;   // Payload bytes
+    uint8_t type;
+    uint8_t reserved;
+    uint32_t stamp; // Set by the producer, e.g. the enqueue time
+} spsc_record_header_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint16_t len;
+    uint32_t stamp;
+    const uint8_t *data;    // Valid until spsc_ring_pop()
+} spsc_record_t;
+
+typedef struct
+{
+    uint8_t *buf;
+    uint32_t size;
+    _Atomic uint32_t head;  // Next write offset, only moved by the producer
+    _Atomic uint32_t tail;  // Next read offset, only moved by the consumer
+} spsc_ring_t;
+
+// 'size' is rounded down to SPSC_RING_ALIGN, 'buf' must be aligned to it
+void spsc_ring_init(spsc_ring_t *r, void *buf, size_t size);
+
+// Producer side. Returns false if the record does not fit right now.
+bool spsc_ring_push(spsc_ring_t *r, uint8_t type, const void *data, uint16_t len, uint32_t stamp);
+
+// Consumer side. Peek at the oldest record, then release it.
+bool spsc_ring_peek(spsc_ring_t *r, spsc_record_t *rec);
+void spsc_ring_pop(spsc_ring_t *r);
+
+// Bytes in use, approximate when called while the other side is active
+uint32_t spsc_ring_used(const spsc_ring_t *r);
+
+// Offset the producer writes the next record at. Once spsc_ring_read_pos() returns the same value,
+// every record pushed before it was taken has been popped and none pushed after it yet.
+uint32_t spsc_ring_write_pos(const spsc_ring_t *r);
+
+// Offset the consumer reads the next record from
+uint32_t spsc_ring_read_pos(const spsc_ring_t *r);
@@ -33,6 +33,7 @@
 #define BOARD_BAT_ADC (13)
 #define BOARD_VIBRATION_PIN (38)
 #define DEFAULT_SCK_SPEED (70 * 1000 * 1000)
+#define LCD_DRAW_BUFF_HEIGHT (42) // Lines per LVGL draw stripe, 126 / 42 = 3 stripes for a full redraw
 
 #define BOARD_MIC_CLOCK (6)
 #define BOARD_MIC_DATA (5)
@@ -41,12 +42,47 @@
 #define GlassViewableWidth 126
 #define GlassViewableHeight 126
 
+// Notification tile layout
+#define NOTIFICATION_TITLE_MAX_LEN 64 // The title scrolls on a single line
+#define NOTIFICATION_MSG_WIDTH 100
+#define NOTIFICATION_MSG_HEIGHT 100
+#define NOTIFICATION_VIEW_TILES 3 // Tiles materialised at once: the active one and its neighbours
+#define NOTIFICATION_TILE_TITLE_SIZE 128 // Label text of a pooled tile: app name, ": " and title
+#define NOTIFICATION_TILE_MSG_SIZE 256   // Also caps the message budget
+
+#define DISPLAY_FLUSH_HIST_BUCKETS 8
+#define DISPLAY_FLUSH_HIST_BASE_US 250 // Bucket i counts durations below 250 << i us, the last one everything longer
+
+typedef struct
+{
+    uint32_t flushes;
+    uint32_t flush_hist[DISPLAY_FLUSH_HIST_BUCKETS]; // Flush handed to the driver until its DMA transfer completed
+    uint32_t wait_hist[DISPLAY_FLUSH_HIST_BUCKETS];  // Time LVGL spent blocked on an unfinished flush
+} display_flush_stats_t;
+
+typedef struct
+{
+    uint32_t posted;
+    uint32_t coalesced;     // Status updates replaced before they were applied, commands lost to a full queue
+    uint32_t resyncs;       // Views rebuilt from the notification store after commands were lost
+} ui_command_stats_t;
+
 extern lv_obj_t *base_ui;
 extern lv_timer_t *base_timer;
 extern lv_color_t font_color;
 extern lv_color_t bg_color;
 
 esp_err_t init_tglass();
-void add_tile_view(int index, NotificationAttributes *notification);
+void display_get_flush_stats(display_flush_stats_t *stats);
+// Panel brightness and power, the battery load estimate follows both
+void display_set_brightness(uint8_t level);
+esp_err_t display_set_power(bool on);
+void lv_gui_get_text_budget(uint16_t *title_len, uint16_t *message_len);
+
+// The lv_gui_post_* calls and lv_gui_ble_status() never block, the LVGL task applies them shortly after.
+// Notifications are read from the notification store at that point.
+void lv_gui_post_notification(uint32_t NotificationUID, notification_event_t event);
+void lv_gui_post_removed(uint32_t NotificationUID);
 void lv_gui_ble_status(bool isOn);
+void lv_gui_get_command_stats(ui_command_stats_t *stats);
 void lv_gui_set_inbox_title(int notification_count);
\ No newline at end of file
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+/*
+    Compacting arena for variable-length strings.
+    Every string has exactly one owner, the 'const char *' field that points at it. Blocks are handed
+    out from the end of the used area; when that runs out, live blocks are slid down over the freed
+    ones and their owners are updated through a back-pointer kept in each block header. Owners must
+    therefore stay at a fixed address while they hold a string, and the text may move on any later
+    text_arena_alloc() call.
+*/
+typedef struct
+{
+    uint32_t size;          // Arena capacity in bytes
+    uint32_t used;          // End of the allocated area, including freed blocks not yet compacted
+    uint32_t live;          // Bytes in blocks that still have an owner, headers included
+    uint32_t high_water;    // Largest 'live' seen
+    uint32_t blocks;        // Live blocks
+    uint32_t compactions;
+    uint32_t failures;      // Allocations that did not fit even after compaction
+} text_arena_stats_t;
+
+// The string owners point at when they hold nothing
+extern const char text_arena_empty[];
+
+esp_err_t text_arena_init(size_t size, uint32_t caps);
+
+// Releases the string held by 'owner', then reserves 'len' bytes for it and stores their address
+// in *owner. Returns NULL and leaves *owner at text_arena_empty if the arena is full.
+char *text_arena_alloc(const char **owner, size_t len);
+
+// Releases the string held by 'owner' (if any) and points it at text_arena_empty
+void text_arena_free(const char **owner);
+
+// Frees everything at once; owners are not touched and must be reset by the caller
+void text_arena_reset(void);
+
+void text_arena_get_stats(text_arena_stats_t *stats);
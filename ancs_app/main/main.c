@@ -6,20 +6,33 @@
 #include "nvs_manager.h"
 #include "t_glass.h"
 #include "ancs_app.h"
+#include "notification_store.h"
 
 #define TAG "[Glass Main]"
 
-void notification_received_callback(NotificationAttributes *notification)
+void notification_received_callback(NotificationAttributes *notification, notification_event_t event)
 {
+    if (event != NOTIFICATION_ADDED)
+    {
+        lv_gui_post_notification(notification->NotificationUID, event);
+        return;
+    }
+
     ESP_LOGI(TAG, "New Notification Received:");
-    ESP_LOGI(TAG, "Index: %d", (int)notification_index);
+    ESP_LOGI(TAG, "Stored: %d", (int)notification_store_count());
     ESP_LOGI(TAG, "UID: %d", (int)notification->NotificationUID);
     ESP_LOGI(TAG, "Identifier: %s", notification->Identifier);
+    ESP_LOGI(TAG, "App: %s", notification->AppName);
     ESP_LOGI(TAG, "Title: %s", notification->Title);
-    ESP_LOGI(TAG, "Subtitle: %s", notification->Subtitle);
-    ESP_LOGI(TAG, "Message: %s", notification->Message);
+    ESP_LOGI(TAG, "Date: %s", notification->Date);
 
-    add_tile_view(notification_index, notification);
+    lv_gui_post_notification(notification->NotificationUID, event);
+}
+
+void notification_removed_callback(uint32_t NotificationUID)
+{
+    ESP_LOGI(TAG, "Notification Removed, UID: %d", (int)NotificationUID);
+    lv_gui_post_removed(NotificationUID);
 }
 
 void app_main(void)
@@ -41,5 +54,5 @@ void app_main(void)
 
     ESP_LOGI(TAG, "[Pass] T-Glass Init");
 
-    ancs_app(notification_received_callback);
+    ancs_app(notification_received_callback, notification_removed_callback);
 }
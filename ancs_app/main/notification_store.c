@@ -0,0 +1,269 @@
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "notification_store.h"
+#include "text_arena.h"
+
+#define TAG "[Notification Store]"
+
+#define NO_SLOT 0xFFFF
+
+static NotificationAttributes *slots = NULL;
+static uint16_t *newer = NULL;  // Ring of live slots in arrival order, doubles as the free list
+static uint16_t *older = NULL;
+static uint16_t *table = NULL;  // Slot index per bucket, NO_SLOT if empty
+static uint8_t table_bits;
+static uint16_t table_mask;
+static uint16_t oldest = NO_SLOT;
+static uint16_t free_slot = NO_SLOT;
+static notification_store_stats_t stats;
+static SemaphoreHandle_t store_lock = NULL;
+
+static inline uint16_t home_bucket(uint32_t uid)
+{
+    // Fibonacci hashing, UIDs are usually consecutive
+    return (uint16_t)((uid * 2654435761u) >> (32 - table_bits));
+}
+
+// Finds the bucket holding 'uid', or the empty bucket where it would go
+static bool lookup(uint32_t uid, uint16_t *bucket)
+{
+    uint16_t i = home_bucket(uid);
+    while (table[i] != NO_SLOT)
+    {
+        if (slots[table[i]].NotificationUID == uid)
+        {
+            *bucket = i;
+            return true;
+        }
+        i = (i + 1) & table_mask;
+    }
+    *bucket = i;
+    return false;
+}
+
+static void table_delete(uint16_t i)
+{
+    // Move later entries of the probe sequence back so no tombstones are needed
+    uint16_t j = i;
+    for (;;)
+    {
+        j = (j + 1) & table_mask;
+        if (table[j] == NO_SLOT)
+        {
+            break;
+        }
+        uint16_t k = home_bucket(slots[table[j]].NotificationUID);
+        // The entry at j may fill the hole at i unless its home lies cyclically in (i, j]
+        bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays)
+        {
+            table[i] = table[j];
+            i = j;
+        }
+    }
+    table[i] = NO_SLOT;
+}
+
+static void ring_unlink(uint16_t s)
+{
+    if (newer[s] == s)
+    {
+        oldest = NO_SLOT;
+    }
+    else
+    {
+        newer[older[s]] = newer[s];
+        older[newer[s]] = older[s];
+        if (oldest == s)
+        {
+            oldest = newer[s];
+        }
+    }
+}
+
+static void ring_append(uint16_t s)
+{
+    if (oldest == NO_SLOT)
+    {
+        oldest = s;
+        newer[s] = older[s] = s;
+        return;
+    }
+    uint16_t newest = older[oldest];
+    newer[newest] = s;
+    older[s] = newest;
+    newer[s] = oldest;
+    older[oldest] = s;
+}
+
+void notification_store_release_text(NotificationAttributes *notification)
+{
+    text_arena_free(&notification->Identifier);
+    text_arena_free(&notification->AppName);
+    text_arena_free(&notification->Title);
+    text_arena_free(&notification->Subtitle);
+    text_arena_free(&notification->Message);
+    text_arena_free(&notification->Date);
+}
+
+static void release_slot(uint16_t bucket)
+{
+    uint16_t s = table[bucket];
+    notification_store_release_text(&slots[s]);
+    table_delete(bucket);
+    ring_unlink(s);
+    newer[s] = free_slot;
+    free_slot = s;
+    stats.count--;
+}
+
+esp_err_t notification_store_init(uint16_t capacity, size_t text_size, uint32_t caps)
+{
+    if (capacity == 0 || capacity >= NO_SLOT / 2)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // At most half the buckets in use keeps probe sequences short
+    table_bits = 1;
+    while ((1u << table_bits) < 2u * capacity)
+    {
+        table_bits++;
+    }
+
+    slots = heap_caps_calloc(capacity, sizeof(NotificationAttributes), caps);
+    newer = heap_caps_calloc(capacity, sizeof(uint16_t), caps);
+    older = heap_caps_calloc(capacity, sizeof(uint16_t), caps);
+    table = heap_caps_calloc(1u << table_bits, sizeof(uint16_t), caps);
+    if (!slots || !newer || !older || !table)
+    {
+        ESP_LOGE(TAG, "Failed to allocate %d slots", capacity);
+        heap_caps_free(slots);
+        heap_caps_free(newer);
+        heap_caps_free(older);
+        heap_caps_free(table);
+        slots = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+
+    store_lock = xSemaphoreCreateMutex();
+    if (store_lock == NULL || text_arena_init(text_size, caps) != ESP_OK)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    table_mask = (1u << table_bits) - 1;
+    memset(&stats, 0, sizeof(stats));
+    stats.capacity = capacity;
+    notification_store_clear();
+    ESP_LOGI(TAG, "%d slots, %d buckets", capacity, table_mask + 1);
+    return ESP_OK;
+}
+
+void notification_store_clear(void)
+{
+    memset(table, 0xFF, (table_mask + 1) * sizeof(uint16_t));
+    for (uint16_t s = 0; s < stats.capacity; s++)
+    {
+        newer[s] = (s + 1 < stats.capacity) ? s + 1 : NO_SLOT;
+    }
+    free_slot = 0;
+    oldest = NO_SLOT;
+    stats.count = 0;
+    text_arena_reset();
+}
+
+void notification_store_lock(void)
+{
+    xSemaphoreTake(store_lock, portMAX_DELAY);
+}
+
+void notification_store_unlock(void)
+{
+    xSemaphoreGive(store_lock);
+}
+
+NotificationAttributes *notification_store_find(uint32_t uid)
+{
+    uint16_t bucket;
+    return lookup(uid, &bucket) ? &slots[table[bucket]] : NULL;
+}
+
+NotificationAttributes *notification_store_insert(uint32_t uid, bool *evicted, uint32_t *evicted_uid)
+{
+    uint16_t bucket;
+    *evicted = false;
+    if (lookup(uid, &bucket))
+    {
+        return &slots[table[bucket]];
+    }
+
+    if (free_slot == NO_SLOT)
+    {
+        uint32_t victim = slots[oldest].NotificationUID;
+        uint16_t victim_bucket;
+        lookup(victim, &victim_bucket);
+        release_slot(victim_bucket);
+        stats.evicted++;
+        *evicted = true;
+        if (evicted_uid)
+        {
+            *evicted_uid = victim;
+        }
+        // Deleting may have shifted the bucket found for the new UID
+        lookup(uid, &bucket);
+    }
+
+    uint16_t s = free_slot;
+    free_slot = newer[s];
+    slots[s].NotificationUID = uid;
+    slots[s].Identifier = text_arena_empty;
+    slots[s].AppName = text_arena_empty;
+    slots[s].Title = text_arena_empty;
+    slots[s].Subtitle = text_arena_empty;
+    slots[s].Message = text_arena_empty;
+    slots[s].Date = text_arena_empty;
+    table[bucket] = s;
+    ring_append(s);
+    stats.count++;
+    stats.inserted++;
+    return &slots[s];
+}
+
+bool notification_store_remove(uint32_t uid)
+{
+    uint16_t bucket;
+    if (!lookup(uid, &bucket))
+    {
+        return false;
+    }
+    release_slot(bucket);
+    stats.removed++;
+    return true;
+}
+
+void notification_store_for_each(void (*fn)(NotificationAttributes *notification, void *ctx), void *ctx)
+{
+    if (stats.count == 0)
+    {
+        return;
+    }
+    uint16_t s = oldest;
+    for (uint16_t i = 0; i < stats.count; i++)
+    {
+        fn(&slots[s], ctx);
+        s = newer[s];
+    }
+}
+
+uint16_t notification_store_count(void)
+{
+    return stats.count;
+}
+
+void notification_store_get_stats(notification_store_stats_t *out)
+{
+    *out = stats;
+}
@@ -74,6 +74,55 @@ esp_err_t nvs_manager_get_string(const char *key, char *buffer, size_t buffer_si
     return err;
 }
 
+esp_err_t nvs_manager_store_blob(const char *key, const void *value, size_t length)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READWRITE, &nvs_handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_set_blob(nvs_handle, key, value, length);
+        if (err == ESP_OK)
+        {
+            nvs_commit(nvs_handle);
+            ESP_LOGI(TAG, "Blob of %d bytes stored successfully under key '%s'.", (int)length, key);
+        }
+        else
+        {
+            ESP_LOGE(TAG, "Failed to store blob under key '%s': %s", key, esp_err_to_name(err));
+        }
+        nvs_close(nvs_handle);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
+esp_err_t nvs_manager_get_blob(const char *key, void *buffer, size_t *length)
+{
+    nvs_handle_t nvs_handle;
+    esp_err_t err = nvs_open(NVS_NAMESPACE, NVS_READONLY, &nvs_handle);
+    if (err == ESP_OK)
+    {
+        err = nvs_get_blob(nvs_handle, key, buffer, length);
+        if (err == ESP_OK)
+        {
+            ESP_LOGI(TAG, "Blob retrieved from NVS using key '%s'.", key);
+        }
+        else
+        {
+            ESP_LOGW(TAG, "Blob not found in NVS under key '%s': %s", key, esp_err_to_name(err));
+        }
+        nvs_close(nvs_handle);
+    }
+    else
+    {
+        ESP_LOGE(TAG, "Failed to open NVS: %s", esp_err_to_name(err));
+    }
+    return err;
+}
+
 esp_err_t nvs_manager_erase_key(const char *key)
 {
     nvs_handle_t nvs_handle;
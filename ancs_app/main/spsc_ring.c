@@ -0,0 +1,120 @@
+#include <string.h>
+#include "spsc_ring.h"
+
+#define WRAP_MARKER 0xFFFF // Header length of the filler that sends the consumer back to offset 0
+
+static inline uint32_t record_size(uint16_t len)
+{
+    return (sizeof(spsc_record_header_t) + len + SPSC_RING_ALIGN - 1) & ~(uint32_t)(SPSC_RING_ALIGN - 1);
+}
+
+void spsc_ring_init(spsc_ring_t *r, void *buf, size_t size)
+{
+    r->buf = buf;
+    r->size = size & ~(size_t)(SPSC_RING_ALIGN - 1);
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+}
+
+bool spsc_ring_push(spsc_ring_t *r, uint8_t type, const void *data, uint16_t len, uint32_t stamp)
+{
+    if (len == WRAP_MARKER)
+    {
+        return false;
+    }
+
+    uint32_t need = record_size(len);
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    uint32_t pos;
+
+    // head == tail means empty, so a write may never make them meet
+    if (head >= tail)
+    {
+        uint32_t to_end = r->size - head;
+        if (need < to_end || (need == to_end && tail != 0))
+        {
+            pos = head;
+        }
+        else if (need < tail)
+        {
+            ((spsc_record_header_t *)&r->buf[head])->len = WRAP_MARKER;
+            pos = 0;
+        }
+        else
+        {
+            return false;
+        }
+    }
+    else if (need < tail - head)
+    {
+        pos = head;
+    }
+    else
+    {
+        return false;
+    }
+
+    spsc_record_header_t *hdr = (spsc_record_header_t *)&r->buf[pos];
+    hdr->len = len;
+    hdr->type = type;
+    hdr->reserved = 0;
+    hdr->stamp = stamp;
+    if (len > 0)
+    {
+        memcpy(hdr + 1, data, len);
+    }
+
+    uint32_t next = pos + need;
+    atomic_store_explicit(&r->head, (next == r->size) ? 0 : next, memory_order_release);
+    return true;
+}
+
+bool spsc_ring_peek(spsc_ring_t *r, spsc_record_t *rec)
+{
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    if (tail == head)
+    {
+        return false;
+    }
+
+    const spsc_record_header_t *hdr = (const spsc_record_header_t *)&r->buf[tail];
+    if (hdr->len == WRAP_MARKER)
+    {
+        // The producer published the record at offset 0 together with the marker
+        atomic_store_explicit(&r->tail, 0, memory_order_release);
+        hdr = (const spsc_record_header_t *)r->buf;
+    }
+
+    rec->type = hdr->type;
+    rec->len = hdr->len;
+    rec->stamp = hdr->stamp;
+    rec->data = (const uint8_t *)(hdr + 1);
+    return true;
+}
+
+void spsc_ring_pop(spsc_ring_t *r)
+{
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    const spsc_record_header_t *hdr = (const spsc_record_header_t *)&r->buf[tail];
+    uint32_t next = tail + record_size(hdr->len);
+    atomic_store_explicit(&r->tail, (next == r->size) ? 0 : next, memory_order_release);
+}
+
+uint32_t spsc_ring_write_pos(const spsc_ring_t *r)
+{
+    return atomic_load_explicit(&r->head, memory_order_relaxed);
+}
+
+uint32_t spsc_ring_read_pos(const spsc_ring_t *r)
+{
+    return atomic_load_explicit(&r->tail, memory_order_relaxed);
+}
+
+uint32_t spsc_ring_used(const spsc_ring_t *r)
+{
+    uint32_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    uint32_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    return (head >= tail) ? head - tail : r->size - tail + head;
+}
@@ -1,9 +1,15 @@
 #include "t_glass.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
 #include "touch_element/touch_button.h"
 #include "battery_measurement.h"
 #include "esp_timer.h" // For getting timestamps
 #include "esp_log.h"
+#include <inttypes.h>
+#include <stdlib.h>
 #include "ancs_app.h"
+#include "ancs_protocol.h"
+#include "notification_store.h"
 
 #define TOUCH_BUTTON_NUM 1
 #define DOUBLE_TAP_THRESHOLD_MS 300 // Define a threshold for double-tap detection (e.g., 300 ms)
@@ -11,6 +17,9 @@
 
 static void lv_gui_goto_last_tile();
 static void lv_gui_goto_next_tile();
+static void tile_changed_event_cb(lv_event_t *e);
+static void tile_pool_init(void);
+static void ui_command_timer_fn(lv_timer_t *timer);
 
 // Define the variables
 lv_obj_t *base_ui = NULL;
@@ -35,6 +44,60 @@ static bool first_press = true;
 
 static int64_t last_call_time = 0; // Stores the timestamp of the last call
 
+// Notifications in column order, column i (1..last_tile_index) shows view_list[i - 1]
+typedef struct
+{
+    uint32_t uid;
+    bool message_shown; // The fetched message is in the store, nothing to request
+} notification_view_t;
+
+// Only the active column and its neighbours are materialised, on NOTIFICATION_VIEW_TILES tiles built once by
+// tile_pool_init() and rebound from the notification store as the view moves. Labels point at copies of the
+// text kept in the tile (lv_label_set_text_static), so binding allocates nothing and the store may move its text.
+typedef struct
+{
+    int col;            // Column the tile stands in, 0 while it is parked
+    lv_obj_t *tile;
+    lv_obj_t *title;
+    lv_obj_t *msg;
+    char title_text[NOTIFICATION_TILE_TITLE_SIZE];
+    char msg_text[NOTIFICATION_TILE_MSG_SIZE];
+} notification_tile_t;
+
+static notification_view_t view_list[MAX_NOTIFICATIONS];
+static notification_tile_t tile_pool[NOTIFICATION_VIEW_TILES];
+static lv_style_t style_tile;
+static lv_style_t style_title;
+static lv_style_t style_msg;
+static lv_style_t style_line;
+
+// Commands posted by the ANCS worker, applied by ui_command_timer_fn() on the LVGL task so producers never wait
+// for the LVGL lock. Notification commands keep their order and are resolved against the notification store
+// when applied. The connection status is a single slot that keeps only the latest value. If the queue
+// overflows, the pending commands are dropped and the view is rebuilt from the store instead.
+#define UI_COMMAND_QUEUE_LEN 32
+#define UI_COMMAND_PERIOD_MS 20
+
+typedef enum
+{
+    UI_CMD_NOTIFICATION = 0,    // Added or changed, see 'event'
+    UI_CMD_REMOVED,
+    UI_CMD_CLEAR,               // Disconnected, every notification is gone
+} ui_command_type_t;
+
+typedef struct
+{
+    uint8_t type;
+    uint8_t event;              // notification_event_t
+    uint32_t uid;
+} ui_command_t;
+
+static QueueHandle_t ui_command_queue = NULL;
+static portMUX_TYPE ui_command_lock = portMUX_INITIALIZER_UNLOCKED;
+static int pending_ble_status = -1; // -1 if unchanged
+static bool pending_resync = false;
+static ui_command_stats_t ui_stats;
+
 bool can_execute_function()
 {
     int64_t current_time = esp_timer_get_time();   // Get the current time in microseconds
@@ -62,6 +125,153 @@ static const float channel_sens_array[TOUCH_BUTTON_NUM] = {
 esp_lcd_panel_io_handle_t io_handle = NULL;
 esp_lcd_panel_handle_t panel_handle = NULL;
 
+#define DISPLAY_STATS_INTERVAL_S 10
+#define BATTERY_HYSTERESIS_MV 20 // Two steps of the last digit shown
+
+// Refresh timing, only touched from the LVGL task
+static int64_t refr_start_time;
+static bool refr_rendered;
+static uint32_t refr_count;
+static int64_t refr_total_us;
+static int64_t refr_max_us;
+static uint32_t refr_idle;          // Refreshes that found nothing invalidated
+static uint32_t label_updates;      // Status label texts that changed and were redrawn
+static uint32_t label_skips;        // Status label texts that were already on screen
+
+// Per-flush timing. flush_start_time is written by the LVGL task, the histograms by the SPI done ISR and the LVGL task.
+static volatile int64_t flush_start_time;
+static volatile int64_t wait_start_time;
+static volatile uint32_t flush_busy_us; // SPI transfer time since the last stats report
+static display_flush_stats_t flush_stats;
+
+static int flush_hist_bucket(int64_t us)
+{
+    int bucket = 0;
+    for (int64_t limit = DISPLAY_FLUSH_HIST_BASE_US; us >= limit && bucket < DISPLAY_FLUSH_HIST_BUCKETS - 1; limit <<= 1)
+    {
+        bucket++;
+    }
+    return bucket;
+}
+
+// Runs in the SPI interrupt once the last color transfer of a flush left the DMA, the draw buffer is free again
+static bool display_flush_done_cb(esp_lcd_panel_io_handle_t io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
+{
+    int64_t elapsed = esp_timer_get_time() - flush_start_time;
+    flush_stats.flush_hist[flush_hist_bucket(elapsed)]++;
+    flush_busy_us += elapsed;
+    lv_display_flush_ready((lv_display_t *)user_ctx);
+    return false;
+}
+
+// FLUSH_START: the area was handed to the driver. FLUSH_WAIT_*: LVGL has nothing left to render and blocks on
+// the transfer, so a short wait histogram means rendering and SPI overlap well.
+static void display_flush_event_cb(lv_event_t *e)
+{
+    switch (lv_event_get_code(e))
+    {
+    case LV_EVENT_FLUSH_START:
+        flush_start_time = esp_timer_get_time();
+        flush_stats.flushes++;
+        break;
+    case LV_EVENT_FLUSH_WAIT_START:
+        wait_start_time = esp_timer_get_time();
+        break;
+    default: // LV_EVENT_FLUSH_WAIT_FINISH
+        flush_stats.wait_hist[flush_hist_bucket(esp_timer_get_time() - wait_start_time)]++;
+        break;
+    }
+}
+
+void display_get_flush_stats(display_flush_stats_t *stats)
+{
+    *stats = flush_stats;
+}
+
+static void display_refr_event_cb(lv_event_t *e)
+{
+    switch (lv_event_get_code(e))
+    {
+    case LV_EVENT_REFR_START:
+        refr_start_time = esp_timer_get_time();
+        refr_rendered = false;
+        break;
+    case LV_EVENT_RENDER_START:
+        refr_rendered = true;
+        break;
+    default: // LV_EVENT_REFR_READY, idle refreshes that rendered nothing are not counted
+        if (refr_rendered)
+        {
+            int64_t elapsed = esp_timer_get_time() - refr_start_time;
+            refr_count++;
+            refr_total_us += elapsed;
+            if (elapsed > refr_max_us)
+                refr_max_us = elapsed;
+        }
+        else
+        {
+            refr_idle++;
+        }
+        break;
+    }
+}
+
+static void log_lvgl_heap(const char *when)
+{
+    lv_mem_monitor_t mon;
+    lv_mem_monitor(&mon);
+    ESP_LOGI(TAG, "LVGL heap %s: %" PRIu32 "/%" PRIu32 " bytes used (peak %" PRIu32 "), largest free block %" PRIu32 ", %d%% fragmented",
+             when, (uint32_t)(mon.total_size - mon.free_size), (uint32_t)mon.total_size, (uint32_t)mon.max_used,
+             (uint32_t)mon.free_biggest_size, mon.frag_pct);
+}
+
+// Frame time and the CPU the byte-order conversion costs, compare a build with and without native byte order
+static void log_display_stats(void)
+{
+    jd9613_swap_stats_t swap;
+    panel_jd9613_get_swap_stats(panel_handle, &swap);
+    uint64_t swap_cycles = swap.simd_cycles + swap.scalar_cycles;
+
+    ESP_LOGI(TAG, "Display: %" PRIu32 " frames, avg %" PRId64 " us, max %" PRId64 " us, byte order: %s, swap %" PRIu64 " cycles/frame (simd %.2f, scalar %.2f cycles/px)",
+             refr_count, refr_count ? refr_total_us / refr_count : 0, refr_max_us,
+             panel_jd9613_get_byte_order(panel_handle) == JD9613_BYTE_ORDER_NATIVE ? "native" : "swapped",
+             refr_count ? swap_cycles / refr_count : 0,
+             swap.simd_pixels ? (double)swap.simd_cycles / swap.simd_pixels : 0.0,
+             swap.scalar_pixels ? (double)swap.scalar_cycles / swap.scalar_pixels : 0.0);
+
+    // Share of the interval spent rendering and sending pixels, both drop to zero while nothing changes
+    const int64_t interval_us = DISPLAY_STATS_INTERVAL_S * 1000000LL;
+    ESP_LOGI(TAG, "Idle: %" PRIu32 " refreshes with nothing to draw, render duty %.1f%%, SPI duty %.1f%%, status labels: %" PRIu32 " redrawn, %" PRIu32 " unchanged",
+             refr_idle, 100.0 * refr_total_us / interval_us, 100.0 * flush_busy_us / interval_us, label_updates, label_skips);
+
+    refr_count = 0;
+    refr_total_us = 0;
+    refr_max_us = 0;
+    refr_idle = 0;
+    flush_busy_us = 0;
+    label_updates = 0;
+    label_skips = 0;
+
+    char flush_line[DISPLAY_FLUSH_HIST_BUCKETS * 11 + 1];
+    char wait_line[DISPLAY_FLUSH_HIST_BUCKETS * 11 + 1];
+    int flush_len = 0, wait_len = 0;
+    for (int i = 0; i < DISPLAY_FLUSH_HIST_BUCKETS; i++)
+    {
+        flush_len += snprintf(&flush_line[flush_len], sizeof(flush_line) - flush_len, " %" PRIu32, flush_stats.flush_hist[i]);
+        wait_len += snprintf(&wait_line[wait_len], sizeof(wait_line) - wait_len, " %" PRIu32, flush_stats.wait_hist[i]);
+    }
+    ESP_LOGI(TAG, "Flushes: %" PRIu32 ", duration histogram (from %d us, x2 per bucket):%s, render blocked:%s",
+             flush_stats.flushes, DISPLAY_FLUSH_HIST_BASE_US, flush_line, wait_line);
+
+    // Stays flat while notifications come and go, tiles are recycled
+    log_lvgl_heap("in use");
+
+    ui_command_stats_t commands;
+    lv_gui_get_command_stats(&commands);
+    ESP_LOGI(TAG, "UI commands: %" PRIu32 " posted, %" PRIu32 " coalesced, %" PRIu32 " resyncs",
+             commands.posted, commands.coalesced, commands.resyncs);
+}
+
 esp_err_t initialize_spi_bus()
 {
     ESP_LOGI(TAG, "Initialize SPI bus");
@@ -72,7 +282,7 @@ esp_err_t initialize_spi_bus()
         .quadwp_io_num = BOARD_NONE_PIN,
         .quadhd_io_num = BOARD_NONE_PIN,
         //.max_transfer_sz = JD9613_HEIGHT * 80 * sizeof(uint16_t),
-        .max_transfer_sz = JD9613_WIDTH * JD9613_HEIGHT * 2,
+        .max_transfer_sz = GlassViewableWidth * LCD_DRAW_BUFF_HEIGHT * sizeof(uint16_t),
         .data4_io_num = 0,
         .data5_io_num = 0,
         .data6_io_num = 0,
@@ -96,7 +306,7 @@ esp_err_t initialize_panel_io()
         .lcd_param_bits = 8,
         .spi_mode = 0,
         .trans_queue_depth = 10,
-        .on_color_trans_done = NULL,
+        .on_color_trans_done = NULL, // Registered once the LVGL display exists, see initialize_panel_jd9613()
         .user_ctx = NULL,
         .flags.dc_low_on_data = 0,
         .flags.octal_mode = 0,
@@ -109,6 +319,28 @@ esp_err_t initialize_panel_io()
     return esp_lcd_new_panel_io_spi((esp_lcd_spi_bus_handle_t)BOARD_DISP_HOST, &io_config, &io_handle);
 }
 
+// Panel power and brightness are changed through these two, so the battery load estimate follows them
+static bool display_on = false;
+static uint8_t display_brightness = 0;
+
+void display_set_brightness(uint8_t level)
+{
+    setBrightness(panel_handle, level);
+    display_brightness = level;
+    battery_set_display_load(display_on, level);
+}
+
+esp_err_t display_set_power(bool on)
+{
+    esp_err_t ret = esp_lcd_panel_disp_on_off(panel_handle, on);
+    if (ret == ESP_OK)
+    {
+        display_on = on;
+        battery_set_display_load(on, display_brightness);
+    }
+    return ret;
+}
+
 esp_err_t initialize_panel_jd9613()
 {
     ESP_ERROR_CHECK(initialize_spi_bus());
@@ -125,17 +357,25 @@ esp_err_t initialize_panel_jd9613()
     ESP_ERROR_CHECK(esp_lcd_panel_reset(panel_handle));
     ESP_ERROR_CHECK(esp_lcd_panel_init(panel_handle));
 
-    setBrightness(panel_handle, 255);
+    // The init sequence ends with the panel switched on
+    display_on = true;
+    display_set_brightness(255);
+
+    // Only the bottom 126x126 of the panel is visible through the glass, the rest was blanked by the
+    // panel init. LVGL renders just that window and the driver places it in panel RAM.
+    ESP_ERROR_CHECK(esp_lcd_panel_set_gap(panel_handle, 0, GlassViewable_X_Offset));
 
     /* Add LCD screen */
+    // Only invalidated areas are rendered, stripe by stripe. With two DMA-capable stripes in internal RAM
+    // LVGL renders the next one while the previous is still being sent to the panel.
     ESP_LOGI(TAG, "Add LCD screen");
     const lvgl_port_display_cfg_t disp_cfg = {
         .io_handle = io_handle,
         .panel_handle = panel_handle,
-        .buffer_size = JD9613_WIDTH * JD9613_HEIGHT,
-        .double_buffer = false,
-        .hres = JD9613_WIDTH,
-        .vres = JD9613_HEIGHT,
+        .buffer_size = GlassViewableWidth * LCD_DRAW_BUFF_HEIGHT,
+        .double_buffer = true,
+        .hres = GlassViewableWidth,
+        .vres = GlassViewableHeight,
         .monochrome = false,
         .rotation = {
             .swap_xy = false,
@@ -143,11 +383,11 @@ esp_err_t initialize_panel_jd9613()
             .mirror_y = false,
         },
         .flags = {
-            .buff_dma = false,
+            .buff_dma = true,
             .buff_spiram = false,
             .sw_rotate = true,
             .swap_bytes = false,
-            .full_refresh = true,
+            .full_refresh = false,
             .direct_mode = false,
         }};
 
@@ -157,6 +397,25 @@ esp_err_t initialize_panel_jd9613()
 
     if (disp)
     {
+        lvgl_port_lock(0);
+#if LV_VERSION_CHECK(9, 3, 0)
+        // LVGL renders big endian RGB565 itself, the driver sends its draw buffers untouched
+        lv_display_set_color_format(disp, LV_COLOR_FORMAT_RGB565_SWAPPED);
+        panel_jd9613_set_byte_order(panel_handle, JD9613_BYTE_ORDER_NATIVE);
+#endif
+        // Flushes complete from the SPI DMA done interrupt, LVGL renders the next stripe meanwhile
+        const esp_lcd_panel_io_callbacks_t cbs = {
+            .on_color_trans_done = display_flush_done_cb,
+        };
+        esp_lcd_panel_io_register_event_callbacks(io_handle, &cbs, disp);
+        lv_display_add_event_cb(disp, display_flush_event_cb, LV_EVENT_FLUSH_START, NULL);
+        lv_display_add_event_cb(disp, display_flush_event_cb, LV_EVENT_FLUSH_WAIT_START, NULL);
+        lv_display_add_event_cb(disp, display_flush_event_cb, LV_EVENT_FLUSH_WAIT_FINISH, NULL);
+
+        lv_display_add_event_cb(disp, display_refr_event_cb, LV_EVENT_REFR_START, NULL);
+        lv_display_add_event_cb(disp, display_refr_event_cb, LV_EVENT_RENDER_START, NULL);
+        lv_display_add_event_cb(disp, display_refr_event_cb, LV_EVENT_REFR_READY, NULL);
+        lvgl_port_unlock();
         return ESP_OK;
     }
 
@@ -269,28 +528,28 @@ void base_tileview(lv_obj_t *parent)
     inbox_label = lv_label_create(base_tile);
     lv_obj_set_style_text_color(inbox_label, font_color, 0);
     lv_obj_set_style_text_align(inbox_label, LV_TEXT_ALIGN_CENTER, 0);
-    lv_label_set_text(inbox_label, "Are you sure\nthere are\nno messages?");
+    lv_label_set_text_static(inbox_label, "Are you sure\nthere are\nno messages?");
     lv_obj_center(inbox_label);
     lv_obj_set_style_text_font(inbox_label, &lv_font_montserrat_14, 0);
 
     lvgl_port_unlock();
 }
 
-const char *get_battery_icon(float voltage)
+const char *get_battery_icon(int percentage)
 {
-    if (voltage >= 4.0)
+    if (percentage >= 90)
     {
         return LV_SYMBOL_BATTERY_FULL; // Full battery
     }
-    else if (voltage >= 3.85)
+    else if (percentage >= 75)
     {
         return LV_SYMBOL_BATTERY_3; // 3 bars
     }
-    else if (voltage >= 3.70)
+    else if (percentage >= 50)
     {
         return LV_SYMBOL_BATTERY_2; // 2 bars
     }
-    else if (voltage >= 3.50)
+    else if (percentage >= 10)
     {
         return LV_SYMBOL_BATTERY_1; // 1 bar
     }
@@ -300,18 +559,48 @@ const char *get_battery_icon(float voltage)
     }
 }
 
+// Sets the text only if the label shows something else, an unchanged label is not invalidated
+static void label_set_text_if_changed(lv_obj_t *label, const char *text)
+{
+    if (strcmp(lv_label_get_text(label), text) == 0)
+    {
+        label_skips++;
+        return;
+    }
+    lv_label_set_text(label, text);
+    label_updates++;
+}
+
+// Runs on the LVGL task, which already holds the LVGL lock
 void sys_timer_fn(lv_timer_t *timer)
 {
-    lvgl_port_lock(0);
-    float battery_voltage = battery_measurement_read();
-    // Convert voltage to percentage
-    int battery_percentage = battery_voltage_to_percentage(battery_voltage);
-    // ESP_LOGI(TAG, "Battery Voltage: %.2f V, Battery Percentage: %d%%\n", battery_voltage, battery_percentage);
-
-    char battery_info[100];
-    snprintf(battery_info, sizeof(battery_info), "%.2fV, %d%% %s", battery_voltage, battery_percentage, get_battery_icon(battery_voltage));
-    lv_label_set_text(battery_label, battery_info);
-    lvgl_port_unlock();
+    // The sampler filters the readings already, the shown voltage only follows once the battery really moved.
+    // The percentage also moves with the load compensation, which the voltage does not show.
+    static int shown_mv = -1;
+    static int shown_percentage = -1;
+    battery_snapshot_t battery;
+    if (battery_measurement_get(&battery) &&
+        (shown_mv < 0 || abs(battery.voltage_mv - shown_mv) >= BATTERY_HYSTERESIS_MV || battery.percentage != shown_percentage))
+    {
+        shown_mv = battery.voltage_mv;
+        shown_percentage = battery.percentage;
+        int centivolts = (shown_mv + 5) / 10;
+
+        char battery_info[100];
+        snprintf(battery_info, sizeof(battery_info), "%d.%02dV, %d%% %s", centivolts / 100, centivolts % 100, battery.percentage, get_battery_icon(battery.percentage));
+        label_set_text_if_changed(battery_label, battery_info);
+    }
+    else
+    {
+        label_skips++;
+    }
+
+    static int stats_ticks = 0;
+    if (++stats_ticks >= DISPLAY_STATS_INTERVAL_S)
+    {
+        stats_ticks = 0;
+        log_display_stats();
+    }
 }
 
 esp_err_t init_tglass()
@@ -334,6 +623,13 @@ esp_err_t init_tglass()
         return ESP_FAIL;
     }
 
+    ui_command_queue = xQueueCreate(UI_COMMAND_QUEUE_LEN, sizeof(ui_command_t));
+    if (!ui_command_queue)
+    {
+        ESP_LOGE(TAG, "[Err] UI command queue setup failed");
+        return ESP_FAIL;
+    }
+
     font_color = lv_color_white();
     bg_color = lv_color_black();
 
@@ -352,69 +648,337 @@ esp_err_t init_tglass()
     lv_obj_t *t1 = lv_tileview_add_tile(base_ui, 0, 0, LV_DIR_HOR | LV_DIR_BOTTOM);
     // Create date page
     base_tileview(t1);
+    tile_pool_init();
     base_timer = lv_timer_create(sys_timer_fn, 1000, NULL);
+    lv_timer_create(ui_command_timer_fn, UI_COMMAND_PERIOD_MS, NULL);
+    lv_obj_add_event_cb(base_ui, tile_changed_event_cb, LV_EVENT_VALUE_CHANGED, NULL);
     lvgl_port_unlock();
     return ESP_OK;
 }
 
-void add_tile_view(int index, NotificationAttributes *notification)
+// Column of a notification, 0 if it has no tile
+static int find_view(uint32_t NotificationUID)
 {
-    lvgl_port_lock(0);
+    for (int i = 1; i <= last_tile_index; i++)
+    {
+        if (view_list[i - 1].uid == NotificationUID)
+        {
+            return i;
+        }
+    }
+    return 0;
+}
+
+static notification_tile_t *tile_at(int col)
+{
+    for (int i = 0; i < NOTIFICATION_VIEW_TILES; i++)
+    {
+        if (tile_pool[i].col == col)
+        {
+            return &tile_pool[i];
+        }
+    }
+    return NULL;
+}
 
-    if (++last_tile_index >= (MAX_NOTIFICATIONS + 1))
+// Messages are fetched once a notification is viewed
+static void fetch_view_message(int col, bool urgent)
+{
+    if (col >= 1 && col <= last_tile_index && !view_list[col - 1].message_shown)
+    {
+        ancs_app_fetch_message(view_list[col - 1].uid, urgent);
+    }
+}
+
+static size_t copy_label_text(char *dst, size_t dst_size, const char *src)
+{
+    return ancs_copy_text(dst, dst_size, (const uint8_t *)src, strlen(src), false);
+}
+
+// The app's display name leads the title once it is known
+static void set_tile_title(notification_tile_t *slot, const NotificationAttributes *notification)
+{
+    size_t len = 0;
+    if (notification->AppName[0] != '\0')
+    {
+        len = copy_label_text(slot->title_text, sizeof(slot->title_text), notification->AppName);
+        len += copy_label_text(&slot->title_text[len], sizeof(slot->title_text) - len, ": ");
+    }
+    copy_label_text(&slot->title_text[len], sizeof(slot->title_text) - len, notification->Title);
+    lv_label_set_text_static(slot->title, slot->title_text);
+}
+
+static void set_tile_message(notification_tile_t *slot, const NotificationAttributes *notification)
+{
+    copy_label_text(slot->msg_text, sizeof(slot->msg_text), notification->Message);
+    lv_label_set_text_static(slot->msg, slot->msg_text);
+}
+
+static void clear_tile_text(notification_tile_t *slot)
+{
+    slot->title_text[0] = '\0';
+    slot->msg_text[0] = '\0';
+    lv_label_set_text_static(slot->title, slot->title_text);
+    lv_label_set_text_static(slot->msg, slot->msg_text);
+}
+
+// Tiles out of use wait left of the home tile, where no column lookup can find them
+static void park_tile(notification_tile_t *slot)
+{
+    slot->col = 0;
+    lv_obj_add_flag(slot->tile, LV_OBJ_FLAG_HIDDEN);
+    lv_obj_set_x(slot->tile, -lv_obj_get_content_width(base_ui));
+}
+
+// Materialises the columns next to 'center' and parks the tiles that are out of reach
+static void show_view_window(int center)
+{
+    int first = (center > 1) ? center - 1 : 1;
+    int last = (center + 1 < last_tile_index) ? center + 1 : last_tile_index;
+
+    for (int i = 0; i < NOTIFICATION_VIEW_TILES; i++)
+    {
+        if (tile_pool[i].col != 0 && (tile_pool[i].col < first || tile_pool[i].col > last))
+        {
+            park_tile(&tile_pool[i]);
+        }
+    }
+
+    int32_t width = lv_obj_get_content_width(base_ui);
+    for (int col = first; col <= last; col++)
+    {
+        if (tile_at(col) != NULL)
+        {
+            continue;
+        }
+        notification_tile_t *slot = tile_at(0);
+        slot->col = col;
+
+        notification_store_lock();
+        const NotificationAttributes *notification = notification_store_find(view_list[col - 1].uid);
+        if (notification != NULL)
+        {
+            set_tile_title(slot, notification);
+            set_tile_message(slot, notification);
+        }
+        else
+        {
+            // Gone from the store, blank the text the recycled tile still holds
+            clear_tile_text(slot);
+        }
+        notification_store_unlock();
+
+        lv_obj_set_x(slot->tile, col * width);
+        lv_obj_clear_flag(slot->tile, LV_OBJ_FLAG_HIDDEN);
+    }
+}
+
+// Columns moved, every tile is bound again
+static void reset_view_window(void)
+{
+    for (int i = 0; i < NOTIFICATION_VIEW_TILES; i++)
+    {
+        park_tile(&tile_pool[i]);
+    }
+    show_view_window(current_tile_index);
+}
+
+static void tile_changed_event_cb(lv_event_t *e)
+{
+    lv_obj_t *tile = lv_tileview_get_tile_active(base_ui);
+    notification_tile_t *slot = (tile != NULL) ? lv_obj_get_user_data(tile) : NULL;
+    if (slot == NULL || slot->col == 0)
     {
-        ESP_LOGW(TAG, "add_tile_view ignored: MAX_NOTIFICATIONS reached.");
         return;
     }
-    lv_obj_t *tile = lv_tileview_add_tile(base_ui, last_tile_index, 0, LV_DIR_HOR | LV_DIR_BOTTOM);
-    ESP_LOGI(TAG, "[AA] add_tile_view(last_tile_index) : %d", (int)last_tile_index);
 
-    lv_obj_set_scroll_dir(tile, LV_DIR_NONE);
-    lv_obj_t *base_tile = lv_obj_create(tile);
-    lv_obj_set_size(base_tile, LV_PCT(100), LV_PCT(100));
-    lv_obj_set_style_bg_color(base_tile, bg_color, 0);
-    lv_obj_set_style_border_width(base_tile, 0, 0);
-    lv_obj_set_scrollbar_mode(base_tile, LV_SCROLLBAR_MODE_OFF);
-    lv_obj_set_scroll_dir(base_tile, LV_DIR_NONE);
+    show_view_window(slot->col);
+    fetch_view_message(slot->col, true);
+    // Tiles are read from the newest down, prefetch the one after this
+    fetch_view_message(slot->col - 1, false);
+}
+
+static void tile_pool_init(void)
+{
+    log_lvgl_heap("before tile pool");
+
+    lv_style_init(&style_tile);
+    lv_style_set_bg_color(&style_tile, bg_color);
+    lv_style_set_border_width(&style_tile, 0);
 
-    lv_obj_t *title = lv_label_create(base_tile);
-    lv_obj_set_style_text_color(title, font_color, 0);
-    lv_label_set_text(title, notification->Title);
-    lv_label_set_long_mode(title, LV_LABEL_LONG_SCROLL_CIRCULAR);
-    lv_obj_set_style_text_font(title, &lv_font_montserrat_14, 0);
-    lv_obj_align(title, LV_ALIGN_TOP_LEFT, 4, 8);
+    lv_style_init(&style_title);
+    lv_style_set_text_color(&style_title, font_color);
+    lv_style_set_text_font(&style_title, &lv_font_montserrat_14);
 
-    lv_obj_t *msg = lv_label_create(base_tile);
-    lv_obj_set_style_text_color(msg, font_color, 0);
-    lv_obj_set_size(msg, 100, 100);
-    lv_label_set_text(msg, notification->Message);
-    lv_obj_set_style_text_font(msg, &lv_font_montserrat_12, 0);
-    lv_obj_align(msg, LV_ALIGN_TOP_LEFT, 4, 24);
+    lv_style_init(&style_msg);
+    lv_style_set_text_color(&style_msg, font_color);
+    lv_style_set_text_font(&style_msg, &lv_font_montserrat_12);
 
     static lv_point_precise_t line_points[] = {{4, 20}, {100, 20}};
-    static lv_style_t style_line;
     lv_style_init(&style_line);
     lv_style_set_line_width(&style_line, 2);
     lv_style_set_line_color(&style_line, lv_palette_main(LV_PALETTE_BLUE));
     lv_style_set_line_rounded(&style_line, true);
 
-    /*Create a line and apply the new style*/
-    lv_obj_t *line = lv_line_create(base_tile);
-    lv_line_set_points(line, line_points, 2); /*Set the points*/
-    lv_obj_add_style(line, &style_line, 0);
-    lv_obj_align_to(line, msg, LV_ALIGN_OUT_TOP_MID, 0, 0);
+    for (int i = 0; i < NOTIFICATION_VIEW_TILES; i++)
+    {
+        notification_tile_t *slot = &tile_pool[i];
+        slot->tile = lv_tileview_add_tile(base_ui, i + 1, 0, LV_DIR_HOR | LV_DIR_BOTTOM);
+        lv_obj_set_user_data(slot->tile, slot);
+        lv_obj_set_scroll_dir(slot->tile, LV_DIR_NONE);
+
+        lv_obj_t *base_tile = lv_obj_create(slot->tile);
+        lv_obj_set_size(base_tile, LV_PCT(100), LV_PCT(100));
+        lv_obj_add_style(base_tile, &style_tile, 0);
+        lv_obj_set_scrollbar_mode(base_tile, LV_SCROLLBAR_MODE_OFF);
+        lv_obj_set_scroll_dir(base_tile, LV_DIR_NONE);
+
+        slot->title = lv_label_create(base_tile);
+        lv_obj_add_style(slot->title, &style_title, 0);
+        lv_label_set_long_mode(slot->title, LV_LABEL_LONG_SCROLL_CIRCULAR);
+        lv_label_set_text_static(slot->title, slot->title_text);
+        lv_obj_align(slot->title, LV_ALIGN_TOP_LEFT, 4, 8);
+
+        slot->msg = lv_label_create(base_tile);
+        lv_obj_add_style(slot->msg, &style_msg, 0);
+        lv_obj_set_size(slot->msg, NOTIFICATION_MSG_WIDTH, NOTIFICATION_MSG_HEIGHT);
+        lv_label_set_text_static(slot->msg, slot->msg_text);
+        lv_obj_align(slot->msg, LV_ALIGN_TOP_LEFT, 4, 24);
+
+        lv_obj_t *line = lv_line_create(base_tile);
+        lv_line_set_points(line, line_points, 2);
+        lv_obj_add_style(line, &style_line, 0);
+        lv_obj_align_to(line, slot->msg, LV_ALIGN_OUT_TOP_MID, 0, 0);
+
+        park_tile(slot);
+    }
+
+    log_lvgl_heap("after tile pool");
+}
+
+static void update_tile_view(uint32_t NotificationUID, notification_event_t event)
+{
+    int col = find_view(NotificationUID);
+    if (col == 0)
+    {
+        // Dismissed on the glasses already
+        return;
+    }
+
+    notification_view_t *view = &view_list[col - 1];
+    if (event == NOTIFICATION_MESSAGE)
+    {
+        view->message_shown = true;
+    }
+    else if (event != NOTIFICATION_APP_NAME)
+    {
+        view->message_shown = false;
+    }
+
+    notification_tile_t *slot = tile_at(col);
+    if (slot != NULL)
+    {
+        notification_store_lock();
+        const NotificationAttributes *notification = notification_store_find(NotificationUID);
+        if (notification != NULL)
+        {
+            if (event != NOTIFICATION_MESSAGE)
+            {
+                set_tile_title(slot, notification);
+            }
+            if (event != NOTIFICATION_APP_NAME)
+            {
+                set_tile_message(slot, notification);
+            }
+        }
+        notification_store_unlock();
+    }
+
+    if ((event == NOTIFICATION_ADDED || event == NOTIFICATION_MODIFIED) && col == current_tile_index)
+    {
+        fetch_view_message(col, true);
+    }
+}
+
+static void add_tile_view(uint32_t NotificationUID)
+{
+    if (find_view(NotificationUID) != 0)
+    {
+        update_tile_view(NotificationUID, NOTIFICATION_MODIFIED);
+        return;
+    }
 
+    if (last_tile_index >= MAX_NOTIFICATIONS)
+    {
+        ESP_LOGW(TAG, "add_tile_view ignored: MAX_NOTIFICATIONS reached.");
+        return;
+    }
+    view_list[last_tile_index].uid = NotificationUID;
+    view_list[last_tile_index].message_shown = false;
+    ++last_tile_index;
+    ESP_LOGI(TAG, "[AA] add_tile_view(last_tile_index) : %d", (int)last_tile_index);
+
+    // Gets a tile only if it lands next to the active column
+    show_view_window(current_tile_index);
     lv_gui_set_inbox_title(last_tile_index);
+}
 
-    lvgl_port_unlock();
+// Longest title and message worth fetching, in bytes of mostly ASCII text
+void lv_gui_get_text_budget(uint16_t *title_len, uint16_t *message_len)
+{
+    const lv_font_t *font = &lv_font_montserrat_12;
+    int32_t lines = NOTIFICATION_MSG_HEIGHT / lv_font_get_line_height(font);
+    int32_t chars_per_line = NOTIFICATION_MSG_WIDTH / lv_font_get_glyph_width(font, 'e', 0);
+
+    // Narrow glyphs fit more than the typical width suggests, keep a quarter in reserve
+    *message_len = lines * chars_per_line * 5 / 4;
+    if (*message_len > NOTIFICATION_TILE_MSG_SIZE - 1)
+    {
+        *message_len = NOTIFICATION_TILE_MSG_SIZE - 1;
+    }
+    *title_len = NOTIFICATION_TITLE_MAX_LEN;
+}
+
+// The notification leaves the list, the ones behind it move up a column
+static void remove_view(int col)
+{
+    memmove(&view_list[col - 1], &view_list[col], (last_tile_index - col) * sizeof(view_list[0]));
+    --last_tile_index;
+    lv_gui_set_inbox_title(last_tile_index);
+}
+
+static void remove_tile_view(uint32_t NotificationUID)
+{
+    int col = find_view(NotificationUID);
+    if (col == 0)
+    {
+        return;
+    }
+
+    remove_view(col);
+    ESP_LOGI(TAG, "Removed tile at index: %d", col);
+
+    if (current_tile_index > col || current_tile_index > last_tile_index)
+    {
+        --current_tile_index;
+    }
+    if (current_tile_index == 0)
+    {
+        first_press = true;
+    }
+    reset_view_window();
+    lv_obj_set_tile_id(base_ui, current_tile_index, 0, LV_ANIM_OFF);
 }
 
 static void lv_gui_goto_last_tile()
 {
+    lvgl_port_lock(0);
+
     ESP_LOGI(TAG, "lv_gui_goto_last_tile: %d", (int)last_tile_index);
     if (last_tile_index > 0)
     {
         current_tile_index = last_tile_index; // Set to the last tile
+        show_view_window(current_tile_index);
         lv_obj_set_tile_id(base_ui, current_tile_index, 0, LV_ANIM_ON);
         ESP_LOGI(TAG, "Moved to last tile: %d", current_tile_index);
         first_press = false;
@@ -423,27 +987,28 @@ static void lv_gui_goto_last_tile()
     {
         ESP_LOGI(TAG, "No notification tiles available.");
     }
+
+    lvgl_port_unlock();
 }
 
 static void lv_gui_goto_next_tile()
 {
+    lvgl_port_lock(0);
+
     ESP_LOGI(TAG, "Current tile index before navigation: %d", current_tile_index);
 
-    // Delete the current tile if it exists
-    lv_obj_t *current_tile = lv_tileview_get_tile_active(base_ui);
-    if (current_tile != NULL && current_tile_index > 0)
+    // Dismiss the current notification if there is one
+    if (current_tile_index > 0 && current_tile_index <= last_tile_index)
     {
-        lv_obj_delete(current_tile);
-        ESP_LOGI(TAG, "Deleted tile at index: %d", current_tile_index);
-        --notification_index;
-        --last_tile_index; // Update the last tile index
-        lv_gui_set_inbox_title(last_tile_index);
+        remove_view(current_tile_index);
+        ESP_LOGI(TAG, "Dismissed tile at index: %d", current_tile_index);
     }
 
     // Move to the previous tile
     if (last_tile_index > 0)
     {
         --current_tile_index; // Decrement the current index
+        reset_view_window();
         lv_obj_set_tile_id(base_ui, current_tile_index, 0, LV_ANIM_ON);
         ESP_LOGI(TAG, "Moved to tile: %d", current_tile_index);
     }
@@ -451,94 +1016,213 @@ static void lv_gui_goto_next_tile()
     {
         // If no tiles are left, go back to the base tile
         current_tile_index = 0;
+        reset_view_window();
         lv_obj_set_tile_id(base_ui, current_tile_index, 0, LV_ANIM_ON);
         ESP_LOGI(TAG, "No more tiles. Returning to base.");
 
         first_press = true;
     }
+
+    lvgl_port_unlock();
 }
 
-void lv_gui_remove_all_tiles()
+static void lv_gui_remove_all_tiles()
 {
     ESP_LOGI(TAG, "Removing all tiles...");
 
-    // Lock the LVGL port to ensure thread safety
-    lvgl_port_lock(0);
+    last_tile_index = 0;
 
-    // Remove all tiles from last to first
-    while (last_tile_index > 0)
-    {
-        lv_obj_t *current_tile = lv_tileview_get_tile_active(base_ui);
-        if (current_tile != NULL && last_tile_index > 0)
-        {
-            lv_obj_delete(current_tile);
-            ESP_LOGI(TAG, "Deleted tile at index: %d", last_tile_index);
-        }
+    // Reset indices and return to the base tile
+    current_tile_index = 0;
+    first_press = true;
+    reset_view_window();
+    lv_obj_set_tile_id(base_ui, current_tile_index, 0, LV_ANIM_OFF);
+    lv_gui_set_inbox_title(last_tile_index);
 
-        --last_tile_index;    // Decrease the last tile index
-        --notification_index; // Update the notification index
+    ESP_LOGI(TAG, "All tiles removed. Returning to base.");
+}
+
+static void append_stored_view(NotificationAttributes *notification, void *ctx)
+{
+    if (last_tile_index < MAX_NOTIFICATIONS)
+    {
+        view_list[last_tile_index].uid = notification->NotificationUID;
+        view_list[last_tile_index].message_shown = notification->Message[0] != '\0';
+        ++last_tile_index;
     }
+}
 
-    // Reset indices and return to the base tile
-    current_tile_index = 0;
+// Commands were lost, the store knows every notification still on the phone. Notifications dismissed
+// on the glasses come back.
+static void rebuild_tile_views(void)
+{
+    last_tile_index = 0;
+    notification_store_lock();
+    notification_store_for_each(append_stored_view, NULL);
+    notification_store_unlock();
+    ESP_LOGW(TAG, "UI commands overflowed, %d notifications rebuilt from the store", last_tile_index);
+
+    if (current_tile_index > last_tile_index)
+    {
+        current_tile_index = last_tile_index;
+    }
+    if (current_tile_index == 0)
+    {
+        first_press = true;
+    }
+    reset_view_window();
     lv_obj_set_tile_id(base_ui, current_tile_index, 0, LV_ANIM_OFF);
+    lv_gui_set_inbox_title(last_tile_index);
+}
 
-    // Unlock the LVGL port
-    lvgl_port_unlock();
+static void post_ui_command(ui_command_type_t type, uint32_t uid, notification_event_t event)
+{
+    ui_command_t cmd = {
+        .type = type,
+        .event = event,
+        .uid = uid,
+    };
+    bool queued = ui_command_queue != NULL && xQueueSend(ui_command_queue, &cmd, 0) == pdTRUE;
 
-    ESP_LOGI(TAG, "All tiles removed. Returning to base.");
+    portENTER_CRITICAL(&ui_command_lock);
+    if (queued)
+    {
+        ui_stats.posted++;
+    }
+    else
+    {
+        pending_resync = true;
+        ui_stats.coalesced++;
+    }
+    portEXIT_CRITICAL(&ui_command_lock);
+}
+
+void lv_gui_post_notification(uint32_t NotificationUID, notification_event_t event)
+{
+    post_ui_command(UI_CMD_NOTIFICATION, NotificationUID, event);
+}
+
+void lv_gui_post_removed(uint32_t NotificationUID)
+{
+    post_ui_command(UI_CMD_REMOVED, NotificationUID, NOTIFICATION_ADDED);
 }
 
 void lv_gui_ble_status(bool isOn)
 {
-    lvgl_port_lock(0);
-    lv_obj_set_style_text_color(ble_label, isOn ? lv_palette_main(LV_PALETTE_BLUE) : font_color, 0);
+    portENTER_CRITICAL(&ui_command_lock);
+    if (pending_ble_status >= 0)
+    {
+        ui_stats.coalesced++;
+    }
+    pending_ble_status = isOn;
+    portEXIT_CRITICAL(&ui_command_lock);
 
     if (!isOn)
     {
-        lv_gui_remove_all_tiles();
+        // Ordered with the notification commands, a reconnect may add new ones right behind it
+        post_ui_command(UI_CMD_CLEAR, 0, NOTIFICATION_ADDED);
+    }
+}
+
+void lv_gui_get_command_stats(ui_command_stats_t *stats)
+{
+    portENTER_CRITICAL(&ui_command_lock);
+    *stats = ui_stats;
+    portEXIT_CRITICAL(&ui_command_lock);
+}
+
+// Runs on the LVGL task, which already holds the LVGL lock
+static void ui_command_timer_fn(lv_timer_t *timer)
+{
+    portENTER_CRITICAL(&ui_command_lock);
+    int ble_status = pending_ble_status;
+    bool resync = pending_resync;
+    pending_ble_status = -1;
+    pending_resync = false;
+    if (resync)
+    {
+        ui_stats.resyncs++;
+    }
+    portEXIT_CRITICAL(&ui_command_lock);
+
+    if (ble_status >= 0)
+    {
+        lv_obj_set_style_text_color(ble_label, ble_status ? lv_palette_main(LV_PALETTE_BLUE) : font_color, 0);
+    }
+
+    if (resync)
+    {
+        // The store already holds the outcome of every dropped command, and of any posted meanwhile
+        xQueueReset(ui_command_queue);
+        rebuild_tile_views();
+        return;
+    }
+
+    ui_command_t cmd;
+    while (xQueueReceive(ui_command_queue, &cmd, 0) == pdTRUE)
+    {
+        switch (cmd.type)
+        {
+        case UI_CMD_NOTIFICATION:
+            if (cmd.event == NOTIFICATION_ADDED)
+            {
+                add_tile_view(cmd.uid);
+            }
+            else
+            {
+                update_tile_view(cmd.uid, (notification_event_t)cmd.event);
+            }
+            break;
+        case UI_CMD_REMOVED:
+            remove_tile_view(cmd.uid);
+            break;
+        default: // UI_CMD_CLEAR
+            lv_gui_remove_all_tiles();
+            break;
+        }
     }
-    lvgl_port_unlock();
 }
 
 void lv_gui_set_inbox_title(int notification_count)
 {
+    // The label points at the literals or at this buffer, so updating it never touches the LVGL heap
+    static char buffer[48];
     lvgl_port_lock(0);
-    char buffer[128];
 
     if (notification_count == 0)
     {
-        lv_label_set_text(inbox_label, "Hooray!\nNo Unread\nMessages!\nTime to relax.");
+        lv_label_set_text_static(inbox_label, "Hooray!\nNo Unread\nMessages!\nTime to relax.");
     }
     else if (notification_count == 1)
     {
-        lv_label_set_text(inbox_label, "Just 1\nNew Message.\nMake it count!");
+        lv_label_set_text_static(inbox_label, "Just 1\nNew Message.\nMake it count!");
     }
     else if (notification_count == 2)
     {
-        lv_label_set_text(inbox_label, "Two's company:\nYou have\n2 Messages!");
+        lv_label_set_text_static(inbox_label, "Two's company:\nYou have\n2 Messages!");
     }
     else if (notification_count == 3)
     {
-        lv_label_set_text(inbox_label, "Three's a crowd:\nCheck your\n3 Messages!");
+        lv_label_set_text_static(inbox_label, "Three's a crowd:\nCheck your\n3 Messages!");
     }
     else if (notification_count == 4)
     {
-        lv_label_set_text(inbox_label, "4 Messages\nWaiting for you.\nLet's get reading!");
+        lv_label_set_text_static(inbox_label, "4 Messages\nWaiting for you.\nLet's get reading!");
     }
     else if (notification_count <= 6)
     {
         snprintf(buffer, sizeof(buffer), "Wow, %d Messages!\nYou're popular!", notification_count);
-        lv_label_set_text(inbox_label, buffer);
+        lv_label_set_text_static(inbox_label, buffer);
     }
     else if (notification_count <= 9)
     {
         snprintf(buffer, sizeof(buffer), "%d Messages!\nYou're on fire!", notification_count);
-        lv_label_set_text(inbox_label, buffer);
+        lv_label_set_text_static(inbox_label, buffer);
     }
-    else if (notification_count <= 10)
+    else
     {
-        lv_label_set_text(inbox_label, "10 Messages!\nOverflow alert!");
+        snprintf(buffer, sizeof(buffer), "%d Messages!\nOverflow alert!", notification_count);
+        lv_label_set_text_static(inbox_label, buffer);
     }
     lvgl_port_unlock();
 }
\ No newline at end of file
@@ -0,0 +1,121 @@
+#include <string.h>
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "text_arena.h"
+
+#define TAG "[Text Arena]"
+
+typedef struct
+{
+    const char **owner; // NULL once freed
+    uint32_t size;      // Whole block, header and padding included
+} text_block_t;
+
+#define TEXT_ARENA_ALIGN __alignof__(text_block_t)
+
+const char text_arena_empty[] = "";
+
+static uint8_t *arena = NULL;
+static text_arena_stats_t stats;
+
+static inline text_block_t *block_of(const char *text)
+{
+    return (text_block_t *)(text - sizeof(text_block_t));
+}
+
+static inline bool owns(const char *text)
+{
+    // The text of an empty block at the end sits right at the end of the used area
+    return arena != NULL && (const uint8_t *)text >= arena + sizeof(text_block_t) && (const uint8_t *)text <= arena + stats.used;
+}
+
+esp_err_t text_arena_init(size_t size, uint32_t caps)
+{
+    arena = heap_caps_malloc(size, caps);
+    if (!arena)
+    {
+        ESP_LOGE(TAG, "Failed to allocate %d bytes", (int)size);
+        return ESP_ERR_NO_MEM;
+    }
+    memset(&stats, 0, sizeof(stats));
+    stats.size = size;
+    return ESP_OK;
+}
+
+void text_arena_reset(void)
+{
+    stats.used = 0;
+    stats.live = 0;
+    stats.blocks = 0;
+}
+
+void text_arena_free(const char **owner)
+{
+    if (owns(*owner))
+    {
+        text_block_t *block = block_of(*owner);
+        block->owner = NULL;
+        stats.live -= block->size;
+        stats.blocks--;
+    }
+    *owner = text_arena_empty;
+}
+
+static void compact(void)
+{
+    uint32_t read = 0;
+    uint32_t write = 0;
+    while (read < stats.used)
+    {
+        text_block_t *block = (text_block_t *)(arena + read);
+        uint32_t size = block->size;
+        if (block->owner != NULL)
+        {
+            if (write != read)
+            {
+                memmove(arena + write, block, size);
+                block = (text_block_t *)(arena + write);
+                *block->owner = (const char *)(block + 1);
+            }
+            write += size;
+        }
+        read += size;
+    }
+    stats.used = write;
+    stats.compactions++;
+}
+
+char *text_arena_alloc(const char **owner, size_t len)
+{
+    text_arena_free(owner);
+
+    uint32_t size = (sizeof(text_block_t) + len + TEXT_ARENA_ALIGN - 1) & ~(uint32_t)(TEXT_ARENA_ALIGN - 1);
+    if (arena == NULL || size > stats.size - stats.live)
+    {
+        stats.failures++;
+        return NULL;
+    }
+    if (size > stats.size - stats.used)
+    {
+        compact();
+    }
+
+    text_block_t *block = (text_block_t *)(arena + stats.used);
+    block->owner = owner;
+    block->size = size;
+    stats.used += size;
+    stats.live += size;
+    stats.blocks++;
+    if (stats.live > stats.high_water)
+    {
+        stats.high_water = stats.live;
+    }
+
+    *owner = (const char *)(block + 1);
+    return (char *)(block + 1);
+}
+
+void text_arena_get_stats(text_arena_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,142 @@
+#include "host_test.h"
+#include <string.h>
+#include "ancs_protocol.h"
+
+// Parser throughput on the responses the app requests (app identifier, title, subtitle, message and
+// date), fed in Data Source fragments of a 185 byte MTU, and the rate of Notification Source parses.
+
+#define RESPONSES       20000
+#define FRAGMENT        182     // MTU 185 minus the ATT notification header
+
+typedef struct
+{
+    uint32_t responses;
+    uint32_t attributes;
+    size_t value_bytes;
+} bench_ctx_t;
+
+static uint8_t bench_begin(void *ctx, uint32_t uid)
+{
+    return 5;
+}
+
+static void bench_attribute(void *ctx, const ancs_attribute_t *attr)
+{
+    bench_ctx_t *bc = ctx;
+    bc->attributes++;
+    bc->value_bytes += attr->len;
+}
+
+static void bench_complete(void *ctx)
+{
+    bench_ctx_t *bc = ctx;
+    bc->responses++;
+}
+
+static size_t put_attribute(uint8_t *out, uint8_t id, const char *value)
+{
+    size_t len = strlen(value);
+    out[0] = id;
+    out[1] = len & 0xFF;
+    out[2] = len >> 8;
+    memcpy(&out[3], value, len);
+    return ANCS_ATTRIBUTE_HEADER_LEN + len;
+}
+
+static size_t build_response(uint8_t *out, uint32_t uid, uint32_t *seed)
+{
+    static const char *const messages[] = {
+        "See you at 7",
+        "The build finished with 3 warnings, the artifacts are uploaded to the release page and the "
+        "changelog was generated from the merged pull requests.",
+        "Meeting moved to tomorrow 10:00 in the small conference room on the second floor. Please bring "
+        "the printed quarterly numbers and the draft of the roadmap, we will go through both of them "
+        "before lunch and decide on the priorities for the next two sprints.\nThanks!",
+    };
+
+    size_t len = 0;
+    out[len++] = ANCS_COMMAND_GET_NOTIFICATION_ATTRIBUTES;
+    memcpy(&out[len], &uid, sizeof(uid));
+    len += sizeof(uid);
+    len += put_attribute(&out[len], 0, "com.apple.MobileSMS");
+    len += put_attribute(&out[len], 1, "Jane Appleseed");
+    len += put_attribute(&out[len], 2, "");
+    len += put_attribute(&out[len], 3, messages[host_rand(seed) % 3]);
+    len += put_attribute(&out[len], 5, "20261017T101500");
+    return len;
+}
+
+int main(void)
+{
+    static uint8_t responses[RESPONSES][600];
+    static size_t lengths[RESPONSES];
+    uint32_t seed = 0x2545F491;
+    size_t total = 0;
+    for (int i = 0; i < RESPONSES; i++)
+    {
+        lengths[i] = build_response(responses[i], i, &seed);
+        total += lengths[i];
+    }
+
+    // Reassembly from fragments, as the Data Source delivers them
+    static ancs_stream_t stream;
+    bench_ctx_t bc = {0};
+    ancs_stream_handler_t handler = {
+        .begin = bench_begin,
+        .attribute = bench_attribute,
+        .complete = bench_complete,
+        .ctx = &bc,
+    };
+    ancs_stream_init(&stream, &handler);
+
+    uint64_t start = host_now_ns();
+    for (int i = 0; i < RESPONSES; i++)
+    {
+        for (size_t pos = 0; pos < lengths[i]; pos += FRAGMENT)
+        {
+            size_t n = (lengths[i] - pos < FRAGMENT) ? lengths[i] - pos : FRAGMENT;
+            CHECK(ancs_stream_feed(&stream, &responses[i][pos], n));
+        }
+    }
+    uint64_t stream_ns = host_now_ns() - start;
+    CHECK(bc.responses == RESPONSES);
+    CHECK(bc.attributes == RESPONSES * 5);
+
+    // The same responses parsed in place, as a single buffer
+    size_t iter_bytes = 0;
+    start = host_now_ns();
+    for (int i = 0; i < RESPONSES; i++)
+    {
+        uint8_t command;
+        uint32_t uid;
+        ancs_attr_iter_t it;
+        ancs_attribute_t attr;
+        CHECK(ancs_parse_attributes_header(responses[i], lengths[i], &command, &uid, &it) == ANCS_PARSE_OK);
+        while (ancs_attr_next(&it, &attr) == ANCS_PARSE_OK)
+        {
+            iter_bytes += attr.len;
+        }
+    }
+    uint64_t iter_ns = host_now_ns() - start;
+    CHECK(iter_bytes == bc.value_bytes);
+
+    // Notification Source, one 8 byte notification per event
+    uint8_t source[ANCS_NOTIFICATION_SOURCE_LEN] = {0, 0, 4, 1, 0, 0, 0, 0};
+    volatile uint32_t uid_sum = 0;
+    const int sources = RESPONSES * 50;
+    start = host_now_ns();
+    for (int i = 0; i < sources; i++)
+    {
+        ancs_notification_source_t ns;
+        source[4] = (uint8_t)i;
+        CHECK(ancs_parse_notification_source(source, sizeof(source), &ns));
+        uid_sum += ns.notification_uid;
+    }
+    uint64_t source_ns = host_now_ns() - start;
+
+    printf("ancs_protocol_bench: %d responses, %zu bytes, %d byte fragments\n", RESPONSES, total, FRAGMENT);
+    printf("  stream_feed:      %8.1f MB/s\n", total * 1e3 / (double)stream_ns);
+    printf("  attr iterator:    %8.1f MB/s\n", total * 1e3 / (double)iter_ns);
+    printf("  notification src: %8.1f M parses/s\n", sources * 1e3 / (double)source_ns);
+    return host_test_result("ancs_protocol_bench");
+}
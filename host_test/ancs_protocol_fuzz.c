@@ -0,0 +1,159 @@
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "ancs_protocol.h"
+
+// Fuzz entry for the ANCS wire parsers and the Data Source reassembly. Built as a libFuzzer target
+// with Clang (-DANCS_FUZZ=ON), and always as a replay of generated inputs, see fuzz_main.c.
+// Input layout: byte 0 picks the attribute count the stream handler announces, byte 1 the fragment
+// size the rest is fed in; the rest goes to every parser as is.
+
+#define REQUIRE(cond)                                                          \
+    do                                                                         \
+    {                                                                          \
+        if (!(cond))                                                           \
+        {                                                                      \
+            fprintf(stderr, "%s:%d: invariant broken: %s\n", __FILE__, __LINE__, #cond); \
+            abort();                                                           \
+        }                                                                      \
+    } while (0)
+
+typedef struct
+{
+    uint8_t attr_count;
+    uint8_t attrs_seen;
+    bool in_response;
+} fuzz_ctx_t;
+
+static uint8_t fuzz_begin(void *ctx, uint32_t uid)
+{
+    fuzz_ctx_t *fc = ctx;
+    fc->attrs_seen = 0;
+    fc->in_response = true;
+    return fc->attr_count;
+}
+
+static uint8_t fuzz_app_begin(void *ctx, const char *app_id)
+{
+    REQUIRE(strlen(app_id) < ANCS_APP_ID_MAX);
+    return fuzz_begin(ctx, 0);
+}
+
+static void fuzz_attribute(void *ctx, const ancs_attribute_t *attr)
+{
+    fuzz_ctx_t *fc = ctx;
+    REQUIRE(fc->in_response);
+    REQUIRE(attr->len <= ANCS_STREAM_VALUE_MAX);
+    REQUIRE(attr->len == 0 || attr->value != NULL);
+
+    // Touch every byte so the sanitizer sees reads past the scratch buffer
+    volatile uint8_t sum = 0;
+    for (uint16_t i = 0; i < attr->len; i++)
+    {
+        sum += attr->value[i];
+    }
+
+    char text[32];
+    size_t n = ancs_copy_text(text, sizeof(text), attr->value, attr->len, true);
+    REQUIRE(n < sizeof(text) && text[n] == '\0' && strlen(text) <= n);
+    fc->attrs_seen++;
+}
+
+static void fuzz_complete(void *ctx)
+{
+    fuzz_ctx_t *fc = ctx;
+    REQUIRE(fc->in_response);
+    REQUIRE(fc->attrs_seen == fc->attr_count);
+    fc->in_response = false;
+}
+
+static void fuzz_parsers(const uint8_t *data, size_t len)
+{
+    ancs_notification_source_t source;
+    REQUIRE(ancs_parse_notification_source(data, len, &source) == (len >= ANCS_NOTIFICATION_SOURCE_LEN));
+
+    uint8_t command;
+    uint32_t uid;
+    ancs_attr_iter_t it;
+    if (ancs_parse_attributes_header(data, len, &command, &uid, &it) == ANCS_PARSE_OK)
+    {
+        ancs_attribute_t attr;
+        while (ancs_attr_next(&it, &attr) == ANCS_PARSE_OK)
+        {
+            REQUIRE(attr.value >= data && attr.value + attr.len <= data + len);
+        }
+    }
+
+    // Every destination size, including the ones that cut multi-byte sequences. A NUL in the value
+    // ends the string early, that is fine as long as the copy stays terminated.
+    char text[8];
+    for (size_t size = 1; size <= sizeof(text); size++)
+    {
+        size_t n = ancs_copy_text(text, size, data, len, size & 1);
+        REQUIRE(n < size && text[n] == '\0' && strlen(text) <= n);
+        REQUIRE(n == len || n == 0 || (data[n] & 0xC0) != 0x80);
+    }
+}
+
+static void fuzz_encoders(const uint8_t *data, size_t len)
+{
+    char app_id[ANCS_APP_ID_MAX + 8];
+    size_t id_len = len < sizeof(app_id) - 1 ? len : sizeof(app_id) - 1;
+    memcpy(app_id, data, id_len);
+    app_id[id_len] = '\0';
+
+    uint8_t out[ANCS_APP_REQUEST_MAX_LEN];
+    size_t count = len % (ANCS_MAX_REQUESTED_ATTRIBUTES + 1);
+    size_t n = ancs_encode_get_app_attributes(out, sizeof(out), app_id, data, count);
+    REQUIRE(n == 0 || (n <= sizeof(out) && out[0] == ANCS_COMMAND_GET_APP_ATTRIBUTES));
+
+    ancs_attr_request_t attrs[ANCS_MAX_REQUESTED_ATTRIBUTES];
+    for (size_t i = 0; i < count; i++)
+    {
+        attrs[i].id = data[i] % 8;
+        attrs[i].max_len = (uint16_t)(data[i] * 7);
+    }
+    uint8_t req[ANCS_REQUEST_MAX_LEN];
+    n = ancs_encode_get_notification_attributes(req, sizeof(req), id_len, attrs, count);
+    REQUIRE(n <= sizeof(req));
+}
+
+static void fuzz_stream(uint8_t attr_count, size_t fragment, const uint8_t *data, size_t len)
+{
+    static ancs_stream_t stream;
+    fuzz_ctx_t fc = {.attr_count = attr_count};
+    ancs_stream_handler_t handler = {
+        .begin = fuzz_begin,
+        .app_begin = fuzz_app_begin,
+        .attribute = fuzz_attribute,
+        .complete = fuzz_complete,
+        .ctx = &fc,
+    };
+    ancs_stream_init(&stream, &handler);
+
+    for (size_t pos = 0; pos < len; pos += fragment)
+    {
+        ancs_stream_feed(&stream, &data[pos], (len - pos < fragment) ? len - pos : fragment);
+        REQUIRE(stream.header_len <= ANCS_ATTRIBUTES_HEADER_LEN);
+        REQUIRE(stream.app_id_len < ANCS_APP_ID_MAX);
+        REQUIRE(stream.attrs_done <= stream.attr_count || stream.state == ANCS_STREAM_HEADER);
+    }
+}
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    if (size < 2)
+    {
+        return 0;
+    }
+    uint8_t attr_count = data[0] % (ANCS_MAX_REQUESTED_ATTRIBUTES + 1);
+    size_t fragment = data[1] % 185 + 1;
+    data += 2;
+    size -= 2;
+
+    fuzz_parsers(data, size);
+    fuzz_encoders(data, size);
+    fuzz_stream(attr_count, fragment, data, size);
+    return 0;
+}
@@ -0,0 +1,253 @@
+#include "host_test.h"
+#include <stdbool.h>
+#include <string.h>
+#include "ancs_protocol.h"
+
+// Round trips Control Point requests through the encoders and a decoder written from the ANCS
+// specification, then answers them and checks the Data Source reassembly hands back what was sent.
+
+#define ROUNDS  20000
+
+typedef struct
+{
+    uint8_t command;
+    uint32_t uid;
+    char app_id[ANCS_APP_ID_MAX + 16];
+    size_t count;
+    ancs_attr_request_t attrs[ANCS_MAX_REQUESTED_ATTRIBUTES];
+} decoded_request_t;
+
+// Returns false if the request is malformed: a length where none belongs or bytes left over
+static bool decode_request(const uint8_t *data, size_t len, decoded_request_t *req)
+{
+    memset(req, 0, sizeof(*req));
+    if (len < 1)
+    {
+        return false;
+    }
+    size_t pos = 1;
+    req->command = data[0];
+    if (req->command == ANCS_COMMAND_GET_NOTIFICATION_ATTRIBUTES)
+    {
+        if (len < ANCS_ATTRIBUTES_HEADER_LEN)
+        {
+            return false;
+        }
+        req->uid = data[1] | (data[2] << 8) | (data[3] << 16) | ((uint32_t)data[4] << 24);
+        pos = ANCS_ATTRIBUTES_HEADER_LEN;
+        while (pos < len && req->count < ANCS_MAX_REQUESTED_ATTRIBUTES)
+        {
+            ancs_attr_request_t *attr = &req->attrs[req->count++];
+            attr->id = data[pos++];
+            if (attr->id >= 1 && attr->id <= 3)
+            {
+                if (len - pos < 2)
+                {
+                    return false;
+                }
+                attr->max_len = data[pos] | (data[pos + 1] << 8);
+                pos += 2;
+            }
+        }
+        return pos == len;
+    }
+
+    const uint8_t *nul = memchr(&data[pos], '\0', len - pos);
+    if (!nul || (size_t)(nul - &data[pos]) >= sizeof(req->app_id))
+    {
+        return false;
+    }
+    memcpy(req->app_id, &data[pos], nul - &data[pos]);
+    pos = nul - data + 1;
+    while (pos < len && req->count < ANCS_MAX_REQUESTED_ATTRIBUTES)
+    {
+        req->attrs[req->count++].id = data[pos++];
+    }
+    return pos == len;
+}
+
+static void test_notification_request(void)
+{
+    // The app's request, with a length that needs both bytes
+    const ancs_attr_request_t attrs[] = {
+        {.id = 0},
+        {.id = 1, .max_len = 0x1234},
+        {.id = 3, .max_len = 0xFFFF},
+        {.id = 5, .max_len = 0x5555},   // Date takes no length, the value must not be sent
+    };
+    uint8_t out[ANCS_REQUEST_MAX_LEN];
+    size_t len = ancs_encode_get_notification_attributes(out, sizeof(out), 0xA1B2C3D4, attrs, 4);
+    const uint8_t expected[] = {0, 0xD4, 0xC3, 0xB2, 0xA1, 0, 1, 0x34, 0x12, 3, 0xFF, 0xFF, 5};
+    CHECK(len == sizeof(expected) && memcmp(out, expected, len) == 0);
+
+    // Exactly the size needed fits, one byte less does not and leaves the buffer alone
+    CHECK(ancs_encode_get_notification_attributes(out, len, 1, attrs, 4) == len);
+    memset(out, 0xEE, sizeof(out));
+    CHECK(ancs_encode_get_notification_attributes(out, len - 1, 1, attrs, 4) == 0);
+    CHECK(out[0] == 0xEE);
+    CHECK(ancs_encode_get_notification_attributes(out, 0, 1, attrs, 0) == 0);
+    CHECK(ancs_encode_get_notification_attributes(out, ANCS_ATTRIBUTES_HEADER_LEN, 7, attrs, 0) == ANCS_ATTRIBUTES_HEADER_LEN);
+
+    // Every attribute with a length at once still fits the maximum request size
+    ancs_attr_request_t all[ANCS_MAX_REQUESTED_ATTRIBUTES];
+    for (int i = 0; i < ANCS_MAX_REQUESTED_ATTRIBUTES; i++)
+    {
+        all[i] = (ancs_attr_request_t){.id = 1 + i % 3, .max_len = 1000 + i};
+    }
+    CHECK(ancs_encode_get_notification_attributes(out, sizeof(out), 1, all, ANCS_MAX_REQUESTED_ATTRIBUTES) == ANCS_REQUEST_MAX_LEN);
+
+    uint32_t seed = 3;
+    for (int n = 0; n < ROUNDS; n++)
+    {
+        ancs_attr_request_t req[ANCS_MAX_REQUESTED_ATTRIBUTES];
+        size_t count = host_rand(&seed) % (ANCS_MAX_REQUESTED_ATTRIBUTES + 1);
+        for (size_t i = 0; i < count; i++)
+        {
+            req[i].id = host_rand(&seed) % 8;
+            req[i].max_len = (uint16_t)host_rand(&seed);
+        }
+        uint32_t uid = host_rand(&seed);
+        len = ancs_encode_get_notification_attributes(out, sizeof(out), uid, req, count);
+
+        decoded_request_t dec;
+        CHECK(len > 0 && decode_request(out, len, &dec));
+        CHECK(dec.command == ANCS_COMMAND_GET_NOTIFICATION_ATTRIBUTES && dec.uid == uid && dec.count == count);
+        for (size_t i = 0; i < count && i < dec.count; i++)
+        {
+            CHECK(dec.attrs[i].id == req[i].id);
+            CHECK(dec.attrs[i].max_len == (ancs_attr_takes_max_len(req[i].id) ? req[i].max_len : 0));
+        }
+    }
+}
+
+static void test_app_request(void)
+{
+    const uint8_t display_name = 0;
+    uint8_t out[ANCS_APP_REQUEST_MAX_LEN];
+    size_t len = ancs_encode_get_app_attributes(out, sizeof(out), "com.apple.MobileSMS", &display_name, 1);
+    CHECK(len == 1 + 19 + 1 + 1);
+    CHECK(out[0] == ANCS_COMMAND_GET_APP_ATTRIBUTES && memcmp(&out[1], "com.apple.MobileSMS", 20) == 0 && out[21] == 0);
+
+    // Identifiers are cut to ANCS_APP_ID_MAX - 1 characters and stay terminated
+    char long_id[100];
+    memset(long_id, 'x', sizeof(long_id) - 1);
+    long_id[sizeof(long_id) - 1] = '\0';
+    for (size_t id_len = ANCS_APP_ID_MAX - 2; id_len < sizeof(long_id); id_len++)
+    {
+        char id[sizeof(long_id)];
+        memcpy(id, long_id, id_len);
+        id[id_len] = '\0';
+        len = ancs_encode_get_app_attributes(out, sizeof(out), id, &display_name, 1);
+        size_t kept = (id_len < ANCS_APP_ID_MAX - 1) ? id_len : ANCS_APP_ID_MAX - 1;
+        decoded_request_t dec;
+        CHECK(len == 1 + kept + 1 + 1 && decode_request(out, len, &dec));
+        CHECK(strlen(dec.app_id) == kept && dec.count == 1 && dec.attrs[0].id == display_name);
+    }
+
+    // The longest request fits the maximum size exactly, one byte less does not
+    uint8_t ids[ANCS_MAX_REQUESTED_ATTRIBUTES] = {0, 1, 2, 3, 4, 5, 6, 7};
+    CHECK(ancs_encode_get_app_attributes(out, sizeof(out), long_id, ids, ANCS_MAX_REQUESTED_ATTRIBUTES) == ANCS_APP_REQUEST_MAX_LEN);
+    CHECK(ancs_encode_get_app_attributes(out, sizeof(out) - 1, long_id, ids, ANCS_MAX_REQUESTED_ATTRIBUTES) == 0);
+    CHECK(ancs_encode_get_app_attributes(out, 2, "", ids, 0) == 2);
+}
+
+// Answers a request the way the phone does, so the reassembly can be checked against it
+typedef struct
+{
+    uint8_t value[ANCS_MAX_REQUESTED_ATTRIBUTES][300];
+    uint16_t len[ANCS_MAX_REQUESTED_ATTRIBUTES];
+    uint8_t count;
+    uint32_t uid;
+    uint8_t seen;
+    bool ok;
+    int completed;
+} response_check_t;
+
+static uint8_t check_begin(void *ctx, uint32_t uid)
+{
+    response_check_t *rc = ctx;
+    rc->ok = rc->ok && uid == rc->uid;
+    rc->seen = 0;
+    return rc->count;
+}
+
+static void check_attribute(void *ctx, const ancs_attribute_t *attr)
+{
+    response_check_t *rc = ctx;
+    rc->ok = rc->ok && rc->seen < rc->count && attr->len == rc->len[rc->seen] &&
+             memcmp(attr->value, rc->value[rc->seen], attr->len) == 0;
+    rc->seen++;
+}
+
+static void check_complete(void *ctx)
+{
+    response_check_t *rc = ctx;
+    rc->ok = rc->ok && rc->seen == rc->count;
+    rc->completed++;
+}
+
+static void test_response_round_trip(void)
+{
+    static ancs_stream_t stream;
+    static response_check_t rc;
+    ancs_stream_handler_t handler = {
+        .begin = check_begin,
+        .attribute = check_attribute,
+        .complete = check_complete,
+        .ctx = &rc,
+    };
+    ancs_stream_init(&stream, &handler);
+
+    uint32_t seed = 5;
+    for (int n = 0; n < ROUNDS / 10; n++)
+    {
+        ancs_attr_request_t req[ANCS_MAX_REQUESTED_ATTRIBUTES];
+        rc.count = host_rand(&seed) % (ANCS_MAX_REQUESTED_ATTRIBUTES + 1);
+        rc.uid = host_rand(&seed);
+        rc.ok = true;
+        for (uint8_t i = 0; i < rc.count; i++)
+        {
+            req[i].id = host_rand(&seed) % 8;
+            req[i].max_len = host_rand(&seed) % 300;
+        }
+        uint8_t request[ANCS_REQUEST_MAX_LEN];
+        size_t request_len = ancs_encode_get_notification_attributes(request, sizeof(request), rc.uid, req, rc.count);
+        decoded_request_t dec;
+        CHECK(decode_request(request, request_len, &dec));
+
+        // Values honour the requested maximum, the others get an arbitrary length
+        static uint8_t response[ANCS_ATTRIBUTES_HEADER_LEN + ANCS_MAX_REQUESTED_ATTRIBUTES * (ANCS_ATTRIBUTE_HEADER_LEN + 300)];
+        memcpy(response, request, ANCS_ATTRIBUTES_HEADER_LEN);
+        size_t len = ANCS_ATTRIBUTES_HEADER_LEN;
+        for (uint8_t i = 0; i < dec.count; i++)
+        {
+            uint16_t max = ancs_attr_takes_max_len(dec.attrs[i].id) ? dec.attrs[i].max_len : 40;
+            rc.len[i] = max ? host_rand(&seed) % (max + 1) : 0;
+            for (uint16_t k = 0; k < rc.len[i]; k++)
+            {
+                rc.value[i][k] = (uint8_t)host_rand(&seed);
+            }
+            response[len++] = dec.attrs[i].id;
+            response[len++] = rc.len[i] & 0xFF;
+            response[len++] = rc.len[i] >> 8;
+            memcpy(&response[len], rc.value[i], rc.len[i]);
+            len += rc.len[i];
+        }
+
+        int completed = rc.completed;
+        size_t fragment = 1 + host_rand(&seed) % 182;
+        for (size_t pos = 0; pos < len; pos += fragment)
+        {
+            CHECK(ancs_stream_feed(&stream, &response[pos], (len - pos < fragment) ? len - pos : fragment));
+        }
+        CHECK(rc.completed == completed + 1 && rc.ok);
+    }
+}
+
+int main(void)
+{
+    test_notification_request();
+    test_app_request();
+    test_response_round_trip();
+    return host_test_result("ancs_protocol_test");
+}
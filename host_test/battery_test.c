@@ -0,0 +1,273 @@
+#include "host_test.h"
+#include <pthread.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "battery_measurement.h"
+#include "esp_adc/adc_oneshot.h"
+#include "esp_adc/adc_cali_scheme.h"
+
+// Checks the state of charge table, then replays a discharge trace with load changes through the sampler
+// task and a simulated ADC, one burst per trace sample, and checks the percentage it reports.
+
+#define BURST           15      // BATTERY_BURST_SAMPLES
+#define BASE_LOAD_MA    40
+#define DISPLAY_ON_MA   8       // Plus up to 60 mA with the brightness
+#define DISPLAY_MAX_MA  68      // Panel on at brightness 255
+#define RADIO_MA        15
+#define RESISTANCE_MOHM 250
+
+// Simulated ADC, in lockstep with the test: the sampler waits at the start of every burst until the test
+// supplies the next battery voltage. Per burst one read times out, three are outliers and the rest scatter
+// by one count around half the voltage (the divider); calibration maps counts to millivolts one to one.
+static pthread_mutex_t adc_lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t adc_cond = PTHREAD_COND_INITIALIZER;
+static uint32_t bursts_supplied;
+static uint32_t bursts_started;
+static uint32_t bursts_reached;     // Times the sampler arrived at the start of a burst
+static int pin_mv;
+static uint32_t adc_reads;          // Sampler task only
+
+esp_err_t adc_oneshot_new_unit(const adc_oneshot_unit_init_cfg_t *config, adc_oneshot_unit_handle_t *handle)
+{
+    static int unit;
+    *handle = (adc_oneshot_unit_handle_t)&unit;
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_config_channel(adc_oneshot_unit_handle_t handle, adc_channel_t channel, const adc_oneshot_chan_cfg_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_read(adc_oneshot_unit_handle_t handle, adc_channel_t channel, int *raw)
+{
+    uint32_t k = adc_reads++ % BURST;
+    if (k == 0)
+    {
+        // The previous burst's snapshot is published by now
+        pthread_mutex_lock(&adc_lock);
+        bursts_reached++;
+        pthread_cond_broadcast(&adc_cond);
+        while (bursts_started == bursts_supplied)
+        {
+            pthread_cond_wait(&adc_cond, &adc_lock);
+        }
+        bursts_started++;
+        pthread_mutex_unlock(&adc_lock);
+        return ESP_ERR_TIMEOUT;
+    }
+
+    switch (k)
+    {
+    case 1:
+    case 2:
+        *raw = 4095;
+        break;
+    case 3:
+        *raw = 0;
+        break;
+    default:
+        *raw = pin_mv + (int)(k % 3) - 1;
+        break;
+    }
+    return ESP_OK;
+}
+
+esp_err_t adc_oneshot_del_unit(adc_oneshot_unit_handle_t handle)
+{
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_create_scheme_curve_fitting(const adc_cali_curve_fitting_config_t *config, adc_cali_handle_t *handle)
+{
+    static int cali;
+    *handle = (adc_cali_handle_t)&cali;
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_delete_scheme_curve_fitting(adc_cali_handle_t handle)
+{
+    return ESP_OK;
+}
+
+esp_err_t adc_cali_raw_to_voltage(adc_cali_handle_t handle, int raw, int *voltage)
+{
+    *voltage = raw;
+    return ESP_OK;
+}
+
+// Lets the sampler measure one burst at 'battery_mv' (even) and returns the snapshot it published
+static battery_snapshot_t run_burst(int battery_mv)
+{
+    pthread_mutex_lock(&adc_lock);
+    pin_mv = battery_mv / 2;
+    bursts_supplied++;
+    pthread_cond_broadcast(&adc_cond);
+    while (bursts_reached <= bursts_supplied)
+    {
+        pthread_cond_wait(&adc_cond, &adc_lock);
+    }
+    pthread_mutex_unlock(&adc_lock);
+
+    battery_snapshot_t snapshot = {0};
+    CHECK(battery_measurement_get(&snapshot));
+    return snapshot;
+}
+
+static void set_loads(bool display, uint8_t brightness, bool radio)
+{
+    battery_set_display_load(display, brightness);
+    battery_set_radio_load(radio);
+}
+
+static int load_ma(bool display, uint8_t brightness, bool radio)
+{
+    return BASE_LOAD_MA + (display ? DISPLAY_ON_MA + 60 * brightness / 255 : 0) + (radio ? RADIO_MA : 0);
+}
+
+static void test_soc_table(void)
+{
+    // Curve points map exactly, rounded linear interpolation in between
+    CHECK(battery_mv_to_percentage(3300) == 0);
+    CHECK(battery_mv_to_percentage(3400) == 5);
+    CHECK(battery_mv_to_percentage(3500) == 10);
+    CHECK(battery_mv_to_percentage(3600) == 25);
+    CHECK(battery_mv_to_percentage(3700) == 50);
+    CHECK(battery_mv_to_percentage(3850) == 75);
+    CHECK(battery_mv_to_percentage(4000) == 90);
+    CHECK(battery_mv_to_percentage(4100) == 95);
+    CHECK(battery_mv_to_percentage(4200) == 100);
+
+    // Clamped outside the table
+    CHECK(battery_mv_to_percentage(0) == 0);
+    CHECK(battery_mv_to_percentage(-5) == 0);
+    CHECK(battery_mv_to_percentage(3299) == 0);
+    CHECK(battery_mv_to_percentage(4201) == 100);
+    CHECK(battery_mv_to_percentage(65535) == 100);
+
+    int previous = 0;
+    for (int mv = 3300; mv <= 4200; mv++)
+    {
+        int p = battery_mv_to_percentage(mv);
+        CHECK(p >= previous && p <= 100);
+        previous = p;
+    }
+}
+
+// Constant voltage: the bursts settle on the median, the charge is looked up load x 250 mOhm above it
+static void test_static_loads(void)
+{
+    static const struct
+    {
+        bool display;
+        uint8_t brightness;
+        bool radio;
+    } cases[] = {
+        {false, 255, false},
+        {true, 255, true},
+        {true, 0, false},
+    };
+
+    for (size_t i = 0; i < sizeof(cases) / sizeof(cases[0]); i++)
+    {
+        set_loads(cases[i].display, cases[i].brightness, cases[i].radio);
+        battery_snapshot_t snapshot;
+        for (int n = 0; n < 40; n++)
+        {
+            snapshot = run_burst(3550);
+        }
+        int ma = load_ma(cases[i].display, cases[i].brightness, cases[i].radio);
+        CHECK(snapshot.voltage_mv == 3550);
+        CHECK(snapshot.percentage == battery_mv_to_percentage(3550 + ma * RESISTANCE_MOHM / 1000));
+    }
+}
+
+/*
+    Discharge trace, one sample per burst (2 s on the glasses). Substitute for a recorded trace: the
+    open-circuit voltage follows the sampled curve below, a typical single cell LiPo from full to the cutoff,
+    time compressed to 400 bursts. The load follows a use pattern of the glasses (display switched on and off,
+    brightness changes, the radio connecting and dropping) and the terminal voltage the ADC sees is the
+    open-circuit voltage minus load x internal resistance, with a few mV of noise.
+*/
+static const struct
+{
+    uint16_t burst;
+    uint16_t ocv_mv;
+} discharge_curve[] = {
+    {0, 4180}, {10, 4080}, {30, 3980}, {60, 3900}, {100, 3820}, {150, 3760}, {200, 3720},
+    {250, 3690}, {300, 3660}, {340, 3620}, {370, 3570}, {390, 3500}, {400, 3420},
+};
+
+static int trace_ocv(int burst)
+{
+    size_t i = 1;
+    while (discharge_curve[i].burst < burst)
+    {
+        i++;
+    }
+    int b0 = discharge_curve[i - 1].burst;
+    int b1 = discharge_curve[i].burst;
+    int v0 = discharge_curve[i - 1].ocv_mv;
+    int v1 = discharge_curve[i].ocv_mv;
+    return v0 + (v1 - v0) * (burst - b0) / (b1 - b0);
+}
+
+static void test_discharge_trace(void)
+{
+    const int bursts = discharge_curve[sizeof(discharge_curve) / sizeof(discharge_curve[0]) - 1].burst;
+    uint32_t seed = 9;
+    int previous = -1;
+    int max_rise = 0;
+    int max_error = 0;
+    int max_raw_jump = 0;   // What the load steps would do without compensation, to show the trace exercises it
+    int previous_raw = -1;
+
+    for (int b = 0; b <= bursts; b++)
+    {
+        bool display = (b % 50) < 35;                   // Display off for 15 of every 50 bursts
+        uint8_t brightness = ((b / 20) % 3 == 0) ? 40 : 255;
+        bool radio = (b % 70) >= 10;                    // Reconnects after a drop
+        set_loads(display, brightness, radio);
+
+        int ocv = trace_ocv(b);
+        int terminal = ocv - load_ma(display, brightness, radio) * RESISTANCE_MOHM / 1000 + (int)(host_rand(&seed) % 5) - 2;
+        battery_snapshot_t snapshot = run_burst(terminal & ~1);
+
+        // The filter needs a few bursts after the first sample
+        if (b >= 8)
+        {
+            int error = abs(snapshot.percentage - battery_mv_to_percentage(ocv));
+            max_error = error > max_error ? error : max_error;
+            int rise = snapshot.percentage - previous;
+            max_rise = rise > max_rise ? rise : max_rise;
+            int raw = battery_mv_to_percentage(terminal);
+            int jump = abs(raw - previous_raw);
+            max_raw_jump = jump > max_raw_jump ? jump : max_raw_jump;
+        }
+        previous = snapshot.percentage;
+        previous_raw = battery_mv_to_percentage(terminal);
+    }
+
+    // A discharging battery never reads as gaining charge beyond rounding, load changes or not
+    CHECK(max_rise <= 1);
+    CHECK(max_error <= 2);
+    CHECK(max_raw_jump >= 4);
+    printf("discharge trace: %d bursts, largest rise %d%%, largest error %d%%, uncompensated load steps up to %d%%\n",
+           bursts + 1, max_rise, max_error, max_raw_jump);
+}
+
+int main(void)
+{
+    battery_snapshot_t snapshot;
+    CHECK(!battery_measurement_get(&snapshot));
+
+    // The table is built at init, the sampler then waits for the first burst's voltage
+    CHECK(battery_measurement_init() == ESP_OK);
+    test_soc_table();
+    test_static_loads();
+    test_discharge_trace();
+
+    battery_measurement_deinit();
+    return host_test_result("battery_test");
+}
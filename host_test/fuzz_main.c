@@ -0,0 +1,100 @@
+#include "host_test.h"
+#include <string.h>
+
+// Stand-in for the libFuzzer driver when building with GCC: replays every file given on the command
+// line, then a fixed number of generated inputs. Half of them are mutated well-formed ANCS responses,
+// so the parsers get past their header checks.
+
+#define GENERATED_INPUTS    20000
+#define MAX_INPUT           1400
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+static size_t well_formed(uint8_t *buf, uint32_t *seed)
+{
+    size_t len = 0;
+    buf[len++] = host_rand(seed) % 9;                 // Attribute count
+    buf[len++] = host_rand(seed) % 185;               // Fragment size
+    buf[len++] = host_rand(seed) % 2;                 // CommandID
+    if (buf[2] == 1)
+    {
+        size_t id = host_rand(seed) % 80;
+        for (size_t i = 0; i < id; i++)
+        {
+            buf[len++] = 'a' + host_rand(seed) % 26;
+        }
+        buf[len++] = '\0';
+    }
+    else
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            buf[len++] = (uint8_t)host_rand(seed);
+        }
+    }
+
+    while (len + 3 < MAX_INPUT && host_rand(seed) % 8)
+    {
+        // Now and then one longer than the stream's scratch buffer
+        uint16_t value = (host_rand(seed) % 16) ? host_rand(seed) % 64 : host_rand(seed) % 1200;
+        if (len + 3 + value > MAX_INPUT)
+        {
+            break;
+        }
+        buf[len++] = host_rand(seed) % 8;
+        buf[len++] = value & 0xFF;
+        buf[len++] = value >> 8;
+        for (uint16_t i = 0; i < value; i++)
+        {
+            // Mostly ASCII with some UTF-8 lead and continuation bytes and line breaks
+            uint32_t r = host_rand(seed) % 16;
+            buf[len++] = (r == 0) ? 0xE2 : (r == 1) ? 0x80 : (r == 2) ? '\n' : 'a' + r;
+        }
+    }
+    return len;
+}
+
+static int replay_file(const char *path)
+{
+    static uint8_t buf[1 << 16];
+    FILE *f = fopen(path, "rb");
+    if (!f)
+    {
+        perror(path);
+        return 1;
+    }
+    size_t len = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(buf, len);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (replay_file(argv[i]))
+        {
+            return EXIT_FAILURE;
+        }
+    }
+
+    uint32_t seed = 0x2545F491;
+    uint8_t buf[MAX_INPUT];
+    for (int n = 0; n < GENERATED_INPUTS; n++)
+    {
+        size_t len = well_formed(buf, &seed);
+        if (n & 1)
+        {
+            // Flip a few bytes or cut the input short
+            for (int k = host_rand(&seed) % 4; k > 0; k--)
+            {
+                buf[host_rand(&seed) % len] ^= (uint8_t)host_rand(&seed);
+            }
+            len = host_rand(&seed) % (len + 1);
+        }
+        LLVMFuzzerTestOneInput(buf, len);
+    }
+    printf("ancs_protocol_fuzz: %d generated inputs passed\n", GENERATED_INPUTS);
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+// Shared by the tests and benchmarks. Include first: it selects POSIX for clock_gettime,
+// the app sources themselves are built as plain C11.
+#define _POSIX_C_SOURCE 200809L
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+static int host_test_failures = 0;
+
+#define CHECK(cond)                                                                      \
+    do                                                                                   \
+    {                                                                                    \
+        if (!(cond))                                                                     \
+        {                                                                                \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond);     \
+            host_test_failures++;                                                        \
+        }                                                                                \
+    } while (0)
+
+// Exit code for main()
+static inline int host_test_result(const char *name)
+{
+    if (host_test_failures)
+    {
+        fprintf(stderr, "%s: %d checks failed\n", name, host_test_failures);
+        return EXIT_FAILURE;
+    }
+    printf("%s: all checks passed\n", name);
+    return EXIT_SUCCESS;
+}
+
+static inline uint64_t host_now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static inline int compare_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Sorts 'samples' in place and returns the value below which 'permille' of them lie
+static inline uint32_t host_percentile(uint32_t *samples, size_t count, unsigned permille)
+{
+    if (count == 0)
+    {
+        return 0;
+    }
+    qsort(samples, count, sizeof(samples[0]), compare_u32);
+    size_t i = count * permille / 1000;
+    return samples[i < count ? i : count - 1];
+}
+
+// Deterministic pseudo-random numbers (xorshift32), the benchmarks replay the same input every run
+static inline uint32_t host_rand(uint32_t *state)
+{
+    uint32_t x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    return *state = x;
+}
+
+#ifdef FIXTURE_DIR
+// Reads a file of host_test/fixtures/ that must be exactly 'size' bytes long
+static inline int host_load_fixture(const char *file, void *buf, size_t size)
+{
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", FIXTURE_DIR, file);
+    FILE *f = fopen(path, "rb");
+    if (f == NULL)
+    {
+        fprintf(stderr, "cannot open %s\n", path);
+        return 0;
+    }
+    size_t len = fread(buf, 1, size, f);
+    int complete = len == size && fgetc(f) == EOF;
+    fclose(f);
+    if (!complete)
+    {
+        fprintf(stderr, "%s is not %zu bytes long\n", path, size);
+    }
+    return complete;
+}
+#endif
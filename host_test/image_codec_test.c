@@ -0,0 +1,187 @@
+#include "host_test.h"
+#include <math.h>
+#include <stdbool.h>
+#include <string.h>
+#include "image_codec.h"
+#include "image_receiver.h"
+#include "q565_encode.h"
+
+// Round trips images through the reference encoder and the streaming decoder, then reports the
+// compression ratio and decode throughput for each of them. The fixtures in fixtures/ are 126x126
+// little endian RGB565 frames made the way the phone app makes them (scaled to fit, centred on
+// black), from the app icon and the two photos in misc/; the synthetic images cover the extremes.
+
+#define PIXELS          (IMAGE_WIDTH * IMAGE_HEIGHT)
+#define DECODE_ROUNDS   200
+#define CHUNK_PAYLOAD   209     // desiredMtu minus the packet header in the phone app
+
+typedef struct
+{
+    const char *name;
+    void (*fill)(uint16_t *img);
+    const char *fixture;
+} test_image_t;
+
+static uint16_t rgb565(int r, int g, int b)
+{
+    return (uint16_t)(((r & 0x1F) << 11) | ((g & 0x3F) << 5) | (b & 0x1F));
+}
+
+// Flat background with a few panels and text-like strokes, as a captured UI screen
+static void fill_ui(uint16_t *img)
+{
+    uint32_t seed = 11;
+    for (int y = 0; y < IMAGE_HEIGHT; y++)
+    {
+        for (int x = 0; x < IMAGE_WIDTH; x++)
+        {
+            uint16_t p = rgb565(2, 4, 6);
+            if (y >= 20 && y < 60 && x >= 10 && x < 116)
+            {
+                p = rgb565(6, 20, 12);
+                if ((y % 10) < 6 && (host_rand(&seed) % 4) == 0)
+                {
+                    p = rgb565(31, 63, 31);
+                }
+            }
+            img[y * IMAGE_WIDTH + x] = p;
+        }
+    }
+}
+
+// Smooth gradients with mild sensor noise, as a camera picture
+static void fill_photo(uint16_t *img)
+{
+    uint32_t seed = 5;
+    for (int y = 0; y < IMAGE_HEIGHT; y++)
+    {
+        for (int x = 0; x < IMAGE_WIDTH; x++)
+        {
+            int noise = host_rand(&seed) % 3 - 1;
+            int r = (int)(16 + 12 * sin(x / 20.0)) + noise;
+            int g = (int)(32 + 24 * cos(y / 25.0)) + noise;
+            int b = (x + y) / 9 + noise;
+            img[y * IMAGE_WIDTH + x] = rgb565(r, g, b);
+        }
+    }
+}
+
+// Incompressible, the stream is larger than the raw frame
+static void fill_noise(uint16_t *img)
+{
+    uint32_t seed = 3;
+    for (int i = 0; i < PIXELS; i++)
+    {
+        img[i] = (uint16_t)host_rand(&seed);
+    }
+}
+
+static const test_image_t images[] = {
+    {"ui", fill_ui, NULL},
+    {"photo", fill_photo, NULL},
+    {"noise", fill_noise, NULL},
+    {"icon", NULL, "app_icon.rgb565"},
+    {"demo", NULL, "image_capture_app.rgb565"},
+    {"glass", NULL, "t_glass_v2.rgb565"},
+};
+
+// Reads a frame as the phone sends it, little endian RGB565
+static bool load_fixture(const char *file, uint16_t *img)
+{
+    uint8_t *bytes = (uint8_t *)img;
+    if (!host_load_fixture(file, bytes, PIXELS * sizeof(uint16_t)))
+    {
+        return false;
+    }
+    for (int i = 0; i < PIXELS; i++)
+    {
+        img[i] = (uint16_t)(bytes[2 * i] | (bytes[2 * i + 1] << 8));
+    }
+    return true;
+}
+
+// Decodes 'stream' in pieces of at most 'chunk' bytes
+static bool decode(const uint8_t *stream, size_t len, size_t chunk, uint16_t *out)
+{
+    q565_decoder_t dec;
+    q565_decoder_init(&dec, out, PIXELS);
+    for (size_t pos = 0; pos < len; pos += chunk)
+    {
+        q565_decode(&dec, &stream[pos], (len - pos < chunk) ? len - pos : chunk);
+    }
+    return q565_decoder_done(&dec);
+}
+
+static void test_round_trip(const test_image_t *image, const uint16_t *img, const uint8_t *stream, size_t len, uint16_t *out)
+{
+    // Ops split at every kind of chunk boundary decode the same
+    static const size_t chunks[] = {1, 2, 3, 7, CHUNK_PAYLOAD, SIZE_MAX};
+    for (size_t i = 0; i < sizeof(chunks) / sizeof(chunks[0]); i++)
+    {
+        memset(out, 0xAA, PIXELS * sizeof(uint16_t));
+        bool done = decode(stream, len, chunks[i], out);
+        CHECK(done);
+        CHECK(memcmp(out, img, PIXELS * sizeof(uint16_t)) == 0);
+        if (!done)
+        {
+            fprintf(stderr, "%s: chunk size %zu failed\n", image->name, chunks[i]);
+        }
+    }
+
+    // A truncated stream never reports a finished frame
+    CHECK(!decode(stream, len - 1, SIZE_MAX, out));
+}
+
+static void test_overrun(uint16_t *out)
+{
+    // 2 runs of 62 pixels into a 100 pixel frame
+    const uint8_t stream[] = {0xC0 | 61, 0xC0 | 61};
+    q565_decoder_t dec;
+    q565_decoder_init(&dec, out, 100);
+    q565_decode(&dec, stream, sizeof(stream));
+    CHECK(dec.error);
+    CHECK(dec.pos == 100);
+    CHECK(!q565_decoder_done(&dec));
+}
+
+static void bench(const test_image_t *image, const uint8_t *stream, size_t len, uint16_t *out)
+{
+    uint64_t start = host_now_ns();
+    for (int i = 0; i < DECODE_ROUNDS; i++)
+    {
+        decode(stream, len, CHUNK_PAYLOAD, out);
+    }
+    double seconds = (host_now_ns() - start) / 1e9;
+    double raw = (double)PIXELS * sizeof(uint16_t);
+    printf("%-6s %6zu bytes, ratio %5.2f:1, decode %7.1f MB/s of pixels (%.1f us per frame)\n",
+           image->name, len, raw / len, raw * DECODE_ROUNDS / seconds / 1e6, seconds * 1e6 / DECODE_ROUNDS);
+}
+
+int main(void)
+{
+    uint16_t *img = malloc(PIXELS * sizeof(uint16_t));
+    uint16_t *out = malloc(PIXELS * sizeof(uint16_t));
+    uint8_t *stream = malloc(PIXELS * 3);
+
+    for (size_t i = 0; i < sizeof(images) / sizeof(images[0]); i++)
+    {
+        if (images[i].fill != NULL)
+        {
+            images[i].fill(img);
+        }
+        else if (!load_fixture(images[i].fixture, img))
+        {
+            CHECK(false);
+            continue;
+        }
+        size_t len = q565_encode(img, PIXELS, stream);
+        test_round_trip(&images[i], img, stream, len, out);
+        bench(&images[i], stream, len, out);
+    }
+    test_overrun(out);
+
+    free(stream);
+    free(out);
+    free(img);
+    return host_test_result("image_codec_test");
+}
@@ -0,0 +1,491 @@
+#include "host_test.h"
+#include <sched.h>
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "image_receiver.h"
+#include "ble_server.h"
+#include "t_glass.h"
+#include "q565_encode.h"
+
+// Replays chunk streams through the receiver as the GATT write callback would, with the real display
+// task on its own thread. Reports the payload rate and the latency of ble_receive_image_chunk(), for
+// random raw frames and for the fixture frames sent the way the phone app sends them.
+
+#define CHUNK_PAYLOAD   209     // desiredMtu (215) minus the packet header, as _sendFrameRange() in the phone app
+#define BENCH_FRAMES    200
+#define CHUNKS_PER_FRAME ((IMAGE_MAX_SIZE + CHUNK_PAYLOAD - 1) / CHUNK_PAYLOAD)
+#define MAX_SAMPLES     (BENCH_FRAMES * CHUNKS_PER_FRAME)
+
+// Canvas stand-in: posted frames replace the one on screen, which goes back to the receiver.
+// While hold_frames is set they are kept instead, as by an LVGL task that fell behind.
+static uint8_t *canvas;
+static _Atomic uint32_t frames_shown;
+static _Atomic bool hold_frames;
+static uint8_t *held[IMAGE_RX_FRAME_COUNT];
+static int held_count;
+
+// Last status notification sent to the phone
+static uint8_t status[3 + IMAGE_RX_MAX_REPORTED_RANGES * 4];
+static size_t status_len;
+
+static uint8_t next_id = 0;
+static uint32_t samples[MAX_SAMPLES];
+static size_t sample_count;
+static bool recording = false;
+
+void lv_gui_ble_status(bool isOn)
+{
+}
+
+void lv_gui_post_frame(uint8_t *frame)
+{
+    if (atomic_load(&hold_frames))
+    {
+        held[held_count++] = frame;
+        atomic_fetch_add(&frames_shown, 1);
+        return;
+    }
+
+    uint8_t *shown = canvas;
+    canvas = frame;
+    image_receiver_release_frame(shown);
+    atomic_fetch_add(&frames_shown, 1);
+}
+
+// Copies the tile records of a TILES payload into 'image', as patch_canvas_tiles() in t_glass.c
+static void apply_tiles(uint8_t *image, const uint8_t *tiles, uint16_t count)
+{
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint8_t tx = *tiles++;
+        uint8_t ty = *tiles++;
+        size_t w = image_tile_span(tx, IMAGE_WIDTH);
+        size_t h = image_tile_span(ty, IMAGE_HEIGHT);
+        for (size_t y = 0; y < h; y++)
+        {
+            size_t pixel = (ty * IMAGE_TILE_SIZE + y) * IMAGE_WIDTH + tx * IMAGE_TILE_SIZE;
+            memcpy(&image[pixel * sizeof(uint16_t)], tiles, w * sizeof(uint16_t));
+            tiles += w * sizeof(uint16_t);
+        }
+    }
+}
+
+void lv_gui_post_tiles(uint8_t *buffer, uint16_t count)
+{
+    apply_tiles(canvas, &buffer[IMAGE_TILES_HEADER_LEN], count);
+    image_receiver_release_frame(buffer);
+    atomic_fetch_add(&frames_shown, 1);
+}
+
+void ble_server_notify(const uint8_t *data, size_t length)
+{
+    memcpy(status, data, length);
+    status_len = length;
+}
+
+static void send_packet(uint8_t id, uint8_t flags, size_t offset, size_t total, const uint8_t *payload, size_t len)
+{
+    uint8_t packet[IMAGE_PKT_HEADER_LEN + CHUNK_PAYLOAD];
+    packet[0] = id;
+    packet[1] = flags;
+    packet[2] = offset & 0xFF;
+    packet[3] = (offset >> 8) & 0xFF;
+    packet[4] = total & 0xFF;
+    packet[5] = (total >> 8) & 0xFF;
+    memcpy(&packet[IMAGE_PKT_HEADER_LEN], payload, len);
+
+    uint64_t start = host_now_ns();
+    ble_receive_image_chunk(packet, IMAGE_PKT_HEADER_LEN + len);
+    uint64_t elapsed = host_now_ns() - start;
+    if (recording && sample_count < MAX_SAMPLES)
+    {
+        samples[sample_count++] = (uint32_t)elapsed;
+    }
+}
+
+static void send_encoded_chunk(uint8_t id, uint8_t encoding, const uint8_t *data, size_t total, size_t chunk)
+{
+    size_t offset = chunk * CHUNK_PAYLOAD;
+    size_t len = (total - offset < CHUNK_PAYLOAD) ? total - offset : CHUNK_PAYLOAD;
+    send_packet(id, encoding, offset, total, &data[offset], len);
+}
+
+static void send_chunk(uint8_t id, const uint8_t *frame, size_t chunk)
+{
+    send_encoded_chunk(id, IMAGE_ENCODING_RAW, frame, IMAGE_MAX_SIZE, chunk);
+}
+
+// Returns the status byte of the answer
+static int query_encoded(uint8_t id, uint8_t encoding, size_t total)
+{
+    status_len = 0;
+    send_packet(id, encoding | IMAGE_PKT_FLAG_QUERY, 0, total, NULL, 0);
+    return (status_len >= 3 && status[0] == id) ? status[1] : -1;
+}
+
+static int query(uint8_t id)
+{
+    return query_encoded(id, IMAGE_ENCODING_RAW, IMAGE_MAX_SIZE);
+}
+
+static bool wait_shown(uint32_t count)
+{
+    int64_t deadline = esp_timer_get_time() + 2000000;
+    while (atomic_load(&frames_shown) < count)
+    {
+        if (esp_timer_get_time() > deadline)
+        {
+            return false;
+        }
+        sched_yield();
+    }
+    return true;
+}
+
+static void fill_frame(uint8_t *frame, uint32_t seed)
+{
+    for (size_t i = 0; i < IMAGE_MAX_SIZE; i++)
+    {
+        frame[i] = (uint8_t)host_rand(&seed);
+    }
+}
+
+static void shuffle(size_t *order, size_t count, uint32_t *seed)
+{
+    for (size_t i = count - 1; i > 0; i--)
+    {
+        size_t j = host_rand(seed) % (i + 1);
+        size_t t = order[i];
+        order[i] = order[j];
+        order[j] = t;
+    }
+}
+
+static void test_in_order(uint8_t *frame)
+{
+    uint8_t id = ++next_id;
+    uint32_t shown = atomic_load(&frames_shown);
+    fill_frame(frame, 1);
+    for (size_t c = 0; c < CHUNKS_PER_FRAME; c++)
+    {
+        send_chunk(id, frame, c);
+    }
+    CHECK(query(id) == IMAGE_STATUS_COMPLETE);
+    CHECK(wait_shown(shown + 1));
+    CHECK(memcmp(canvas, frame, IMAGE_MAX_SIZE) == 0);
+}
+
+static void test_missing_chunk(uint8_t *frame)
+{
+    const size_t lost = 17;
+    uint8_t id = ++next_id;
+    uint32_t shown = atomic_load(&frames_shown);
+    fill_frame(frame, 2);
+
+    // Backwards with one chunk lost on the way
+    for (size_t c = CHUNKS_PER_FRAME; c-- > 0;)
+    {
+        if (c != lost)
+        {
+            send_chunk(id, frame, c);
+        }
+    }
+    CHECK(query(id) == IMAGE_STATUS_MISSING);
+    CHECK(status[2] == 1);
+    CHECK((status[3] | (status[4] << 8)) == lost * CHUNK_PAYLOAD);
+    CHECK((status[5] | (status[6] << 8)) == CHUNK_PAYLOAD);
+
+    send_chunk(id, frame, lost);
+    CHECK(query(id) == IMAGE_STATUS_COMPLETE);
+    CHECK(wait_shown(shown + 1));
+    CHECK(memcmp(canvas, frame, IMAGE_MAX_SIZE) == 0);
+
+    // Chunks of a frame that is complete are late
+    CHECK(query((uint8_t)(id - 1)) == IMAGE_STATUS_UNKNOWN_FRAME);
+}
+
+// Sends a whole frame in order and returns the answer to the query that follows
+static int send_frame(uint8_t id, uint8_t encoding, const uint8_t *data, size_t total)
+{
+    for (size_t c = 0; c * CHUNK_PAYLOAD < total; c++)
+    {
+        send_encoded_chunk(id, encoding, data, total, c);
+    }
+    return query_encoded(id, encoding, total);
+}
+
+// Builds a TILES payload for 'base' with the listed tiles, filled from 'seed'. Returns its length.
+static size_t build_tiles(uint8_t *out, uint8_t base, const uint8_t (*pos)[2], uint16_t count, uint32_t seed)
+{
+    size_t len = IMAGE_TILES_HEADER_LEN;
+    out[0] = base;
+    out[1] = count & 0xFF;
+    out[2] = count >> 8;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        out[len++] = pos[i][0];
+        out[len++] = pos[i][1];
+        size_t bytes = image_tile_span(pos[i][0], IMAGE_WIDTH) * image_tile_span(pos[i][1], IMAGE_HEIGHT) * sizeof(uint16_t);
+        for (size_t b = 0; b < bytes; b++)
+        {
+            out[len++] = (uint8_t)host_rand(&seed);
+        }
+    }
+    return len;
+}
+
+static void test_tiles(uint8_t *frame)
+{
+    static const uint8_t pos[][2] = {{0, 0}, {7, 3}, {IMAGE_TILE_COLS - 1, IMAGE_TILE_ROWS - 1}};
+    const uint16_t count = sizeof(pos) / sizeof(pos[0]);
+    uint8_t tiles[IMAGE_TILES_HEADER_LEN + 3 * (IMAGE_TILE_RECORD_LEN + IMAGE_TILE_SIZE * IMAGE_TILE_SIZE * 2) + 1];
+    uint8_t *expected = malloc(IMAGE_MAX_SIZE);
+    image_rx_stats_t before, after;
+
+    // Base frame
+    uint8_t base = ++next_id;
+    uint32_t shown = atomic_load(&frames_shown);
+    fill_frame(frame, 5);
+    CHECK(send_frame(base, IMAGE_ENCODING_RAW, frame, IMAGE_MAX_SIZE) == IMAGE_STATUS_COMPLETE);
+    CHECK(wait_shown(++shown));
+
+    // A valid delta patches three tiles, one of them clipped in both directions
+    image_receiver_get_stats(&before);
+    size_t len = build_tiles(tiles, base, pos, count, 9);
+    memcpy(expected, frame, IMAGE_MAX_SIZE);
+    apply_tiles(expected, &tiles[IMAGE_TILES_HEADER_LEN], count);
+    uint8_t id = ++next_id;
+    CHECK(send_frame(id, IMAGE_ENCODING_TILES, tiles, len) == IMAGE_STATUS_COMPLETE);
+    CHECK(wait_shown(++shown));
+    CHECK(memcmp(canvas, expected, IMAGE_MAX_SIZE) == 0);
+    image_receiver_get_stats(&after);
+    CHECK(after.tiles_applied == before.tiles_applied + count);
+    CHECK(after.rejected_deltas == before.rejected_deltas);
+    base = id;
+
+    // Malformed payloads are rejected and leave the canvas alone
+    uint8_t bad[sizeof(tiles)];
+    for (int kind = 0; kind < 6; kind++)
+    {
+        size_t bad_len = build_tiles(bad, base, pos, count, 10);
+        switch (kind)
+        {
+        case 0: // More tiles announced than present
+            bad[1] = count + 1;
+            break;
+        case 1: // Fewer tiles announced than present, the last record is trailing garbage
+            bad[1] = count - 1;
+            break;
+        case 2: // Trailing byte after the last record
+            bad[bad_len++] = 0;
+            break;
+        case 3: // Tile column past the image
+            bad[IMAGE_TILES_HEADER_LEN] = IMAGE_TILE_COLS;
+            break;
+        case 4: // Tile row past the image
+            bad[IMAGE_TILES_HEADER_LEN + 1] = IMAGE_TILE_ROWS;
+            break;
+        default: // Shorter than the header
+            bad_len = IMAGE_TILES_HEADER_LEN - 1;
+            break;
+        }
+
+        image_receiver_get_stats(&before);
+        id = ++next_id;
+        CHECK(send_frame(id, IMAGE_ENCODING_TILES, bad, bad_len) == IMAGE_STATUS_REJECTED);
+        // Asking again gets the same answer
+        CHECK(query_encoded(id, IMAGE_ENCODING_TILES, bad_len) == IMAGE_STATUS_REJECTED);
+        image_receiver_get_stats(&after);
+        CHECK(after.rejected_deltas == before.rejected_deltas + 1);
+        if (after.rejected_deltas != before.rejected_deltas + 1)
+        {
+            fprintf(stderr, "malformed tiles case %d accepted\n", kind);
+        }
+    }
+
+    // A delta on a frame other than the last one completed is stale
+    len = build_tiles(tiles, (uint8_t)(base - 1), pos, count, 11);
+    CHECK(send_frame(++next_id, IMAGE_ENCODING_TILES, tiles, len) == IMAGE_STATUS_REJECTED);
+
+    // The base is still valid after rejected deltas
+    len = build_tiles(tiles, base, pos, 1, 12);
+    apply_tiles(expected, &tiles[IMAGE_TILES_HEADER_LEN], 1);
+    id = ++next_id;
+    CHECK(send_frame(id, IMAGE_ENCODING_TILES, tiles, len) == IMAGE_STATUS_COMPLETE);
+    CHECK(wait_shown(++shown));
+    base = id;
+
+    // After a reconnection nothing on screen counts as a base
+    ble_disconnected();
+    len = build_tiles(tiles, base, pos, count, 13);
+    CHECK(send_frame(++next_id, IMAGE_ENCODING_TILES, tiles, len) == IMAGE_STATUS_REJECTED);
+
+    // None of the rejected deltas reached the canvas
+    CHECK(atomic_load(&frames_shown) == shown);
+    CHECK(memcmp(canvas, expected, IMAGE_MAX_SIZE) == 0);
+
+    // The full frame the sender falls back to is accepted
+    CHECK(send_frame(++next_id, IMAGE_ENCODING_RAW, frame, IMAGE_MAX_SIZE) == IMAGE_STATUS_COMPLETE);
+    CHECK(wait_shown(++shown));
+    CHECK(memcmp(canvas, frame, IMAGE_MAX_SIZE) == 0);
+    free(expected);
+}
+
+static void test_encoded_frame_waits_for_buffer(uint8_t *frame)
+{
+    // Two frames the display holds on to take every free buffer
+    atomic_store(&hold_frames, true);
+    uint32_t shown = atomic_load(&frames_shown);
+    fill_frame(frame, 4);
+    for (int f = 0; f < IMAGE_RX_FRAME_COUNT - 1; f++)
+    {
+        uint8_t id = ++next_id;
+        for (size_t c = 0; c < CHUNKS_PER_FRAME; c++)
+        {
+            send_chunk(id, frame, c);
+        }
+        CHECK(wait_shown(++shown));
+    }
+    CHECK(held_count == IMAGE_RX_FRAME_COUNT - 1);
+
+    // An encoded frame arrives in full, it can only be staged
+    uint16_t *pixels = malloc(IMAGE_MAX_SIZE);
+    uint8_t *stream = malloc(IMAGE_MAX_SIZE / 2 * 3);
+    for (size_t i = 0; i < IMAGE_MAX_SIZE / 2; i++)
+    {
+        pixels[i] = (uint16_t)((i / IMAGE_WIDTH) << 5 | (i % IMAGE_WIDTH) / 4);
+    }
+    size_t len = q565_encode(pixels, IMAGE_MAX_SIZE / 2, stream);
+    CHECK(len <= IMAGE_MAX_SIZE);
+    uint8_t id = ++next_id;
+    for (size_t c = 0; c * CHUNK_PAYLOAD < len; c++)
+    {
+        send_encoded_chunk(id, IMAGE_ENCODING_Q565, stream, len, c);
+    }
+    CHECK(query_encoded(id, IMAGE_ENCODING_Q565, len) == IMAGE_STATUS_BUSY);
+
+    // Once a buffer comes back the next query decodes and completes it
+    atomic_store(&hold_frames, false);
+    image_receiver_release_frame(held[--held_count]);
+    CHECK(query_encoded(id, IMAGE_ENCODING_Q565, len) == IMAGE_STATUS_COMPLETE);
+    CHECK(wait_shown(++shown));
+    CHECK(memcmp(canvas, pixels, IMAGE_MAX_SIZE) == 0);
+
+    while (held_count > 0)
+    {
+        image_receiver_release_frame(held[--held_count]);
+    }
+    free(stream);
+    free(pixels);
+}
+
+// Sends 'frames' copies of a frame of 'total' bytes one chunk after the other, in order or shuffled
+static void bench(const char *name, uint8_t encoding, const uint8_t *data, size_t total, const uint8_t *expected, bool shuffled)
+{
+    size_t chunks = (total + CHUNK_PAYLOAD - 1) / CHUNK_PAYLOAD;
+    size_t order[CHUNKS_PER_FRAME];
+    uint32_t seed = 7;
+    uint64_t busy_ns = 0;
+
+    sample_count = 0;
+    uint32_t shown = atomic_load(&frames_shown);
+    uint64_t start = host_now_ns();
+
+    for (int f = 0; f < BENCH_FRAMES; f++)
+    {
+        for (size_t c = 0; c < chunks; c++)
+        {
+            order[c] = c;
+        }
+        if (shuffled)
+        {
+            shuffle(order, chunks, &seed);
+        }
+
+        uint8_t id = ++next_id;
+        recording = true;
+        for (size_t c = 0; c < chunks; c++)
+        {
+            send_encoded_chunk(id, encoding, data, total, order[c]);
+        }
+        recording = false;
+        // One frame at a time, as the sender waits for the status before the next one
+        CHECK(query_encoded(id, encoding, total) == IMAGE_STATUS_COMPLETE);
+        CHECK(wait_shown(++shown));
+    }
+    CHECK(memcmp(canvas, expected, IMAGE_MAX_SIZE) == 0);
+
+    uint64_t wall_ns = host_now_ns() - start;
+    for (size_t i = 0; i < sample_count; i++)
+    {
+        busy_ns += samples[i];
+    }
+    double bytes = (double)BENCH_FRAMES * IMAGE_MAX_SIZE;
+    printf("%-10s %4d frames of %5zu bytes: %8.1f MB/s of pixels in the callback, %6.1f frames/s end to end, "
+           "callback avg %.2f us, p99 %.2f us, max %.2f us\n",
+           name, BENCH_FRAMES, total, bytes / (busy_ns / 1e9) / 1e6, BENCH_FRAMES / (wall_ns / 1e9),
+           busy_ns / 1e3 / sample_count, host_percentile(samples, sample_count, 990) / 1e3,
+           host_percentile(samples, sample_count, 1000) / 1e3);
+}
+
+// Sends a fixture as _sendImageOverBLE() in the phone app does with a full image: Q565 when that
+// is smaller than the raw frame, in CHUNK_PAYLOAD chunks from the start
+static void bench_fixture(const char *name, const char *file)
+{
+    uint8_t *pixels = malloc(IMAGE_MAX_SIZE);
+    uint8_t *stream = malloc(IMAGE_MAX_SIZE / 2 * 3);
+    if (!host_load_fixture(file, pixels, IMAGE_MAX_SIZE))
+    {
+        CHECK(false);
+    }
+    else
+    {
+        // The fixtures are little endian like the frame buffers, the encoder takes whole pixels
+        uint16_t *native = malloc(IMAGE_MAX_SIZE);
+        for (size_t i = 0; i < IMAGE_MAX_SIZE / 2; i++)
+        {
+            native[i] = (uint16_t)(pixels[2 * i] | (pixels[2 * i + 1] << 8));
+        }
+        size_t len = q565_encode(native, IMAGE_MAX_SIZE / 2, stream);
+        if (len < IMAGE_MAX_SIZE)
+        {
+            bench(name, IMAGE_ENCODING_Q565, stream, len, (const uint8_t *)native, false);
+        }
+        else
+        {
+            bench(name, IMAGE_ENCODING_RAW, pixels, IMAGE_MAX_SIZE, pixels, false);
+        }
+        free(native);
+    }
+    free(stream);
+    free(pixels);
+}
+
+int main(void)
+{
+    canvas = calloc(1, IMAGE_MAX_SIZE);
+    uint8_t *frame = malloc(IMAGE_MAX_SIZE);
+    CHECK(image_receiver_init() == ESP_OK);
+
+    test_in_order(frame);
+    test_missing_chunk(frame);
+    test_encoded_frame_waits_for_buffer(frame);
+    test_tiles(frame);
+    fill_frame(frame, 3);
+    bench("in order", IMAGE_ENCODING_RAW, frame, IMAGE_MAX_SIZE, frame, false);
+    bench("shuffled", IMAGE_ENCODING_RAW, frame, IMAGE_MAX_SIZE, frame, true);
+    bench_fixture("icon", "app_icon.rgb565");
+    bench_fixture("demo", "image_capture_app.rgb565");
+    bench_fixture("glass", "t_glass_v2.rgb565");
+
+    image_rx_stats_t stats;
+    image_receiver_get_stats(&stats);
+    CHECK(stats.dropped_chunks == 0);
+    CHECK(stats.invalid_chunks == 0);
+    printf("receiver: %u frames, worst callback %u us\n", (unsigned)stats.frames_completed, (unsigned)stats.max_callback_us);
+
+    free(frame);
+    return host_test_result("image_receiver_bench");
+}
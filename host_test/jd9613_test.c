@@ -0,0 +1,206 @@
+#include "host_test.h"
+#include <stdbool.h>
+#include <string.h>
+#include "esp_lcd_panel_io.h"
+#include "esp_lcd_panel_ops.h"
+#include "esp_lcd_panel_commands.h"
+#include "jd9613.h"
+
+// Checks the RAM window of flushes and the byte swap of the scalar path (the host has no PIE unit)
+// against a panel IO that records what the driver sends, then times the swap for a full stripe.
+
+#define STRIPE_LINES    42
+#define BENCH_ROUNDS    2000
+
+static uint8_t caset[4];
+static uint8_t raset[4];
+static uint8_t *sent;           // Copy of the last RAMWR transfer
+static size_t sent_size;
+static const void *sent_from;   // Buffer it was sent from
+
+static int last_cmd = -1;
+
+// Every color transfer since the panel was created
+static size_t color_bytes;
+static size_t max_color_size;
+static bool color_nonzero;
+
+esp_err_t esp_lcd_panel_io_tx_param(esp_lcd_panel_io_handle_t io, int lcd_cmd, const void *param, size_t param_size)
+{
+    last_cmd = lcd_cmd;
+    if (lcd_cmd == LCD_CMD_CASET && param_size == 4)
+    {
+        memcpy(caset, param, 4);
+    }
+    else if (lcd_cmd == LCD_CMD_RASET && param_size == 4)
+    {
+        memcpy(raset, param, 4);
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_lcd_panel_io_tx_color(esp_lcd_panel_io_handle_t io, int lcd_cmd, const void *color, size_t color_size)
+{
+    sent = realloc(sent, color_size);
+    memcpy(sent, color, color_size);
+    sent_size = color_size;
+    sent_from = color;
+
+    color_bytes += color_size;
+    max_color_size = (color_size > max_color_size) ? color_size : max_color_size;
+    for (size_t i = 0; i < color_size; i++)
+    {
+        color_nonzero |= sent[i] != 0;
+    }
+    return ESP_OK;
+}
+
+static void check_window(uint8_t rotation, int x_gap, int y_gap, int xs, int ys, int xe, int ye,
+                         int ex, int ey, int exe, int eye)
+{
+    jd9613_window_t win;
+    jd9613_flush_window(rotation, x_gap, y_gap, xs, ys, xe, ye, &win);
+    CHECK(win.x == ex && win.y == ey && win.xe == exe && win.ye == eye);
+    if (win.x != ex || win.y != ey || win.xe != exe || win.ye != eye)
+    {
+        fprintf(stderr, "rotation %d: got %d,%d-%d,%d\n", rotation, win.x, win.y, win.xe, win.ye);
+    }
+}
+
+static void test_flush_window(void)
+{
+    // The visible 126x126 window sits at row 168 of the 126x294 panel
+    check_window(0, 0, 168, 0, 0, 126, 126, 0, 168, 126, 294);
+    check_window(0, 0, 168, 10, 20, 30, 62, 10, 188, 30, 230);
+    check_window(0, 0, 0, 0, 0, 126, 294, 0, 0, 126, 294);
+    // Rotation 2 lands 2 columns over in the flipped RAM
+    check_window(2, 0, 168, 10, 20, 30, 62, 12, 188, 32, 230);
+    // Rotations 1 and 3 are transposed: x runs down from the panel width, y follows x
+    check_window(1, 0, 0, 10, 20, 30, 62, JD9613_WIDTH - 62, 10, JD9613_WIDTH - 20, 30);
+    check_window(3, 0, 0, 0, 0, 294, 126, 0, 0, 126, 294);
+    check_window(1, 4, 0, 0, 0, 8, 8, JD9613_WIDTH - 8, 4, JD9613_WIDTH, 12);
+}
+
+// Init blanks the whole panel RAM with a stripe far smaller than the panel
+static void test_clear(void)
+{
+    CHECK(color_bytes == JD9613_WIDTH * JD9613_HEIGHT * sizeof(uint16_t));
+    CHECK(!color_nonzero);
+    CHECK(max_color_size <= JD9613_WIDTH * 8 * sizeof(uint16_t));
+    // The last stripe ends on the last row
+    CHECK(raset[2] == ((JD9613_HEIGHT - 1) >> 8) && raset[3] == ((JD9613_HEIGHT - 1) & 0xFF));
+}
+
+static void test_draw_window(esp_lcd_panel_handle_t panel)
+{
+    uint16_t pixels[20 * 42];
+    memset(pixels, 0, sizeof(pixels));
+    CHECK(esp_lcd_panel_draw_bitmap(panel, 10, 20, 30, 62, pixels) == ESP_OK);
+    // CASET and RASET carry the inclusive end
+    CHECK(caset[0] == 0 && caset[1] == 10 && caset[2] == 0 && caset[3] == 29);
+    CHECK(raset[0] == 0 && raset[1] == 188 && raset[2] == 0 && raset[3] == 229);
+    CHECK(sent_size == sizeof(pixels));
+}
+
+static void test_swap(esp_lcd_panel_handle_t panel)
+{
+    // Odd and even widths, aligned and unaligned sources, every length class of the unrolled loop
+    static const int widths[] = {1, 2, 3, 7, 8, 9, 16, 17, 126};
+    uint16_t *src = malloc((126 * 3 + 1) * sizeof(uint16_t));
+    uint32_t seed = 9;
+
+    for (size_t w = 0; w < sizeof(widths) / sizeof(widths[0]); w++)
+    {
+        for (int shift = 0; shift < 2; shift++)
+        {
+            int width = widths[w];
+            size_t count = width * 3;
+            uint16_t *pixels = src + shift;
+            for (size_t i = 0; i < count; i++)
+            {
+                pixels[i] = (uint16_t)host_rand(&seed);
+            }
+
+            CHECK(esp_lcd_panel_draw_bitmap(panel, 0, 0, width, 3, pixels) == ESP_OK);
+            CHECK(sent_size == count * sizeof(uint16_t));
+            CHECK(sent_from != pixels);
+            bool same = true;
+            for (size_t i = 0; i < count; i++)
+            {
+                uint16_t out = (uint16_t)(sent[2 * i] | (sent[2 * i + 1] << 8));
+                same &= (out == (uint16_t)((pixels[i] >> 8) | (pixels[i] << 8)));
+            }
+            CHECK(same);
+        }
+    }
+
+    jd9613_swap_stats_t stats;
+    panel_jd9613_get_swap_stats(panel, &stats);
+    CHECK(stats.scalar_pixels > 0);
+    CHECK(stats.simd_pixels == 0);
+
+    // Pixels LVGL already rendered big endian go out untouched from its buffer
+    panel_jd9613_set_byte_order(panel, JD9613_BYTE_ORDER_NATIVE);
+    CHECK(esp_lcd_panel_draw_bitmap(panel, 0, 0, 7, 3, src) == ESP_OK);
+    CHECK(sent_from == src);
+    CHECK(memcmp(sent, src, 7 * 3 * sizeof(uint16_t)) == 0);
+    panel_jd9613_set_byte_order(panel, JD9613_BYTE_ORDER_SWAP);
+    free(src);
+}
+
+static void test_disp_on_off(esp_lcd_panel_handle_t panel)
+{
+    CHECK(esp_lcd_panel_disp_on_off(panel, false) == ESP_OK);
+    CHECK(last_cmd == LCD_CMD_DISPOFF);
+    CHECK(esp_lcd_panel_disp_on_off(panel, true) == ESP_OK);
+    CHECK(last_cmd == LCD_CMD_DISPON);
+}
+
+static void bench_swap(esp_lcd_panel_handle_t panel)
+{
+    size_t count = JD9613_WIDTH * STRIPE_LINES;
+    uint16_t *pixels = aligned_alloc(16, count * sizeof(uint16_t));
+    memset(pixels, 0x5A, count * sizeof(uint16_t));
+
+    jd9613_swap_stats_t before, after;
+    panel_jd9613_get_swap_stats(panel, &before);
+    uint64_t start = host_now_ns();
+    for (int i = 0; i < BENCH_ROUNDS; i++)
+    {
+        esp_lcd_panel_draw_bitmap(panel, 0, 0, JD9613_WIDTH, STRIPE_LINES, pixels);
+    }
+    double seconds = (host_now_ns() - start) / 1e9;
+    panel_jd9613_get_swap_stats(panel, &after);
+
+    // The host stub counts nanoseconds where the ESP32-S3 counts cycles
+    uint64_t swapped = after.scalar_pixels - before.scalar_pixels;
+    printf("scalar swap: %.1f Mpixels/s for %dx%d stripes, %.2f ns per pixel in the kernel\n",
+           swapped / seconds / 1e6, JD9613_WIDTH, STRIPE_LINES,
+           (double)(after.scalar_cycles - before.scalar_cycles) / swapped);
+    free(pixels);
+}
+
+int main(void)
+{
+    esp_lcd_panel_dev_config_t config = {
+        .reset_gpio_num = -1,
+        .bits_per_pixel = 16,
+    };
+    esp_lcd_panel_handle_t panel = NULL;
+    esp_lcd_panel_io_handle_t io = (esp_lcd_panel_io_handle_t)&config;
+    CHECK(esp_lcd_new_panel_jd9613(io, &config, &panel) == ESP_OK);
+    CHECK(esp_lcd_panel_init(panel) == ESP_OK);
+    test_clear();
+    CHECK(esp_lcd_panel_set_gap(panel, 0, 168) == ESP_OK);
+
+    test_flush_window();
+    test_draw_window(panel);
+    test_disp_on_off(panel);
+    CHECK(esp_lcd_panel_set_gap(panel, 0, 0) == ESP_OK);
+    test_swap(panel);
+    bench_swap(panel);
+
+    esp_lcd_panel_del(panel);
+    free(sent);
+    return host_test_result("jd9613_test");
+}
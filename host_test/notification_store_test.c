@@ -0,0 +1,304 @@
+#include "host_test.h"
+#include <stdbool.h>
+#include <string.h>
+#include "notification_store.h"
+#include "text_arena.h"
+
+// Checks the text arena's compaction and the store's hash table and arrival ring against a plain
+// model under random churn, then measures both at the sizes the app uses.
+
+#define MODEL_CAPACITY  16
+#define MODEL_UIDS      64      // UIDs drawn from a small range so inserts hit stored ones
+#define MODEL_OPS       200000
+#define BENCH_OPS       2000000
+
+// Fills a string for 'owner' so its content identifies it after blocks moved
+static bool put_text(const char **owner, uint32_t tag, size_t len)
+{
+    char *text = text_arena_alloc(owner, len + 1);
+    if (!text)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        text[i] = 'a' + (tag + i) % 26;
+    }
+    text[len] = '\0';
+    return true;
+}
+
+static bool text_matches(const char *text, uint32_t tag, size_t len)
+{
+    if (strlen(text) != len)
+    {
+        return false;
+    }
+    for (size_t i = 0; i < len; i++)
+    {
+        if (text[i] != (char)('a' + (tag + i) % 26))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void test_arena(void)
+{
+    text_arena_stats_t stats;
+    CHECK(text_arena_alloc(&(const char *){text_arena_empty}, 4) == NULL);  // Before init
+    CHECK(text_arena_init(256, MALLOC_CAP_8BIT) == ESP_OK);
+
+    // Blocks are aligned for their header and the empty string is never owned by the arena
+    const char *owners[8];
+    for (int i = 0; i < 8; i++)
+    {
+        owners[i] = text_arena_empty;
+    }
+    CHECK(put_text(&owners[0], 0, 5));
+    CHECK(put_text(&owners[1], 1, 1));
+    CHECK(((uintptr_t)owners[1] % sizeof(void *)) == 0);
+    text_arena_free(&owners[2]);
+    CHECK(owners[2] == text_arena_empty);
+
+    // Free the first, fill up to force a compaction: the survivor slides down and its owner follows
+    const char *before = owners[1];
+    text_arena_free(&owners[0]);
+    CHECK(owners[0] == text_arena_empty);
+    // The block header is what an empty allocation costs
+    text_arena_get_stats(&stats);
+    uint32_t live = stats.live;
+    CHECK(text_arena_alloc(&owners[3], 0) != NULL);
+    text_arena_get_stats(&stats);
+    size_t header = stats.live - live;
+    text_arena_free(&owners[3]);
+    uint32_t room = stats.size - live;
+    CHECK(put_text(&owners[2], 2, room - header - 1));
+    text_arena_get_stats(&stats);
+    CHECK(stats.compactions == 1);
+    CHECK(owners[1] != before && text_matches(owners[1], 1, 1));
+    CHECK(text_matches(owners[2], 2, room - header - 1));
+    CHECK(stats.live == stats.size && stats.used == stats.size && stats.blocks == 2);
+
+    // Full: the owner is left empty and the failure counted
+    CHECK(!put_text(&owners[3], 3, 1));
+    CHECK(owners[3] == text_arena_empty);
+    text_arena_get_stats(&stats);
+    CHECK(stats.failures == 1);
+
+    // Reallocating through the same owner releases its old block first
+    CHECK(put_text(&owners[1], 4, 3));
+    CHECK(text_matches(owners[1], 4, 3));
+
+    text_arena_reset();
+    text_arena_get_stats(&stats);
+    CHECK(stats.used == 0 && stats.live == 0 && stats.blocks == 0);
+    CHECK(stats.high_water == stats.size);
+
+    // Random churn, every owner must still see its own text
+    const char *churn[32];
+    uint32_t tags[32];
+    size_t lens[32];
+    for (int i = 0; i < 32; i++)
+    {
+        churn[i] = text_arena_empty;
+        lens[i] = 0;
+    }
+    uint32_t seed = 7;
+    for (int n = 0; n < 100000; n++)
+    {
+        int i = host_rand(&seed) % 32;
+        if (host_rand(&seed) % 4 == 0)
+        {
+            text_arena_free(&churn[i]);
+            lens[i] = 0;
+        }
+        else
+        {
+            tags[i] = host_rand(&seed);
+            lens[i] = host_rand(&seed) % 40;
+            if (!put_text(&churn[i], tags[i], lens[i]))
+            {
+                lens[i] = 0;
+            }
+        }
+        CHECK(churn[i] == text_arena_empty || text_matches(churn[i], tags[i], lens[i]));
+    }
+    for (int i = 0; i < 32; i++)
+    {
+        CHECK(text_matches(churn[i], tags[i], lens[i]));
+    }
+    text_arena_get_stats(&stats);
+    CHECK(stats.compactions > 1 && stats.live <= stats.size);
+}
+
+typedef struct
+{
+    uint32_t uids[MODEL_CAPACITY];  // Arrival order, oldest first
+    int count;
+} store_model_t;
+
+static int model_index(const store_model_t *m, uint32_t uid)
+{
+    for (int i = 0; i < m->count; i++)
+    {
+        if (m->uids[i] == uid)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void model_remove_at(store_model_t *m, int i)
+{
+    memmove(&m->uids[i], &m->uids[i + 1], (m->count - i - 1) * sizeof(m->uids[0]));
+    m->count--;
+}
+
+typedef struct
+{
+    const store_model_t *model;
+    int visited;
+    bool in_order;
+} order_check_t;
+
+static void check_order(NotificationAttributes *notification, void *ctx)
+{
+    order_check_t *oc = ctx;
+    if (oc->visited >= oc->model->count || oc->model->uids[oc->visited] != notification->NotificationUID)
+    {
+        oc->in_order = false;
+    }
+    if (!text_matches(notification->Title, notification->NotificationUID, notification->NotificationUID % 23) &&
+        notification->Title != text_arena_empty)
+    {
+        oc->in_order = false;
+    }
+    oc->visited++;
+}
+
+static void test_store(void)
+{
+    CHECK(notification_store_init(0, 1024, MALLOC_CAP_8BIT) == ESP_ERR_INVALID_ARG);
+    // A small arena so the titles keep getting compacted underneath the store
+    CHECK(notification_store_init(MODEL_CAPACITY, 512, MALLOC_CAP_8BIT) == ESP_OK);
+
+    store_model_t model = {0};
+    uint32_t seed = 42;
+    uint32_t evictions = 0;
+    for (int n = 0; n < MODEL_OPS; n++)
+    {
+        // Spread the UIDs so some share a home bucket and probe sequences wrap
+        uint32_t uid = (host_rand(&seed) % MODEL_UIDS) * 0x9E3779B1u;
+        if (host_rand(&seed) % 3 == 0)
+        {
+            int i = model_index(&model, uid);
+            CHECK(notification_store_remove(uid) == (i >= 0));
+            if (i >= 0)
+            {
+                model_remove_at(&model, i);
+            }
+            continue;
+        }
+
+        bool evicted;
+        uint32_t evicted_uid = 0;
+        int i = model_index(&model, uid);
+        uint32_t oldest = model.uids[0];
+        NotificationAttributes *slot = notification_store_insert(uid, &evicted, &evicted_uid);
+        CHECK(slot != NULL && slot->NotificationUID == uid);
+        if (i >= 0)
+        {
+            CHECK(!evicted);
+            continue;
+        }
+        CHECK(evicted == (model.count == MODEL_CAPACITY));
+        if (model.count == MODEL_CAPACITY)
+        {
+            CHECK(evicted_uid == oldest);
+            model_remove_at(&model, 0);
+            evictions++;
+        }
+        model.uids[model.count++] = uid;
+        put_text(&slot->Title, uid, uid % 23);
+
+        // Every UID of the range, stored or not
+        for (uint32_t k = 0; k < MODEL_UIDS && (n % 64) == 0; k++)
+        {
+            uint32_t probe = k * 0x9E3779B1u;
+            NotificationAttributes *found = notification_store_find(probe);
+            CHECK((found != NULL) == (model_index(&model, probe) >= 0));
+            CHECK(found == NULL || found->NotificationUID == probe);
+        }
+    }
+
+    CHECK(notification_store_count() == model.count);
+    order_check_t oc = {.model = &model, .in_order = true};
+    notification_store_for_each(check_order, &oc);
+    CHECK(oc.visited == model.count && oc.in_order);
+
+    notification_store_stats_t stats;
+    notification_store_get_stats(&stats);
+    CHECK(stats.capacity == MODEL_CAPACITY && stats.count == model.count);
+    CHECK(stats.evicted == evictions);
+    CHECK(stats.inserted - stats.removed - stats.evicted == stats.count);
+
+    // Releasing the text leaves the notification stored with empty fields
+    NotificationAttributes *first = notification_store_find(model.uids[0]);
+    notification_store_release_text(first);
+    CHECK(first->Title == text_arena_empty && first->Message == text_arena_empty);
+
+    notification_store_lock();
+    notification_store_clear();
+    notification_store_unlock();
+    CHECK(notification_store_count() == 0);
+    CHECK(notification_store_find(model.uids[0]) == NULL);
+    text_arena_stats_t arena;
+    text_arena_get_stats(&arena);
+    CHECK(arena.live == 0);
+}
+
+static void bench_store(void)
+{
+    // The app's configuration: consecutive UIDs from the phone, a title per notification, the oldest
+    // dropped for each new one once the store is full
+    CHECK(notification_store_init(MAX_NOTIFICATIONS, NOTIFICATION_TEXT_ARENA_SIZE, MALLOC_CAP_8BIT) == ESP_OK);
+    uint64_t start = host_now_ns();
+    for (uint32_t uid = 0; uid < BENCH_OPS; uid++)
+    {
+        bool evicted;
+        NotificationAttributes *slot = notification_store_insert(uid, &evicted, NULL);
+        put_text(&slot->Title, uid, 20 + uid % 40);
+    }
+    double insert_s = (host_now_ns() - start) / 1e9;
+
+    volatile uint32_t hits = 0;
+    start = host_now_ns();
+    for (uint32_t n = 0; n < BENCH_OPS; n++)
+    {
+        // Half stored, half already evicted
+        hits += notification_store_find(BENCH_OPS - 1 - n % (2 * MAX_NOTIFICATIONS)) != NULL;
+    }
+    double find_s = (host_now_ns() - start) / 1e9;
+    CHECK(hits == BENCH_OPS / 2);
+
+    notification_store_stats_t stats;
+    text_arena_stats_t arena;
+    notification_store_get_stats(&stats);
+    text_arena_get_stats(&arena);
+    CHECK(stats.count == MAX_NOTIFICATIONS && arena.failures == 0);
+    printf("notification store, %d slots: %.1f M inserts/s with a title, %.1f M lookups/s\n",
+           MAX_NOTIFICATIONS, BENCH_OPS / insert_s / 1e6, BENCH_OPS / find_s / 1e6);
+    printf("text arena, %u bytes: %u compactions, %u bytes high water, %u blocks live\n",
+           (unsigned)arena.size, (unsigned)arena.compactions, (unsigned)arena.high_water, (unsigned)arena.blocks);
+}
+
+int main(void)
+{
+    test_arena();
+    test_store();
+    bench_store();
+    return host_test_result("notification_store_test");
+}
@@ -0,0 +1,68 @@
+#pragma once
+#include <stddef.h>
+#include <stdint.h>
+
+// Reference Q565 encoder, a C port of encodeQ565() in the Flutter sender (t_glass_ble_app/lib/main.dart).
+// 'out' needs room for 3 bytes per pixel in the worst case. Returns the stream length.
+static inline size_t q565_encode(const uint16_t *pixels, size_t count, uint8_t *out)
+{
+    uint16_t index[64] = {0};
+    uint16_t prev = 0;
+    size_t run = 0;
+    size_t len = 0;
+
+    for (size_t i = 0; i < count; i++)
+    {
+        uint16_t p = pixels[i];
+        if (p == prev)
+        {
+            run++;
+            if (run == 62 || i == count - 1)
+            {
+                out[len++] = 0xC0 | (run - 1);
+                run = 0;
+            }
+            continue;
+        }
+        if (run > 0)
+        {
+            out[len++] = 0xC0 | (run - 1);
+            run = 0;
+        }
+
+        int r = (p >> 11) & 0x1F, g = (p >> 5) & 0x3F, b = p & 0x1F;
+        int hash = (r * 3 + g * 5 + b * 7) % 64;
+
+        if (index[hash] == p)
+        {
+            out[len++] = hash;
+        }
+        else
+        {
+            int dr = ((r - ((prev >> 11) & 0x1F) + 16) & 0x1F) - 16;
+            int dg = ((g - ((prev >> 5) & 0x3F) + 32) & 0x3F) - 32;
+            int db = ((b - (prev & 0x1F) + 16) & 0x1F) - 16;
+            int dr_dg = dr - (dg >> 1);
+            int db_dg = db - (dg >> 1);
+
+            if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1)
+            {
+                out[len++] = 0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2);
+            }
+            else if (dr_dg >= -8 && dr_dg <= 7 && db_dg >= -8 && db_dg <= 7)
+            {
+                out[len++] = 0x80 | (dg + 32);
+                out[len++] = ((dr_dg + 8) << 4) | (db_dg + 8);
+            }
+            else
+            {
+                out[len++] = 0xFE;
+                out[len++] = p & 0xFF;
+                out[len++] = p >> 8;
+            }
+        }
+        index[hash] = p;
+        prev = p;
+    }
+    return len;
+}
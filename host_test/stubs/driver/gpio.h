@@ -0,0 +1,20 @@
+#pragma once
+#include <stdint.h>
+#include "esp_err.h"
+// The IDF header chain brings in the FreeRTOS task API, the panel drivers rely on it
+#include "freertos/task.h"
+
+#define GPIO_MODE_OUTPUT 2
+
+typedef struct
+{
+    uint64_t pin_bit_mask;
+    int mode;
+    int pull_up_en;
+    int pull_down_en;
+    int intr_type;
+} gpio_config_t;
+
+esp_err_t gpio_config(const gpio_config_t *config);
+esp_err_t gpio_reset_pin(int gpio_num);
+esp_err_t gpio_set_level(int gpio_num, uint32_t level);
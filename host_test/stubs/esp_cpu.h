@@ -0,0 +1,5 @@
+#pragma once
+#include <stdint.h>
+
+// Nanoseconds on the host, only differences are meaningful
+uint32_t esp_cpu_get_cycle_count(void);
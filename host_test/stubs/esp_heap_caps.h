@@ -0,0 +1,12 @@
+#pragma once
+#include <stddef.h>
+
+#define MALLOC_CAP_DMA          (1 << 3)
+#define MALLOC_CAP_8BIT         (1 << 2)
+#define MALLOC_CAP_SPIRAM       (1 << 10)
+#define MALLOC_CAP_INTERNAL     (1 << 11)
+
+void *heap_caps_malloc(size_t size, unsigned caps);
+void *heap_caps_calloc(size_t n, size_t size, unsigned caps);
+void *heap_caps_aligned_alloc(size_t alignment, size_t size, unsigned caps);
+void heap_caps_free(void *ptr);
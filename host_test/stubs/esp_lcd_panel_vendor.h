@@ -0,0 +1,20 @@
+#pragma once
+#include "esp_lcd_panel_interface.h"
+
+typedef enum
+{
+    LCD_RGB_ELEMENT_ORDER_RGB = 0,
+    LCD_RGB_ELEMENT_ORDER_BGR,
+} lcd_rgb_element_order_t;
+
+typedef struct
+{
+    int reset_gpio_num;
+    lcd_rgb_element_order_t rgb_ele_order;
+    uint32_t bits_per_pixel;
+    struct
+    {
+        uint32_t reset_active_high : 1;
+    } flags;
+    void *vendor_config;
+} esp_lcd_panel_dev_config_t;
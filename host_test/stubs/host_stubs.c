@@ -0,0 +1,275 @@
+#define _POSIX_C_SOURCE 200809L
+#include <errno.h>
+#include <stdbool.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "driver/gpio.h"
+#include "esp_cpu.h"
+#include "esp_err.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+const char *esp_err_to_name(esp_err_t code)
+{
+    return (code == ESP_OK) ? "ESP_OK" : "ESP_ERR";
+}
+
+int64_t esp_timer_get_time(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+uint32_t esp_cpu_get_cycle_count(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec);
+}
+
+esp_err_t gpio_config(const gpio_config_t *config)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_reset_pin(int gpio_num)
+{
+    return ESP_OK;
+}
+
+esp_err_t gpio_set_level(int gpio_num, uint32_t level)
+{
+    return ESP_OK;
+}
+
+void *heap_caps_malloc(size_t size, unsigned caps)
+{
+    (void)caps;
+    return malloc(size);
+}
+
+void *heap_caps_calloc(size_t n, size_t size, unsigned caps)
+{
+    (void)caps;
+    return calloc(n, size);
+}
+
+void *heap_caps_aligned_alloc(size_t alignment, size_t size, unsigned caps)
+{
+    (void)caps;
+    return aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+}
+
+void heap_caps_free(void *ptr)
+{
+    free(ptr);
+}
+
+struct host_task
+{
+    pthread_t thread;
+    void (*fn)(void *);
+    void *arg;
+};
+
+static void *task_entry(void *arg)
+{
+    struct host_task *task = arg;
+    task->fn(task->arg);
+    return NULL;
+}
+
+BaseType_t xTaskCreatePinnedToCore(void (*fn)(void *), const char *name, uint32_t stack, void *arg,
+                                   UBaseType_t priority, TaskHandle_t *handle, BaseType_t core)
+{
+    (void)name;
+    (void)stack;
+    (void)priority;
+    (void)core;
+
+    struct host_task *task = calloc(1, sizeof(*task));
+    if (!task)
+    {
+        return pdFAIL;
+    }
+    task->fn = fn;
+    task->arg = arg;
+    if (pthread_create(&task->thread, NULL, task_entry, task) != 0)
+    {
+        free(task);
+        return pdFAIL;
+    }
+    pthread_detach(task->thread);
+    if (handle)
+    {
+        *handle = task;
+    }
+    return pdPASS;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+    struct timespec ts = {.tv_sec = ticks / 1000, .tv_nsec = (long)(ticks % 1000) * 1000000};
+    nanosleep(&ts, NULL);
+}
+
+void vTaskDelete(TaskHandle_t task)
+{
+    if (task == NULL)
+    {
+        pthread_exit(NULL);
+    }
+    pthread_cancel(task->thread);
+}
+
+// Fixed-size item ring guarded by a mutex, receivers wait on a condition variable
+struct host_queue
+{
+    pthread_mutex_t lock;
+    pthread_cond_t not_empty;
+    pthread_cond_t not_full;
+    uint8_t *items;
+    UBaseType_t length;
+    UBaseType_t item_size;
+    UBaseType_t head;
+    UBaseType_t count;
+};
+
+QueueHandle_t xQueueCreate(UBaseType_t length, UBaseType_t item_size)
+{
+    struct host_queue *q = calloc(1, sizeof(*q));
+    if (!q)
+    {
+        return NULL;
+    }
+    q->items = calloc(length, item_size);
+    if (!q->items)
+    {
+        free(q);
+        return NULL;
+    }
+    q->length = length;
+    q->item_size = item_size;
+    pthread_mutex_init(&q->lock, NULL);
+    pthread_cond_init(&q->not_empty, NULL);
+    pthread_cond_init(&q->not_full, NULL);
+    return q;
+}
+
+// Waits on 'cond' until 'ready' holds or 'wait' ticks passed, called with the queue locked
+static bool wait_until(struct host_queue *q, pthread_cond_t *cond, bool (*ready)(const struct host_queue *), TickType_t wait)
+{
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += wait / 1000;
+    deadline.tv_nsec += (long)(wait % 1000) * 1000000;
+    if (deadline.tv_nsec >= 1000000000)
+    {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+    }
+
+    while (!ready(q))
+    {
+        if (wait == 0)
+        {
+            return false;
+        }
+        if (wait == portMAX_DELAY)
+        {
+            pthread_cond_wait(cond, &q->lock);
+        }
+        else if (pthread_cond_timedwait(cond, &q->lock, &deadline) == ETIMEDOUT)
+        {
+            return ready(q);
+        }
+    }
+    return true;
+}
+
+static bool has_room(const struct host_queue *q)
+{
+    return q->count < q->length;
+}
+
+static bool has_items(const struct host_queue *q)
+{
+    return q->count > 0;
+}
+
+BaseType_t xQueueSend(QueueHandle_t q, const void *item, TickType_t wait)
+{
+    pthread_mutex_lock(&q->lock);
+    if (!wait_until(q, &q->not_full, has_room, wait))
+    {
+        pthread_mutex_unlock(&q->lock);
+        return pdFALSE;
+    }
+    memcpy(&q->items[((q->head + q->count) % q->length) * q->item_size], item, q->item_size);
+    q->count++;
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->lock);
+    return pdTRUE;
+}
+
+BaseType_t xQueueReceive(QueueHandle_t q, void *item, TickType_t wait)
+{
+    pthread_mutex_lock(&q->lock);
+    if (!wait_until(q, &q->not_empty, has_items, wait))
+    {
+        pthread_mutex_unlock(&q->lock);
+        return pdFALSE;
+    }
+    memcpy(item, &q->items[q->head * q->item_size], q->item_size);
+    q->head = (q->head + 1) % q->length;
+    q->count--;
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->lock);
+    return pdTRUE;
+}
+
+UBaseType_t uxQueueMessagesWaiting(QueueHandle_t q)
+{
+    pthread_mutex_lock(&q->lock);
+    UBaseType_t count = q->count;
+    pthread_mutex_unlock(&q->lock);
+    return count;
+}
+
+struct host_semaphore
+{
+    pthread_mutex_t lock;
+};
+
+SemaphoreHandle_t xSemaphoreCreateMutex(void)
+{
+    struct host_semaphore *sem = calloc(1, sizeof(*sem));
+    if (sem)
+    {
+        pthread_mutex_init(&sem->lock, NULL);
+    }
+    return sem;
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t sem, TickType_t wait)
+{
+    if (wait == 0)
+    {
+        return pthread_mutex_trylock(&sem->lock) == 0 ? pdTRUE : pdFALSE;
+    }
+    pthread_mutex_lock(&sem->lock);
+    return pdTRUE;
+}
+
+BaseType_t xSemaphoreGive(SemaphoreHandle_t sem)
+{
+    pthread_mutex_unlock(&sem->lock);
+    return pdTRUE;
+}
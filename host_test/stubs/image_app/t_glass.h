@@ -0,0 +1,9 @@
+#pragma once
+#include <stdint.h>
+#include <stdbool.h>
+
+// The parts of the image app's t_glass.h the receiver uses, the real header pulls in LVGL.
+// Tests provide the implementations.
+void lv_gui_ble_status(bool isOn);
+void lv_gui_post_frame(uint8_t *frame);
+void lv_gui_post_tiles(uint8_t *buffer, uint16_t count);
@@ -8,6 +8,8 @@
 #include "esp_bt_defs.h"
 #include "esp_bt_main.h"
 #include "t_glass.h"
+#include "image_receiver.h"
+#include "battery_measurement.h"
 
 #define TAG "[BLE_SERVER]"
 
@@ -15,12 +17,8 @@
 #define SERVICE_UUID    0x00FF
 #define CHAR_UUID       0xFF01
 
-// External function defined in main.c
-extern void ble_receive_image_chunk(uint8_t *data, size_t length);
-extern void ble_disconnected();
-
-static uint8_t char_value = 0;
-static esp_gatt_char_prop_t char_property = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE_NR;
+static uint8_t char_value = IMAGE_RX_SUPPORTED_ENCODINGS;
+static esp_gatt_char_prop_t char_property = ESP_GATT_CHAR_PROP_BIT_READ | ESP_GATT_CHAR_PROP_BIT_WRITE_NR | ESP_GATT_CHAR_PROP_BIT_NOTIFY;
 static esp_attr_value_t gatts_char_val = {
     .attr_max_len = 20,
     .attr_len = sizeof(char_value),
@@ -65,6 +63,13 @@ static esp_ble_adv_params_t adv_params = {
 };
 
 static uint16_t service_handle;
+static uint16_t char_handle;
+static uint16_t cccd_handle;
+
+// Connection used to send transfer status notifications
+static esp_gatt_if_t conn_gatts_if = ESP_GATT_IF_NONE;
+static uint16_t conn_id;
+static bool notify_enabled = false;
 static esp_gatt_srvc_id_t service_id = {
     .id = {
         .uuid = {.len = ESP_UUID_LEN_16, .uuid = {.uuid16 = SERVICE_UUID}},
@@ -78,6 +83,20 @@ static esp_gatt_id_t char_id = {
     .inst_id = 0,
 };
 
+static esp_bt_uuid_t cccd_uuid = {
+    .len = ESP_UUID_LEN_16,
+    .uuid = {.uuid16 = ESP_GATT_UUID_CHAR_CLIENT_CONFIG},
+};
+
+void ble_server_notify(const uint8_t *data, size_t length)
+{
+    if (conn_gatts_if == ESP_GATT_IF_NONE || !notify_enabled)
+    {
+        return;
+    }
+    esp_ble_gatts_send_indicate(conn_gatts_if, conn_id, char_handle, length, (uint8_t *)data, false);
+}
+
 static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_if,
                                 esp_ble_gatts_cb_param_t *param)
 {
@@ -95,20 +114,62 @@ static void gatts_event_handler(esp_gatts_cb_event_t event, esp_gatt_if_t gatts_
         break;
     case ESP_GATTS_ADD_CHAR_EVT:
         ESP_LOGI(TAG, "Characteristic added.");
+        char_handle = param->add_char.attr_handle;
+        // Client configuration descriptor, lets the sender subscribe to transfer status notifications
+        esp_ble_gatts_add_char_descr(service_handle, &cccd_uuid, ESP_GATT_PERM_READ | ESP_GATT_PERM_WRITE, NULL, NULL);
+        break;
+    case ESP_GATTS_ADD_CHAR_DESCR_EVT:
+        cccd_handle = param->add_char_descr.attr_handle;
         break;
+    case ESP_GATTS_READ_EVT:
+    {
+        // Responses are sent by the app (no auto response), the value tells the sender which encodings it may use
+        esp_gatt_rsp_t rsp = {0};
+        rsp.attr_value.handle = param->read.handle;
+        if (param->read.handle == char_handle)
+        {
+            rsp.attr_value.len = sizeof(char_value);
+            rsp.attr_value.value[0] = char_value;
+        }
+        else if (param->read.handle == cccd_handle)
+        {
+            rsp.attr_value.len = 2;
+            rsp.attr_value.value[0] = notify_enabled ? 0x01 : 0x00;
+        }
+        esp_ble_gatts_send_response(gatts_if, param->read.conn_id, param->read.trans_id, ESP_GATT_OK, &rsp);
+        break;
+    }
     case ESP_GATTS_WRITE_EVT:
         // ESP_LOGI(TAG, "Data received: %.*s", param->write.len, param->write.value);
-        ESP_LOGI(TAG, "Data received: %d", param->write.len);
-        ble_receive_image_chunk(param->write.value, param->write.len);
+        ESP_LOGD(TAG, "Data received: %d", param->write.len);
+        if (param->write.handle == cccd_handle && param->write.len == 2)
+        {
+            notify_enabled = (param->write.value[0] & 0x01) != 0;
+            ESP_LOGI(TAG, "Status notifications %s", notify_enabled ? "enabled" : "disabled");
+        }
+        else if (param->write.handle == char_handle)
+        {
+            ble_receive_image_chunk(param->write.value, param->write.len);
+        }
+        if (param->write.need_rsp)
+        {
+            esp_ble_gatts_send_response(gatts_if, param->write.conn_id, param->write.trans_id, ESP_GATT_OK, NULL);
+        }
         break;
     case ESP_GATTS_CONNECT_EVT:
         ESP_LOGI(TAG, "Device connected");
+        conn_gatts_if = gatts_if;
+        conn_id = param->connect.conn_id;
         lv_gui_ble_status(true);
+        battery_set_radio_load(true);
         break;
     case ESP_GATTS_DISCONNECT_EVT:
         ESP_LOGI(TAG, "Device disconnected");
+        conn_gatts_if = ESP_GATT_IF_NONE;
+        notify_enabled = false;
         ble_disconnected();
         lv_gui_ble_status(false);
+        battery_set_radio_load(false);
         esp_ble_gap_start_advertising(&adv_params);
         break;
     case ESP_GATTS_MTU_EVT:
@@ -0,0 +1,100 @@
+#include <string.h>
+#include "image_codec.h"
+
+#define RGB565_R(c)     (((c) >> 11) & 0x1F)
+#define RGB565_G(c)     (((c) >> 5) & 0x3F)
+#define RGB565_B(c)     ((c) & 0x1F)
+#define RGB565(r, g, b) ((uint16_t)((((r) & 0x1F) << 11) | (((g) & 0x3F) << 5) | ((b) & 0x1F)))
+
+#define Q565_HASH(c)    ((RGB565_R(c) * 3 + RGB565_G(c) * 5 + RGB565_B(c) * 7) % 64)
+
+void q565_decoder_init(q565_decoder_t *dec, uint16_t *out, size_t out_pixels)
+{
+    memset(dec, 0, sizeof(*dec));
+    dec->out = out;
+    dec->out_pixels = out_pixels;
+}
+
+static inline void emit(q565_decoder_t *dec, uint16_t pixel, size_t count)
+{
+    if (count > dec->out_pixels - dec->pos)
+    {
+        dec->error = true;
+        count = dec->out_pixels - dec->pos;
+    }
+
+    uint16_t *dst = &dec->out[dec->pos];
+    for (size_t i = 0; i < count; i++)
+    {
+        dst[i] = pixel;
+    }
+    dec->pos += count;
+    dec->prev = pixel;
+    dec->index[Q565_HASH(pixel)] = pixel;
+}
+
+void q565_decode(q565_decoder_t *dec, const uint8_t *data, size_t len)
+{
+    const uint8_t *end = data + len;
+
+    while (data < end && !dec->error)
+    {
+        if (dec->op)
+        {
+            // Finish an op that was split across chunks
+            dec->operand[dec->operand_len++] = *data++;
+            int needed = (dec->op == Q565_OP_RAW) ? 2 : 1;
+            if (dec->operand_len < needed)
+            {
+                continue;
+            }
+
+            uint16_t p = dec->prev;
+            if (dec->op == Q565_OP_RAW)
+            {
+                p = dec->operand[0] | (dec->operand[1] << 8);
+            }
+            else
+            {
+                int dg = (int)(dec->op_arg & 0x3F) - 32;
+                int dr = (dg >> 1) + (dec->operand[0] >> 4) - 8;
+                int db = (dg >> 1) + (dec->operand[0] & 0x0F) - 8;
+                p = RGB565(RGB565_R(p) + dr, RGB565_G(p) + dg, RGB565_B(p) + db);
+            }
+            dec->op = 0;
+            dec->operand_len = 0;
+            emit(dec, p, 1);
+            continue;
+        }
+
+        uint8_t b = *data++;
+        if (b == Q565_OP_RAW)
+        {
+            dec->op = Q565_OP_RAW;
+            continue;
+        }
+
+        switch (b & Q565_MASK_2)
+        {
+        case Q565_OP_INDEX:
+            emit(dec, dec->index[b], 1);
+            break;
+        case Q565_OP_DIFF:
+        {
+            uint16_t p = dec->prev;
+            p = RGB565(RGB565_R(p) + ((b >> 4) & 0x03) - 2,
+                       RGB565_G(p) + ((b >> 2) & 0x03) - 2,
+                       RGB565_B(p) + (b & 0x03) - 2);
+            emit(dec, p, 1);
+            break;
+        }
+        case Q565_OP_LUMA:
+            dec->op = Q565_OP_LUMA;
+            dec->op_arg = b;
+            break;
+        default: // Q565_OP_RUN
+            emit(dec, dec->prev, (b & 0x3F) + 1);
+            break;
+        }
+    }
+}
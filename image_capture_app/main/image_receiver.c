@@ -0,0 +1,475 @@
+#include <string.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "image_receiver.h"
+#include "image_codec.h"
+#include "ble_server.h"
+#include "t_glass.h"
+
+#define TAG "[Image RX]"
+
+typedef enum
+{
+    FRAME_IDLE = 0,     // No frame seen since the connection was established
+    FRAME_ASSEMBLING,   // Chunks of frame_id are being collected
+    FRAME_COMPLETE,     // frame_id was handed over to the display
+    FRAME_REJECTED,     // frame_id arrived in full but could not be shown
+} frame_state_t;
+
+// A completed frame: either a full image or a TILES payload to patch into the canvas
+typedef struct
+{
+    uint8_t *buffer;
+    uint8_t encoding;   // IMAGE_ENCODING_RAW once Q565 frames are decoded
+    uint16_t tile_count;
+} ready_frame_t;
+
+// Frame buffers travel between the BLE callback, the display task and the canvas as pointers only.
+// free_queue holds buffers ready to be filled, ready_queue holds completed frames and the canvas
+// shows one more. Posted frames wait in the UI command slots until the LVGL task swaps them with the
+// canvas buffer, which then joins free_queue.
+static QueueHandle_t free_queue;
+static QueueHandle_t ready_queue;
+
+// Assembly state, only touched from the Bluedroid callback context
+static uint8_t *filling_frame = NULL;
+static frame_state_t frame_state = FRAME_IDLE;
+static uint8_t frame_id;
+static uint8_t frame_encoding;
+static uint16_t frame_total;
+static size_t received_bytes;
+
+// Last frame completed on this connection; the canvas shows it once the ready queue drains
+static bool base_valid = false;
+static uint8_t base_frame_id;
+
+// Encoded frames are reassembled here and decoded into the frame buffer as the received prefix grows
+static uint8_t *staging_buffer = NULL;
+static size_t decoded_bytes;
+static q565_decoder_t decoder;
+
+// One bit per byte of the frame being assembled
+static uint32_t rx_bitmap[(IMAGE_MAX_SIZE + 31) / 32];
+
+static image_rx_stats_t rx_stats;
+
+// Marks [offset, offset + length) as received and returns how many of those bytes are new
+static size_t bitmap_mark(size_t offset, size_t length)
+{
+    size_t fresh = 0;
+    size_t bit = offset;
+    size_t end = offset + length;
+
+    while (bit < end)
+    {
+        uint32_t shift = bit % 32;
+        size_t count = 32 - shift;
+        if (count > end - bit)
+        {
+            count = end - bit;
+        }
+        uint32_t mask = (count == 32) ? 0xFFFFFFFF : (((1u << count) - 1) << shift);
+
+        fresh += __builtin_popcount(mask & ~rx_bitmap[bit / 32]);
+        rx_bitmap[bit / 32] |= mask;
+        bit += count;
+    }
+    return fresh;
+}
+
+// Returns the first bit at or after 'bit' whose state matches 'set', or 'limit' if there is none
+static size_t bitmap_find(size_t bit, size_t limit, bool set)
+{
+    while (bit < limit)
+    {
+        uint32_t word = set ? rx_bitmap[bit / 32] : ~rx_bitmap[bit / 32];
+        word >>= bit % 32;
+        if (word)
+        {
+            bit += __builtin_ctz(word);
+            break;
+        }
+        bit = (bit / 32 + 1) * 32;
+    }
+    return bit < limit ? bit : limit;
+}
+
+static void send_frame_status(uint8_t id, image_status_t status)
+{
+    uint8_t reply[3 + IMAGE_RX_MAX_REPORTED_RANGES * 4];
+    size_t len = 3;
+    uint8_t range_count = 0;
+
+    if (status == IMAGE_STATUS_MISSING)
+    {
+        size_t start = bitmap_find(0, frame_total, false);
+        while (start < frame_total && range_count < IMAGE_RX_MAX_REPORTED_RANGES)
+        {
+            size_t end = bitmap_find(start, frame_total, true);
+            size_t gap = end - start;
+            reply[len++] = start & 0xFF;
+            reply[len++] = (start >> 8) & 0xFF;
+            reply[len++] = gap & 0xFF;
+            reply[len++] = (gap >> 8) & 0xFF;
+            range_count++;
+            start = bitmap_find(end, frame_total, false);
+        }
+    }
+
+    reply[0] = id;
+    reply[1] = status;
+    reply[2] = range_count;
+    ble_server_notify(reply, len);
+}
+
+static void reset_assembly(void)
+{
+    received_bytes = 0;
+    decoded_bytes = 0;
+    memset(rx_bitmap, 0, sizeof(rx_bitmap));
+    if (filling_frame)
+    {
+        q565_decoder_init(&decoder, (uint16_t *)filling_frame, IMAGE_MAX_SIZE / sizeof(uint16_t));
+    }
+}
+
+static void start_frame(uint8_t id, uint8_t encoding, uint16_t total)
+{
+    if (frame_state == FRAME_ASSEMBLING)
+    {
+        rx_stats.frames_abandoned++;
+    }
+
+    frame_id = id;
+    frame_encoding = encoding;
+    frame_total = total;
+    frame_state = FRAME_ASSEMBLING;
+    reset_assembly();
+}
+
+static bool reserve_frame_buffer(void)
+{
+    if (filling_frame)
+    {
+        return true;
+    }
+    if (xQueueReceive(free_queue, &filling_frame, 0) != pdTRUE)
+    {
+        return false;
+    }
+    q565_decoder_init(&decoder, (uint16_t *)filling_frame, IMAGE_MAX_SIZE / sizeof(uint16_t));
+    return true;
+}
+
+// Feeds the decoder with the part of the stream that is now contiguous from its current position
+static void decode_received_prefix(void)
+{
+    size_t available = bitmap_find(decoded_bytes, frame_total, false);
+    if (available > decoded_bytes)
+    {
+        q565_decode(&decoder, &staging_buffer[decoded_bytes], available - decoded_bytes);
+        decoded_bytes = available;
+    }
+}
+
+// Walks the tile records of a TILES frame, returns the tile count or -1 if the payload is malformed
+static int validate_tiles(const uint8_t *data, size_t length)
+{
+    if (length < IMAGE_TILES_HEADER_LEN)
+    {
+        return -1;
+    }
+
+    uint16_t count = data[1] | (data[2] << 8);
+    size_t pos = IMAGE_TILES_HEADER_LEN;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        if (length - pos < IMAGE_TILE_RECORD_LEN)
+        {
+            return -1;
+        }
+        uint8_t tx = data[pos];
+        uint8_t ty = data[pos + 1];
+        if (tx >= IMAGE_TILE_COLS || ty >= IMAGE_TILE_ROWS)
+        {
+            return -1;
+        }
+        size_t pixels = image_tile_span(tx, IMAGE_WIDTH) * image_tile_span(ty, IMAGE_HEIGHT) * sizeof(uint16_t);
+        pos += IMAGE_TILE_RECORD_LEN;
+        if (length - pos < pixels)
+        {
+            return -1;
+        }
+        pos += pixels;
+    }
+    return (pos == length) ? count : -1;
+}
+
+static void reject_frame(void)
+{
+    // The buffer stays reserved for the full frame the sender is expected to send next
+    rx_stats.rejected_deltas++;
+    frame_state = FRAME_REJECTED;
+    send_frame_status(frame_id, IMAGE_STATUS_REJECTED);
+}
+
+static void complete_frame(void)
+{
+    ready_frame_t ready = {
+        .buffer = filling_frame,
+        .encoding = IMAGE_ENCODING_RAW,
+    };
+
+    if (frame_encoding == IMAGE_ENCODING_TILES)
+    {
+        int tiles = validate_tiles(filling_frame, frame_total);
+        if (tiles < 0 || !base_valid || filling_frame[0] != base_frame_id)
+        {
+            reject_frame();
+            return;
+        }
+        ready.encoding = IMAGE_ENCODING_TILES;
+        ready.tile_count = tiles;
+    }
+
+    // Cannot fail: the ready queue is as deep as the ring
+    xQueueSend(ready_queue, &ready, 0);
+    filling_frame = NULL;
+    frame_state = FRAME_COMPLETE;
+    base_valid = true;
+    base_frame_id = frame_id;
+    send_frame_status(frame_id, IMAGE_STATUS_COMPLETE);
+}
+
+// Called once every byte of the frame is in and a buffer holds it (decoded, for encoded frames)
+static void finish_frame(void)
+{
+    if (frame_encoding != IMAGE_ENCODING_Q565 || q565_decoder_done(&decoder))
+    {
+        complete_frame();
+    }
+    else
+    {
+        // Corrupt stream, collect the whole frame again
+        rx_stats.decode_errors++;
+        reset_assembly();
+    }
+}
+
+void ble_disconnected(void)
+{
+    // Keep the reserved buffer, the next connection starts numbering frames again
+    frame_state = FRAME_IDLE;
+    received_bytes = 0;
+    base_valid = false;
+}
+
+static void receive_chunk(const uint8_t *data, size_t length)
+{
+    if (!free_queue)
+    {
+        return;
+    }
+
+    if (length < IMAGE_PKT_HEADER_LEN)
+    {
+        rx_stats.invalid_chunks++;
+        return;
+    }
+
+    uint8_t id = data[0];
+    uint8_t flags = data[1];
+    size_t offset = data[2] | (data[3] << 8);
+    uint16_t total = data[4] | (data[5] << 8);
+    const uint8_t *payload = &data[IMAGE_PKT_HEADER_LEN];
+    size_t payload_len = length - IMAGE_PKT_HEADER_LEN;
+
+    // FrameIDs wrap around, anything "behind" the current frame is stale
+    if (frame_state != FRAME_IDLE && (int8_t)(id - frame_id) < 0)
+    {
+        rx_stats.late_chunks++;
+        if (flags & IMAGE_PKT_FLAG_QUERY)
+        {
+            send_frame_status(id, IMAGE_STATUS_UNKNOWN_FRAME);
+        }
+        return;
+    }
+
+    if ((frame_state == FRAME_COMPLETE || frame_state == FRAME_REJECTED) && id == frame_id)
+    {
+        // Retransmission of a frame we already have
+        if (flags & IMAGE_PKT_FLAG_QUERY)
+        {
+            send_frame_status(id, (frame_state == FRAME_COMPLETE) ? IMAGE_STATUS_COMPLETE : IMAGE_STATUS_REJECTED);
+        }
+        else
+        {
+            rx_stats.late_chunks++;
+        }
+        return;
+    }
+
+    uint8_t encoding = flags & IMAGE_PKT_ENCODING_MASK;
+    bool valid_size = (encoding == IMAGE_ENCODING_RAW) ? (total == IMAGE_MAX_SIZE)
+                                                        : ((encoding == IMAGE_ENCODING_Q565 || encoding == IMAGE_ENCODING_TILES) &&
+                                                           total > 0 && total <= IMAGE_MAX_SIZE);
+    if (!valid_size || offset + payload_len > total ||
+        (frame_state == FRAME_ASSEMBLING && id == frame_id && (encoding != frame_encoding || total != frame_total)))
+    {
+        rx_stats.invalid_chunks++;
+        return;
+    }
+
+    if (frame_state == FRAME_IDLE || id != frame_id)
+    {
+        if (flags & IMAGE_PKT_FLAG_QUERY)
+        {
+            // Nothing of this frame arrived
+            send_frame_status(id, IMAGE_STATUS_UNKNOWN_FRAME);
+            return;
+        }
+        start_frame(id, encoding, total);
+    }
+
+    if (flags & IMAGE_PKT_FLAG_QUERY)
+    {
+        if (received_bytes == frame_total)
+        {
+            // Only an encoded frame can be fully staged without a buffer, decode it now if one was released
+            if (!reserve_frame_buffer())
+            {
+                send_frame_status(id, IMAGE_STATUS_BUSY);
+                return;
+            }
+            decode_received_prefix();
+            finish_frame();
+            if (frame_state != FRAME_ASSEMBLING)
+            {
+                return;
+            }
+        }
+        send_frame_status(id, IMAGE_STATUS_MISSING);
+        return;
+    }
+
+    // Chunks may start a frame in any order; a buffer is reserved by the first one that finds one free.
+    // Raw and tile chunks dropped while the ring is exhausted are reported as missing on the next query,
+    // encoded chunks wait in the staging buffer until a chunk or query finds a buffer to decode into.
+    bool have_frame = reserve_frame_buffer();
+
+    if (frame_encoding != IMAGE_ENCODING_Q565)
+    {
+        if (!have_frame)
+        {
+            rx_stats.dropped_chunks++;
+            return;
+        }
+        memcpy(&filling_frame[offset], payload, payload_len);
+        received_bytes += bitmap_mark(offset, payload_len);
+    }
+    else
+    {
+        memcpy(&staging_buffer[offset], payload, payload_len);
+        received_bytes += bitmap_mark(offset, payload_len);
+        if (!have_frame)
+        {
+            return;
+        }
+        decode_received_prefix();
+    }
+
+    if (received_bytes == frame_total)
+    {
+        finish_frame();
+    }
+}
+
+void ble_receive_image_chunk(const uint8_t *data, size_t length)
+{
+    // Timed around the whole handler, so the queries that decode and finish a frame count as well
+    int64_t start_time = esp_timer_get_time();
+    receive_chunk(data, length);
+
+    uint32_t elapsed = (uint32_t)(esp_timer_get_time() - start_time);
+    if (elapsed > rx_stats.max_callback_us)
+    {
+        rx_stats.max_callback_us = elapsed;
+    }
+}
+
+void image_receiver_get_stats(image_rx_stats_t *stats)
+{
+    *stats = rx_stats;
+}
+
+void image_receiver_release_frame(uint8_t *frame)
+{
+    // Cannot fail: the free queue is as deep as the ring
+    xQueueSend(free_queue, &frame, 0);
+}
+
+// Posts completed frames to the UI, which recycles the buffers they replace
+static void image_display_task(void *arg)
+{
+    ready_frame_t frame;
+    while (1)
+    {
+        if (xQueueReceive(ready_queue, &frame, portMAX_DELAY))
+        {
+            if (frame.encoding == IMAGE_ENCODING_TILES)
+            {
+                lv_gui_post_tiles(frame.buffer, frame.tile_count);
+                rx_stats.tiles_applied += frame.tile_count;
+            }
+            else
+            {
+                lv_gui_post_frame(frame.buffer);
+            }
+
+            rx_stats.frames_completed++;
+            ESP_LOGI(TAG, "Frame %" PRIu32 " displayed (tiles: %" PRIu32 ", abandoned: %" PRIu32 ", dropped: %" PRIu32 ", late: %" PRIu32 ", rejected: %" PRIu32 ", max callback: %" PRIu32 " us)",
+                     rx_stats.frames_completed, rx_stats.tiles_applied, rx_stats.frames_abandoned, rx_stats.dropped_chunks,
+                     rx_stats.late_chunks, rx_stats.rejected_deltas, rx_stats.max_callback_us);
+        }
+    }
+}
+
+esp_err_t image_receiver_init(void)
+{
+    free_queue = xQueueCreate(IMAGE_RX_FRAME_COUNT, sizeof(uint8_t *));
+    ready_queue = xQueueCreate(IMAGE_RX_FRAME_COUNT, sizeof(ready_frame_t));
+    if (!free_queue || !ready_queue)
+    {
+        ESP_LOGE(TAG, "Failed to create frame queues");
+        return ESP_ERR_NO_MEM;
+    }
+
+    staging_buffer = (uint8_t *)heap_caps_malloc(IMAGE_MAX_SIZE, MALLOC_CAP_SPIRAM);
+    if (!staging_buffer)
+    {
+        ESP_LOGE(TAG, "Failed to allocate staging buffer in PSRAM!");
+        return ESP_ERR_NO_MEM;
+    }
+
+    // Allocate the frame ring in PSRAM, the canvas contributes the buffer on screen
+    for (int i = 0; i < IMAGE_RX_FRAME_COUNT - 1; i++)
+    {
+        uint8_t *frame = (uint8_t *)heap_caps_malloc(IMAGE_MAX_SIZE, MALLOC_CAP_SPIRAM);
+        if (!frame)
+        {
+            ESP_LOGE(TAG, "Failed to allocate frame buffer %d in PSRAM!", i);
+            return ESP_ERR_NO_MEM;
+        }
+        xQueueSend(free_queue, &frame, 0);
+    }
+    ESP_LOGI(TAG, "%d frame buffers allocated in PSRAM.", IMAGE_RX_FRAME_COUNT - 1);
+
+    xTaskCreatePinnedToCore(image_display_task, "Image_Disp_Task", 4096, NULL, 2, NULL, 1);
+    return ESP_OK;
+}
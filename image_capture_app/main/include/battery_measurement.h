@@ -6,16 +6,30 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stdint.h>
 #include "esp_check.h"
 
+typedef struct {
+    uint16_t voltage_mv;    // Filtered battery voltage
+    uint8_t percentage;     // Corrected for the current loads
+} battery_snapshot_t;
+
 // Initializes the ADC for battery measurement
 esp_err_t battery_measurement_init(void);
 
-// Reads the battery voltage and returns the value in volts
+// Reads a single sample and returns the battery voltage in volts
 float battery_measurement_read(void);
 
-// Converts the battery voltage to a percentage
-int battery_voltage_to_percentage(float voltage);
+// Latest filtered reading of the sampler task started by battery_measurement_init().
+// Never touches the ADC, returns false until the first burst was measured.
+bool battery_measurement_get(battery_snapshot_t *snapshot);
+
+// State of charge for an open-circuit voltage in mV, a table lookup
+int battery_mv_to_percentage(int mv);
+
+// Loads the percentage is corrected for, never block and may be called from any task
+void battery_set_display_load(bool on, uint8_t brightness);
+void battery_set_radio_load(bool active);
 
 // Cleans up resources used for battery measurement
 void battery_measurement_deinit(void);
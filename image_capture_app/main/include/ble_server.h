@@ -6,5 +6,8 @@
 
 void ble_server_init();
 
+// Sends a notification on the image characteristic if the client subscribed to it
+void ble_server_notify(const uint8_t *data, size_t length);
+
 
 #endif // BLE_SERVER_H
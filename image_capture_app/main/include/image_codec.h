@@ -0,0 +1,52 @@
+#ifndef IMAGE_CODEC_H
+#define IMAGE_CODEC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/*
+    Q565: a QOI-style byte stream for RGB565 images, decoded incrementally as chunks arrive.
+
+    | 0b00iiiiii |                 INDEX: pixel = index[i]
+    | 0b01rrggbb |                 DIFF:  r += rr - 2, g += gg - 2, b += bb - 2
+    | 0b10gggggg | 0brrrrbbbb |    LUMA:  dg = gggggg - 32, r += dg / 2 + rrrr - 8, b += dg / 2 + bbbb - 8
+    | 0b11llllll |                 RUN:   previous pixel repeated llllll + 1 times (1..62)
+    | 0xFE | LSB | MSB |           RAW:   literal RGB565 pixel
+
+    Component arithmetic wraps around (5/6/5 bits), dg / 2 rounds towards negative infinity.
+    Every decoded pixel is stored in index[(r * 3 + g * 5 + b * 7) % 64]. The previous pixel
+    starts as black and the index as all zeros.
+*/
+#define Q565_OP_INDEX   0x00
+#define Q565_OP_DIFF    0x40
+#define Q565_OP_LUMA    0x80
+#define Q565_OP_RUN     0xC0
+#define Q565_OP_RAW     0xFE
+#define Q565_MASK_2     0xC0
+
+typedef struct
+{
+    uint16_t *out;          // Destination pixels
+    size_t out_pixels;      // Pixels expected in the frame
+    size_t pos;             // Pixels decoded so far
+    uint16_t prev;
+    uint16_t index[64];
+    uint8_t op;             // Multi-byte op waiting for more input, 0 if none
+    uint8_t op_arg;         // First byte of a pending LUMA op
+    uint8_t operand[2];
+    uint8_t operand_len;
+    bool error;             // The stream described more pixels than the frame holds
+} q565_decoder_t;
+
+void q565_decoder_init(q565_decoder_t *dec, uint16_t *out, size_t out_pixels);
+
+// Consumes the next 'len' bytes of the stream; ops may be split across calls
+void q565_decode(q565_decoder_t *dec, const uint8_t *data, size_t len);
+
+static inline bool q565_decoder_done(const q565_decoder_t *dec)
+{
+    return !dec->error && dec->op == 0 && dec->pos == dec->out_pixels;
+}
+
+#endif // IMAGE_CODEC_H
@@ -0,0 +1,102 @@
+#ifndef IMAGE_RECEIVER_H
+#define IMAGE_RECEIVER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#define IMAGE_WIDTH             126
+#define IMAGE_HEIGHT            126
+#define IMAGE_MAX_SIZE          31752   // 126x126x2 (Width x Height x 2 bytes)
+#define IMAGE_RX_FRAME_COUNT    3       // Frame buffers in the PSRAM ring, including the one on screen
+
+/*
+    Every GATT write carries a chunk of one frame:
+
+    | FrameID(1 Byte) | Flags(1 Byte) | Offset(2 Bytes) | TotalLength(2 Bytes) | Payload |
+
+    * FrameID: Incremented (mod 256) by the sender for every new frame. Chunks of older frames are ignored.
+    * Flags: Bits 0-3 hold the payload encoding. IMAGE_PKT_FLAG_QUERY marks a header-only packet asking
+             which byte ranges of the frame are still missing.
+    * Offset: Byte offset of the payload within the frame, chunks may arrive in any order.
+    * TotalLength: Size of the complete (encoded) frame in bytes.
+
+    Queries are answered with a notification on the same characteristic:
+
+    | FrameID(1 Byte) | Status(1 Byte) | RangeCount(1 Byte) | { Offset(2 Bytes) | Length(2 Bytes) } * RangeCount |
+
+    All multi-byte fields are little endian.
+*/
+#define IMAGE_PKT_HEADER_LEN            6
+#define IMAGE_PKT_ENCODING_MASK         0x0F
+#define IMAGE_PKT_FLAG_QUERY            (1 << 7)
+
+#define IMAGE_RX_MAX_REPORTED_RANGES    32
+
+typedef enum
+{
+    IMAGE_ENCODING_RAW = 0,     // Uncompressed RGB565, little endian
+    IMAGE_ENCODING_Q565 = 1,    // Q565 stream, see image_codec.h
+    IMAGE_ENCODING_TILES = 2,   // Changed tiles of the previous frame, see below
+} image_encoding_t;
+
+// Reading the image characteristic returns this bitmask (bit n = encoding n) so the sender can pick a format
+#define IMAGE_RX_SUPPORTED_ENCODINGS    ((1 << IMAGE_ENCODING_RAW) | (1 << IMAGE_ENCODING_Q565) | (1 << IMAGE_ENCODING_TILES))
+
+/*
+    A TILES frame patches the image left on screen by an earlier frame:
+
+    | BaseFrameID(1 Byte) | TileCount(2 Bytes) | { TileX(1 Byte) | TileY(1 Byte) | Pixels } * TileCount |
+
+    * BaseFrameID: The frame the tiles apply to, which must be the last frame completed on this connection.
+                   Any other base is answered with IMAGE_STATUS_REJECTED and a full frame has to follow.
+    * TileX, TileY: Column and row on the grid of IMAGE_TILE_SIZE squares. Tiles in the last column and
+                    row are clipped to the image (6 pixels on a 126 pixel side).
+    * Pixels: The tile's RGB565 pixels row by row, little endian.
+*/
+#define IMAGE_TILE_SIZE         8
+#define IMAGE_TILE_COLS         ((IMAGE_WIDTH + IMAGE_TILE_SIZE - 1) / IMAGE_TILE_SIZE)
+#define IMAGE_TILE_ROWS         ((IMAGE_HEIGHT + IMAGE_TILE_SIZE - 1) / IMAGE_TILE_SIZE)
+#define IMAGE_TILES_HEADER_LEN  3
+#define IMAGE_TILE_RECORD_LEN   2
+
+// Width (or height) in pixels of the tile at grid position 'index' along an image side of 'extent' pixels
+static inline size_t image_tile_span(uint8_t index, size_t extent)
+{
+    size_t start = (size_t)index * IMAGE_TILE_SIZE;
+    return (extent - start < IMAGE_TILE_SIZE) ? extent - start : IMAGE_TILE_SIZE;
+}
+
+typedef enum
+{
+    IMAGE_STATUS_COMPLETE = 0,      // Every byte of the frame has been received
+    IMAGE_STATUS_MISSING = 1,       // The listed ranges still have to be sent
+    IMAGE_STATUS_UNKNOWN_FRAME = 2, // Nothing is known about this frame, send it again in full
+    IMAGE_STATUS_REJECTED = 3,      // The frame arrived but cannot be shown, send a full frame instead
+    IMAGE_STATUS_BUSY = 4,          // Every byte arrived but no frame buffer is free to decode into, query again
+} image_status_t;
+
+typedef struct {
+    uint32_t frames_completed;  // Frames handed over to the display
+    uint32_t frames_abandoned;  // Incomplete frames superseded by a newer FrameID
+    uint32_t dropped_chunks;    // Chunks discarded because no frame buffer was free
+    uint32_t late_chunks;       // Chunks of a frame that was already completed or superseded
+    uint32_t invalid_chunks;    // Chunks with a malformed header or an unsupported encoding
+    uint32_t decode_errors;     // Encoded frames that did not decode to a full image
+    uint32_t rejected_deltas;   // Tile frames whose base was not on screen or whose records were malformed
+    uint32_t tiles_applied;     // Tiles handed to the display by delta frames
+    uint32_t max_callback_us;   // Worst-case time spent in the BLE write callback
+} image_rx_stats_t;
+
+esp_err_t image_receiver_init(void);
+
+// Called from the GATT write event, never blocks
+void ble_receive_image_chunk(const uint8_t *data, size_t length);
+void ble_disconnected(void);
+
+void image_receiver_get_stats(image_rx_stats_t *stats);
+
+// Returns a frame buffer the display is done with, never blocks
+void image_receiver_release_frame(uint8_t *frame);
+
+#endif // IMAGE_RECEIVER_H
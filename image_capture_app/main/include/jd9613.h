@@ -15,6 +15,32 @@ typedef struct
 #define JD9613_WIDTH 126
 #define JD9613_HEIGHT 294
 #define LCD_CMD_RGB 0x00
+
+// Panel RAM window of a flush, end coordinates exclusive
+typedef struct
+{
+    uint16_t x;
+    uint16_t y;
+    uint16_t xe;
+    uint16_t ye;
+} jd9613_window_t;
+
+// Byte order of the pixels handed to draw_bitmap, the panel expects big endian RGB565
+typedef enum
+{
+    JD9613_BYTE_ORDER_SWAP = 0, // Little endian RGB565, swapped by the driver (PIE kernel on ESP32-S3)
+    JD9613_BYTE_ORDER_NATIVE,   // Already big endian, sent without touching the pixels
+} jd9613_byte_order_t;
+
+// CPU cycles spent byte-swapping flushed pixels, per kernel.
+// cycles / pixels gives the cost per pixel of the vector (ESP32-S3 only) and scalar paths.
+typedef struct
+{
+    uint64_t simd_cycles;
+    uint64_t simd_pixels;
+    uint64_t scalar_cycles;
+    uint64_t scalar_pixels;
+} jd9613_swap_stats_t;
 #ifdef __cplusplus
 extern "C"
 {
@@ -132,6 +158,16 @@ extern "C"
     void flipHorizontal(esp_lcd_panel_t *panel, bool enable);
     void setBrightness(esp_lcd_panel_t *panel, uint8_t level);
 
+    /**
+     * @brief Compute the panel RAM window for an area in display coordinates (end exclusive)
+     *
+     * @note  Pure function without hardware access.
+     */
+    void jd9613_flush_window(uint8_t rotation, int x_gap, int y_gap, int x_start, int y_start, int x_end, int y_end, jd9613_window_t *win);
+    void panel_jd9613_get_swap_stats(esp_lcd_panel_t *panel, jd9613_swap_stats_t *stats);
+    void panel_jd9613_set_byte_order(esp_lcd_panel_t *panel, jd9613_byte_order_t order);
+    jd9613_byte_order_t panel_jd9613_get_byte_order(esp_lcd_panel_t *panel);
+
 #ifdef __cplusplus
 }
 #endif
@@ -32,6 +32,7 @@
 #define BOARD_BAT_ADC       (13)
 #define BOARD_VIBRATION_PIN (38)
 #define DEFAULT_SCK_SPEED   (70 * 1000 * 1000)
+#define LCD_DRAW_BUFF_HEIGHT (42)   // Lines per LVGL draw stripe, 126 / 42 = 3 stripes for a full redraw
 
 #define BOARD_MIC_CLOCK     (6)
 #define BOARD_MIC_DATA      (5)
@@ -40,11 +41,41 @@
 #define GlassViewableWidth              126
 #define GlassViewableHeight             126
 
+#define DISPLAY_FLUSH_HIST_BUCKETS 8
+#define DISPLAY_FLUSH_HIST_BASE_US 250 // Bucket i counts durations below 250 << i us, the last one everything longer
+
+typedef struct
+{
+    uint32_t flushes;
+    uint32_t flush_hist[DISPLAY_FLUSH_HIST_BUCKETS]; // Flush handed to the driver until its DMA transfer completed
+    uint32_t wait_hist[DISPLAY_FLUSH_HIST_BUCKETS];  // Time LVGL spent blocked on an unfinished flush
+} display_flush_stats_t;
+
+typedef struct
+{
+    uint32_t frames_posted;
+    uint32_t tiles_posted;
+    uint32_t coalesced;     // Commands replaced by a newer one before the LVGL task applied them
+} ui_command_stats_t;
+
 extern lv_obj_t *base_ui;
 extern lv_timer_t *base_timer;
 extern lv_color_t font_color;
 extern lv_color_t bg_color;
 
 esp_err_t init_tglass();
+void display_get_flush_stats(display_flush_stats_t *stats);
+// Panel brightness and power, the battery load estimate follows both
+void display_set_brightness(uint8_t level);
+esp_err_t display_set_power(bool on);
+
+// The lv_gui_post_* calls and lv_gui_ble_status() never block, they may be called from the BLE stack.
+// The LVGL task applies the latest state within UI_COMMAND_PERIOD_MS.
 void lv_gui_ble_status(bool isOn);
-void update_canvas_with_rgb565(uint8_t *data, size_t len);
\ No newline at end of file
+// Queues a full RGB565 frame (IMAGE_MAX_SIZE bytes) for the canvas without copying it. The buffer it replaces
+// on screen, or the frame itself if a newer one supersedes it first, goes back to image_receiver_release_frame().
+void lv_gui_post_frame(uint8_t *frame);
+// Queues a TILES payload (see IMAGE_ENCODING_TILES in image_receiver.h), patched into the canvas after any
+// frame posted before it. The buffer goes back to image_receiver_release_frame() once applied.
+void lv_gui_post_tiles(uint8_t *buffer, uint16_t count);
+void lv_gui_get_command_stats(ui_command_stats_t *stats);
\ No newline at end of file
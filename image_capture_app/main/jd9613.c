@@ -1,4 +1,7 @@
 #include "esp_check.h"
+#include "esp_cpu.h"
+#include "esp_heap_caps.h"
+#include <string.h>
 #include "esp_lcd_panel_interface.h"
 #include "esp_lcd_panel_io.h"
 #include "esp_lcd_panel_vendor.h"
@@ -9,6 +12,8 @@
 
 #define TAG "jd9613"
 
+#define JD9613_CLEAR_LINES 6 // Blank stripe sent over and over to clear the panel, 294 / 6 = 49 transfers of 1.5 KB
+
 typedef struct
 {
     esp_lcd_panel_t base;
@@ -16,12 +21,19 @@ typedef struct
     int reset_gpio_num;
     bool reset_level;
     uint8_t rotation;
-    uint16_t *frame_buffer;
+    uint16_t *frame_buffer;         // DMA buffer holding the byte-swapped pixels of the area being sent
+    size_t frame_buffer_pixels;
+    jd9613_byte_order_t byte_order;
+    int x_gap;                      // Offset of the LVGL display within panel RAM, see panel_jd9613_set_gap
+    int y_gap;
+    jd9613_swap_stats_t swap_stats;
     uint16_t width;
     uint16_t height;
     bool flipHorizontal;
 } jd9613_panel_t;
 
+static esp_err_t panel_jd9613_clear(jd9613_panel_t *jd9613);
+
 // There is only 1/2 RAM inside the JD9613 screen, and it cannot be rotated in directions 1 and 3.
 esp_err_t panel_jd9613_set_rotation(esp_lcd_panel_t *panel, uint8_t r)
 {
@@ -80,7 +92,7 @@ static esp_err_t panel_jd9613_del(esp_lcd_panel_t *panel)
         gpio_reset_pin(jd9613->reset_gpio_num);
     }
     ESP_LOGI(TAG, "del jd9613 panel @%p", jd9613);
-    free(jd9613->frame_buffer);
+    heap_caps_free(jd9613->frame_buffer);
     free(jd9613);
     return ESP_OK;
 }
@@ -126,6 +138,8 @@ static esp_err_t panel_jd9613_init(esp_lcd_panel_t *panel)
 
     panel_jd9613_set_rotation(panel, jd9613->rotation);
 
+    ESP_RETURN_ON_ERROR(panel_jd9613_clear(jd9613), TAG, "clear panel failed");
+
     esp_lcd_panel_io_tx_param(io, LCD_CMD_SLPOUT, NULL, 0);
     vTaskDelay(pdMS_TO_TICKS(120));
 
@@ -135,123 +149,259 @@ static esp_err_t panel_jd9613_init(esp_lcd_panel_t *panel)
     return ESP_OK;
 }
 
-void rgb565_swap(uint16_t *color_data, uint32_t width, uint32_t height)
+static esp_err_t panel_jd9613_disp_on_off(esp_lcd_panel_t *panel, bool on_off)
 {
-    uint32_t total_pixels = width * height;
+    jd9613_panel_t *jd9613 = __containerof(panel, jd9613_panel_t, base);
+    ESP_RETURN_ON_ERROR(esp_lcd_panel_io_tx_param(jd9613->io, on_off ? LCD_CMD_DISPON : LCD_CMD_DISPOFF, NULL, 0),
+                        TAG, "send command failed");
+    return ESP_OK;
+}
 
-    uint32_t u32_cnt = total_pixels / 2;
-    uint16_t *buf16 = color_data;
-    uint32_t *buf32 = (uint32_t *)color_data;
+// Copies 'pixels' RGB565 values from src to dst with the two bytes of each swapped
+static void rgb565_swap_scalar(const uint16_t *src, uint16_t *dst, size_t pixels)
+{
+    size_t u32_cnt = pixels / 2;
+    const uint32_t *src32 = (const uint32_t *)src;
+    uint32_t *dst32 = (uint32_t *)dst;
 
-    while (u32_cnt >= 8)
+    while (u32_cnt >= 4)
     {
-        buf32[0] = ((buf32[0] & 0xff00ff00) >> 8) | ((buf32[0] & 0x00ff00ff) << 8);
-        buf32[1] = ((buf32[1] & 0xff00ff00) >> 8) | ((buf32[1] & 0x00ff00ff) << 8);
-        buf32[2] = ((buf32[2] & 0xff00ff00) >> 8) | ((buf32[2] & 0x00ff00ff) << 8);
-        buf32[3] = ((buf32[3] & 0xff00ff00) >> 8) | ((buf32[3] & 0x00ff00ff) << 8);
-        buf32[4] = ((buf32[4] & 0xff00ff00) >> 8) | ((buf32[4] & 0x00ff00ff) << 8);
-        buf32[5] = ((buf32[5] & 0xff00ff00) >> 8) | ((buf32[5] & 0x00ff00ff) << 8);
-        buf32[6] = ((buf32[6] & 0xff00ff00) >> 8) | ((buf32[6] & 0x00ff00ff) << 8);
-        buf32[7] = ((buf32[7] & 0xff00ff00) >> 8) | ((buf32[7] & 0x00ff00ff) << 8);
-        buf32 += 8;
-        u32_cnt -= 8;
+        dst32[0] = ((src32[0] & 0xff00ff00) >> 8) | ((src32[0] & 0x00ff00ff) << 8);
+        dst32[1] = ((src32[1] & 0xff00ff00) >> 8) | ((src32[1] & 0x00ff00ff) << 8);
+        dst32[2] = ((src32[2] & 0xff00ff00) >> 8) | ((src32[2] & 0x00ff00ff) << 8);
+        dst32[3] = ((src32[3] & 0xff00ff00) >> 8) | ((src32[3] & 0x00ff00ff) << 8);
+        src32 += 4;
+        dst32 += 4;
+        u32_cnt -= 4;
     }
 
     while (u32_cnt)
     {
-        *buf32 = ((*buf32 & 0xff00ff00) >> 8) | ((*buf32 & 0x00ff00ff) << 8);
-        buf32++;
+        *dst32++ = ((*src32 & 0xff00ff00) >> 8) | ((*src32 & 0x00ff00ff) << 8);
+        src32++;
         u32_cnt--;
     }
 
-    if (total_pixels & 0x1)
+    if (pixels & 0x1)
     { // Odd pixel count, swap the last pixel separately
-        uint32_t e = total_pixels - 1;
-        buf16[e] = ((buf16[e] & 0xff00) >> 8) | ((buf16[e] & 0x00ff) << 8);
+        size_t e = pixels - 1;
+        dst[e] = __builtin_bswap16(src[e]);
     }
 }
 
-static esp_err_t panel_jd9613_draw_bitmap(esp_lcd_panel_t *panel, int x_start, int y_start, int x_end, int y_end, const void *color_data)
+#if CONFIG_IDF_TARGET_ESP32S3
+// 16 pixels per iteration with the PIE vector unit. Unzipping the 32 bytes splits low and high bytes
+// into q0 and q1, zipping them back in the opposite order interleaves them swapped.
+// src and dst must be 16-byte aligned.
+static void rgb565_swap_pie(const uint16_t *src, uint16_t *dst, size_t blocks)
 {
-    jd9613_panel_t *jd9613 = __containerof(panel, jd9613_panel_t, base);
-    assert((x_start < x_end) && (y_start < y_end) && "start position must be smaller than end position");
-    esp_lcd_panel_io_handle_t io = jd9613->io;
+    for (size_t i = 0; i < blocks; i++)
+    {
+        __asm__ volatile(
+            "ee.vld.128.ip  q0, %0, 16 \n"
+            "ee.vld.128.ip  q1, %0, 16 \n"
+            "ee.vunzip.8    q0, q1     \n"
+            "ee.vzip.8      q1, q0     \n"
+            "ee.vst.128.ip  q1, %1, 16 \n"
+            "ee.vst.128.ip  q0, %1, 16 \n"
+            : "+r"(src), "+r"(dst)
+            :
+            : "memory");
+    }
+}
+#endif
 
-    // Swap the 2 bytes of RGB565 color
-    // Cannot find a way to use it in ESP_LVGL_PORT
-    rgb565_swap((uint16_t *)color_data, x_end - x_start + 1, y_end - y_start + 1);
-
-    uint32_t width = x_start + x_end;
-    uint32_t height = y_start + y_end;
-    uint32_t _x = x_start,
-             _y = y_start,
-             _xe = width,
-             _ye = height;
-    size_t write_colors_bytes = width * height * sizeof(uint16_t);
-    uint16_t *data_ptr = (uint16_t *)color_data;
-
-    bool sw_rotation = false;
-    switch (jd9613->rotation)
+// Swaps into dst, leaving LVGL's draw buffer untouched so it can be rendered into again right away
+static void rgb565_swap_copy(jd9613_panel_t *jd9613, const uint16_t *src, uint16_t *dst, size_t pixels)
+{
+    uint32_t start = esp_cpu_get_cycle_count();
+    size_t done = 0;
+
+#if CONFIG_IDF_TARGET_ESP32S3
+    if ((((uintptr_t)src | (uintptr_t)dst) & 0xF) == 0)
     {
-    case 1:
-    case 3:
-        sw_rotation = true;
-        break;
-    default:
-        sw_rotation = false;
-        break;
+        size_t blocks = pixels / 16;
+        rgb565_swap_pie(src, dst, blocks);
+        done = blocks * 16;
+
+        uint32_t now = esp_cpu_get_cycle_count();
+        jd9613->swap_stats.simd_cycles += now - start;
+        jd9613->swap_stats.simd_pixels += done;
+        start = now;
     }
+#endif
 
-    if (sw_rotation)
+    if (done < pixels)
+    {
+        rgb565_swap_scalar(&src[done], &dst[done], pixels - done);
+        jd9613->swap_stats.scalar_cycles += esp_cpu_get_cycle_count() - start;
+        jd9613->swap_stats.scalar_pixels += pixels - done;
+    }
+}
+
+// Maps an LVGL area (exclusive end) to the panel RAM window written by CASET/RASET.
+// The gap moves the area within the panel first. Rotations 1 and 3 are transposed in software;
+// rotation 2 is shifted by the 2 columns of the flipped RAM.
+void jd9613_flush_window(uint8_t rotation, int x_gap, int y_gap, int x_start, int y_start, int x_end, int y_end, jd9613_window_t *win)
+{
+    x_start += x_gap;
+    x_end += x_gap;
+    y_start += y_gap;
+    y_end += y_gap;
+
+    win->x = x_start;
+    win->y = y_start;
+    win->xe = x_end;
+    win->ye = y_end;
+
+    if (rotation == 1 || rotation == 3)
+    {
+        win->x = JD9613_WIDTH - y_end;
+        win->y = x_start;
+        win->xe = JD9613_WIDTH - y_start;
+        win->ye = x_end;
+    }
+    else if (rotation == 2)
     {
-        _x = JD9613_WIDTH - (y_start + height);
-        _y = x_start;
-        _xe = height;
-        _ye = width;
+        win->x += 2;
+        win->xe += 2;
     }
+}
 
-    // Direction 2 requires offset pixels
-    if (jd9613->rotation == 2)
+// Grows the DMA buffer the swapped pixels are sent from. Only called once the previous
+// transfer out of it finished, see panel_jd9613_draw_bitmap.
+static esp_err_t reserve_frame_buffer(jd9613_panel_t *jd9613, size_t pixels)
+{
+    if (pixels <= jd9613->frame_buffer_pixels)
     {
-        _x += 2;
-        _xe += 2;
+        return ESP_OK;
     }
 
+    heap_caps_free(jd9613->frame_buffer);
+    jd9613->frame_buffer = (uint16_t *)heap_caps_aligned_alloc(16, pixels * sizeof(uint16_t), MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+    jd9613->frame_buffer_pixels = jd9613->frame_buffer ? pixels : 0;
+    ESP_RETURN_ON_FALSE(jd9613->frame_buffer, ESP_ERR_NO_MEM, TAG, "no mem for frame buffer");
+    return ESP_OK;
+}
+
+// x_end and y_end are exclusive, the area can be any part of the panel
+static esp_err_t panel_jd9613_draw_bitmap(esp_lcd_panel_t *panel, int x_start, int y_start, int x_end, int y_end, const void *color_data)
+{
+    jd9613_panel_t *jd9613 = __containerof(panel, jd9613_panel_t, base);
+    assert((x_start < x_end) && (y_start < y_end) && "start position must be smaller than end position");
+    esp_lcd_panel_io_handle_t io = jd9613->io;
+
+    uint32_t width = x_end - x_start;
+    uint32_t height = y_end - y_start;
+    size_t pixels = width * height;
+
+    jd9613_window_t win;
+    jd9613_flush_window(jd9613->rotation, jd9613->x_gap, jd9613->y_gap, x_start, y_start, x_end, y_end, &win);
+
     // define an area of frame memory where MCU can access
+    // Parameter transfers wait for queued color transfers, so frame_buffer is free again afterwards
     ESP_RETURN_ON_ERROR(esp_lcd_panel_io_tx_param(io, LCD_CMD_CASET, (uint8_t[]){
-                                                                         (_x >> 8) & 0xFF,
-                                                                         _x & 0xFF,
-                                                                         ((_xe - 1) >> 8) & 0xFF,
-                                                                         (_xe - 1) & 0xFF,
+                                                                         (win.x >> 8) & 0xFF,
+                                                                         win.x & 0xFF,
+                                                                         ((win.xe - 1) >> 8) & 0xFF,
+                                                                         (win.xe - 1) & 0xFF,
                                                                      },
                                                   4),
                         TAG, "send command failed");
     ESP_RETURN_ON_ERROR(esp_lcd_panel_io_tx_param(io, LCD_CMD_RASET, (uint8_t[]){
-                                                                         (_y >> 8) & 0xFF,
-                                                                         _y & 0xFF,
-                                                                         ((_ye - 1) >> 8) & 0xFF,
-                                                                         (_ye - 1) & 0xFF,
+                                                                         (win.y >> 8) & 0xFF,
+                                                                         win.y & 0xFF,
+                                                                         ((win.ye - 1) >> 8) & 0xFF,
+                                                                         (win.ye - 1) & 0xFF,
                                                                      },
                                                   4),
                         TAG, "send command failed");
 
+    const uint16_t *pdat = (const uint16_t *)color_data;
+    bool sw_rotation = (jd9613->rotation == 1 || jd9613->rotation == 3);
+    bool swap = (jd9613->byte_order == JD9613_BYTE_ORDER_SWAP);
+
+    // Pixels LVGL already rendered big endian go out straight from its draw buffer
+    if (!swap && !sw_rotation)
+    {
+        esp_lcd_panel_io_tx_color(io, LCD_CMD_RAMWR, pdat, pixels * sizeof(uint16_t));
+        return ESP_OK;
+    }
+
+    ESP_RETURN_ON_ERROR(reserve_frame_buffer(jd9613, pixels), TAG, "reserve frame buffer failed");
+
     if (sw_rotation)
     {
         int index = 0;
-        uint16_t *pdat = (uint16_t *)color_data;
         for (uint16_t j = 0; j < width; j++)
         {
             for (uint16_t i = 0; i < height; i++)
             {
-                jd9613->frame_buffer[index++] = pdat[width * (height - i - 1) + j];
+                uint16_t pixel = pdat[width * (height - i - 1) + j];
+                jd9613->frame_buffer[index++] = swap ? __builtin_bswap16(pixel) : pixel;
             }
         }
-        data_ptr = jd9613->frame_buffer;
     }
-    esp_lcd_panel_io_tx_color(io, LCD_CMD_RAMWR, data_ptr, write_colors_bytes);
+    else
+    {
+        rgb565_swap_copy(jd9613, pdat, jd9613->frame_buffer, pixels);
+    }
+
+    esp_lcd_panel_io_tx_color(io, LCD_CMD_RAMWR, jd9613->frame_buffer, pixels * sizeof(uint16_t));
+    return ESP_OK;
+}
+
+// Only part of the panel is visible through the glass. With a gap the LVGL display can be registered
+// with just that window and every flush lands at the matching offset in panel RAM.
+static esp_err_t panel_jd9613_set_gap(esp_lcd_panel_t *panel, int x_gap, int y_gap)
+{
+    jd9613_panel_t *jd9613 = __containerof(panel, jd9613_panel_t, base);
+    jd9613->x_gap = x_gap;
+    jd9613->y_gap = y_gap;
+    return ESP_OK;
+}
+
+// Writes black to the whole panel RAM, so the part outside the visible window stays dark without ever being redrawn.
+// A short stripe is repeated, so the DMA buffer does not grow past what the flushes need.
+static esp_err_t panel_jd9613_clear(jd9613_panel_t *jd9613)
+{
+    const int lines = JD9613_CLEAR_LINES;
+    ESP_RETURN_ON_ERROR(reserve_frame_buffer(jd9613, JD9613_WIDTH * lines), TAG, "reserve frame buffer failed");
+    memset(jd9613->frame_buffer, 0, JD9613_WIDTH * lines * sizeof(uint16_t));
+
+    for (int y = 0; y < JD9613_HEIGHT; y += lines)
+    {
+        uint16_t xe = JD9613_WIDTH - 1;
+        uint16_t ye = y + lines - 1;
+        ESP_RETURN_ON_ERROR(esp_lcd_panel_io_tx_param(jd9613->io, LCD_CMD_CASET, (uint8_t[]){0, 0, (xe >> 8) & 0xFF, xe & 0xFF}, 4),
+                            TAG, "send command failed");
+        ESP_RETURN_ON_ERROR(esp_lcd_panel_io_tx_param(jd9613->io, LCD_CMD_RASET, (uint8_t[]){(y >> 8) & 0xFF, y & 0xFF, (ye >> 8) & 0xFF, ye & 0xFF}, 4),
+                            TAG, "send command failed");
+        ESP_RETURN_ON_ERROR(esp_lcd_panel_io_tx_color(jd9613->io, LCD_CMD_RAMWR, jd9613->frame_buffer, JD9613_WIDTH * lines * sizeof(uint16_t)),
+                            TAG, "send color failed");
+    }
     return ESP_OK;
 }
 
+void panel_jd9613_set_byte_order(esp_lcd_panel_t *panel, jd9613_byte_order_t order)
+{
+    jd9613_panel_t *jd9613 = __containerof(panel, jd9613_panel_t, base);
+    jd9613->byte_order = order;
+    ESP_LOGI(TAG, "byte order: %s", order == JD9613_BYTE_ORDER_NATIVE ? "native (no swap)" : "swapped by driver");
+}
+
+jd9613_byte_order_t panel_jd9613_get_byte_order(esp_lcd_panel_t *panel)
+{
+    jd9613_panel_t *jd9613 = __containerof(panel, jd9613_panel_t, base);
+    return jd9613->byte_order;
+}
+
+void panel_jd9613_get_swap_stats(esp_lcd_panel_t *panel, jd9613_swap_stats_t *stats)
+{
+    jd9613_panel_t *jd9613 = __containerof(panel, jd9613_panel_t, base);
+    *stats = jd9613->swap_stats;
+}
+
 esp_err_t esp_lcd_new_panel_jd9613(const esp_lcd_panel_io_handle_t io, const esp_lcd_panel_dev_config_t *panel_dev_config, esp_lcd_panel_handle_t *ret_panel)
 {
     esp_err_t ret = ESP_OK;
@@ -264,13 +414,6 @@ esp_err_t esp_lcd_new_panel_jd9613(const esp_lcd_panel_io_handle_t io, const esp
 
     ESP_GOTO_ON_FALSE(jd9613, ESP_ERR_NO_MEM, err, TAG, "no mem for jd9613 panel");
 
-    jd9613->frame_buffer = (uint16_t *)heap_caps_malloc(JD9613_WIDTH * JD9613_HEIGHT * 2, MALLOC_CAP_DMA);
-    if (!jd9613->frame_buffer)
-    {
-        free(jd9613);
-        return ESP_FAIL;
-    }
-
     if (panel_dev_config->reset_gpio_num >= 0)
     {
         io_conf.mode = GPIO_MODE_OUTPUT;
@@ -297,10 +440,10 @@ esp_err_t esp_lcd_new_panel_jd9613(const esp_lcd_panel_io_handle_t io, const esp
     jd9613->base.init = panel_jd9613_init;
     jd9613->base.draw_bitmap = panel_jd9613_draw_bitmap;
     jd9613->base.invert_color = NULL;
-    jd9613->base.set_gap = NULL;
+    jd9613->base.set_gap = panel_jd9613_set_gap;
     jd9613->base.mirror = NULL;
     jd9613->base.swap_xy = NULL;
-    jd9613->base.disp_on_off = NULL;
+    jd9613->base.disp_on_off = panel_jd9613_disp_on_off;
 
     *ret_panel = &(jd9613->base);
     ESP_LOGI(TAG, "new jd9613 panel @%p", jd9613);
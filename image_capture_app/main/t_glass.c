@@ -1,8 +1,12 @@
 #include "t_glass.h"
+#include "freertos/FreeRTOS.h"
 #include "touch_element/touch_button.h"
 #include "battery_measurement.h"
+#include "image_receiver.h"
 #include "esp_timer.h" // For getting timestamps
 #include "esp_log.h"
+#include <inttypes.h>
+#include <stdlib.h>
 #include <string.h>
 
 #define TOUCH_BUTTON_NUM 1
@@ -26,9 +30,28 @@ lv_obj_t *battery_label;
 lv_obj_t *ble_label;
 
 static lv_obj_t *canvas;
-static lv_color_t *canvas_buf;
+static uint16_t *canvas_buf;    // Front buffer, one of the image receiver's frame buffers once a frame arrived
 static lv_image_dsc_t img_dsc;
 
+// Commands posted from the BLE stack and the image display task, applied by ui_command_timer_fn() on the
+// LVGL task so producers never wait for the LVGL lock. A newer frame supersedes the one still pending and
+// any tiles queued before it; tiles queued after a frame are patched on top of it in order.
+#define UI_COMMAND_PERIOD_MS 20
+
+typedef struct
+{
+    uint8_t *buffer;    // Whole TILES payload
+    uint16_t count;
+} ui_tiles_t;
+
+static portMUX_TYPE ui_command_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint8_t *pending_frame = NULL;
+static ui_tiles_t pending_tiles[IMAGE_RX_FRAME_COUNT];
+static int pending_tile_count = 0;
+static int pending_ble_status = -1; // -1 if unchanged
+static ui_command_stats_t ui_stats;
+static void ui_command_timer_fn(lv_timer_t *timer);
+
 static bool first_press = true;
 
 static int64_t last_call_time = 0; // Stores the timestamp of the last call
@@ -60,6 +83,141 @@ static const float channel_sens_array[TOUCH_BUTTON_NUM] = {
 esp_lcd_panel_io_handle_t io_handle = NULL;
 esp_lcd_panel_handle_t panel_handle = NULL;
 
+#define DISPLAY_STATS_INTERVAL_S 10
+#define BATTERY_HYSTERESIS_MV 20 // Two steps of the last digit shown
+
+// Refresh timing, only touched from the LVGL task
+static int64_t refr_start_time;
+static bool refr_rendered;
+static uint32_t refr_count;
+static int64_t refr_total_us;
+static int64_t refr_max_us;
+static uint32_t refr_idle;          // Refreshes that found nothing invalidated
+static uint32_t label_updates;      // Status label texts that changed and were redrawn
+static uint32_t label_skips;        // Status label texts that were already on screen
+
+// Per-flush timing. flush_start_time is written by the LVGL task, the histograms by the SPI done ISR and the LVGL task.
+static volatile int64_t flush_start_time;
+static volatile int64_t wait_start_time;
+static volatile uint32_t flush_busy_us; // SPI transfer time since the last stats report
+static display_flush_stats_t flush_stats;
+
+static int flush_hist_bucket(int64_t us)
+{
+    int bucket = 0;
+    for (int64_t limit = DISPLAY_FLUSH_HIST_BASE_US; us >= limit && bucket < DISPLAY_FLUSH_HIST_BUCKETS - 1; limit <<= 1)
+    {
+        bucket++;
+    }
+    return bucket;
+}
+
+// Runs in the SPI interrupt once the last color transfer of a flush left the DMA, the draw buffer is free again
+static bool display_flush_done_cb(esp_lcd_panel_io_handle_t io, esp_lcd_panel_io_event_data_t *edata, void *user_ctx)
+{
+    int64_t elapsed = esp_timer_get_time() - flush_start_time;
+    flush_stats.flush_hist[flush_hist_bucket(elapsed)]++;
+    flush_busy_us += elapsed;
+    lv_display_flush_ready((lv_display_t *)user_ctx);
+    return false;
+}
+
+// FLUSH_START: the area was handed to the driver. FLUSH_WAIT_*: LVGL has nothing left to render and blocks on
+// the transfer, so a short wait histogram means rendering and SPI overlap well.
+static void display_flush_event_cb(lv_event_t *e)
+{
+    switch (lv_event_get_code(e))
+    {
+    case LV_EVENT_FLUSH_START:
+        flush_start_time = esp_timer_get_time();
+        flush_stats.flushes++;
+        break;
+    case LV_EVENT_FLUSH_WAIT_START:
+        wait_start_time = esp_timer_get_time();
+        break;
+    default: // LV_EVENT_FLUSH_WAIT_FINISH
+        flush_stats.wait_hist[flush_hist_bucket(esp_timer_get_time() - wait_start_time)]++;
+        break;
+    }
+}
+
+void display_get_flush_stats(display_flush_stats_t *stats)
+{
+    *stats = flush_stats;
+}
+
+static void display_refr_event_cb(lv_event_t *e)
+{
+    switch (lv_event_get_code(e))
+    {
+    case LV_EVENT_REFR_START:
+        refr_start_time = esp_timer_get_time();
+        refr_rendered = false;
+        break;
+    case LV_EVENT_RENDER_START:
+        refr_rendered = true;
+        break;
+    default: // LV_EVENT_REFR_READY, idle refreshes that rendered nothing are not counted
+        if (refr_rendered)
+        {
+            int64_t elapsed = esp_timer_get_time() - refr_start_time;
+            refr_count++;
+            refr_total_us += elapsed;
+            if (elapsed > refr_max_us)
+                refr_max_us = elapsed;
+        }
+        else
+        {
+            refr_idle++;
+        }
+        break;
+    }
+}
+
+// Frame time and the CPU the byte-order conversion costs, compare a build with and without native byte order
+static void log_display_stats(void)
+{
+    jd9613_swap_stats_t swap;
+    panel_jd9613_get_swap_stats(panel_handle, &swap);
+    uint64_t swap_cycles = swap.simd_cycles + swap.scalar_cycles;
+
+    ESP_LOGI(TAG, "Display: %" PRIu32 " frames, avg %" PRId64 " us, max %" PRId64 " us, byte order: %s, swap %" PRIu64 " cycles/frame (simd %.2f, scalar %.2f cycles/px)",
+             refr_count, refr_count ? refr_total_us / refr_count : 0, refr_max_us,
+             panel_jd9613_get_byte_order(panel_handle) == JD9613_BYTE_ORDER_NATIVE ? "native" : "swapped",
+             refr_count ? swap_cycles / refr_count : 0,
+             swap.simd_pixels ? (double)swap.simd_cycles / swap.simd_pixels : 0.0,
+             swap.scalar_pixels ? (double)swap.scalar_cycles / swap.scalar_pixels : 0.0);
+
+    // Share of the interval spent rendering and sending pixels, both drop to zero while nothing changes
+    const int64_t interval_us = DISPLAY_STATS_INTERVAL_S * 1000000LL;
+    ESP_LOGI(TAG, "Idle: %" PRIu32 " refreshes with nothing to draw, render duty %.1f%%, SPI duty %.1f%%, status labels: %" PRIu32 " redrawn, %" PRIu32 " unchanged",
+             refr_idle, 100.0 * refr_total_us / interval_us, 100.0 * flush_busy_us / interval_us, label_updates, label_skips);
+
+    refr_count = 0;
+    refr_total_us = 0;
+    refr_max_us = 0;
+    refr_idle = 0;
+    flush_busy_us = 0;
+    label_updates = 0;
+    label_skips = 0;
+
+    char flush_line[DISPLAY_FLUSH_HIST_BUCKETS * 11 + 1];
+    char wait_line[DISPLAY_FLUSH_HIST_BUCKETS * 11 + 1];
+    int flush_len = 0, wait_len = 0;
+    for (int i = 0; i < DISPLAY_FLUSH_HIST_BUCKETS; i++)
+    {
+        flush_len += snprintf(&flush_line[flush_len], sizeof(flush_line) - flush_len, " %" PRIu32, flush_stats.flush_hist[i]);
+        wait_len += snprintf(&wait_line[wait_len], sizeof(wait_line) - wait_len, " %" PRIu32, flush_stats.wait_hist[i]);
+    }
+    ESP_LOGI(TAG, "Flushes: %" PRIu32 ", duration histogram (from %d us, x2 per bucket):%s, render blocked:%s",
+             flush_stats.flushes, DISPLAY_FLUSH_HIST_BASE_US, flush_line, wait_line);
+
+    ui_command_stats_t commands;
+    lv_gui_get_command_stats(&commands);
+    ESP_LOGI(TAG, "UI commands: %" PRIu32 " frames, %" PRIu32 " tile sets, %" PRIu32 " coalesced",
+             commands.frames_posted, commands.tiles_posted, commands.coalesced);
+}
+
 esp_err_t initialize_spi_bus()
 {
     ESP_LOGI(TAG, "Initialize SPI bus");
@@ -70,7 +228,7 @@ esp_err_t initialize_spi_bus()
         .quadwp_io_num = BOARD_NONE_PIN,
         .quadhd_io_num = BOARD_NONE_PIN,
         //.max_transfer_sz = JD9613_HEIGHT * 80 * sizeof(uint16_t),
-        .max_transfer_sz = JD9613_WIDTH * JD9613_HEIGHT * 2,
+        .max_transfer_sz = GlassViewableWidth * LCD_DRAW_BUFF_HEIGHT * sizeof(uint16_t),
         .data4_io_num = 0,
         .data5_io_num = 0,
         .data6_io_num = 0,
@@ -94,7 +252,7 @@ esp_err_t initialize_panel_io()
         .lcd_param_bits = 8,
         .spi_mode = 0,
         .trans_queue_depth = 10,
-        .on_color_trans_done = NULL,
+        .on_color_trans_done = NULL, // Registered once the LVGL display exists, see initialize_panel_jd9613()
         .user_ctx = NULL,
         .flags.dc_low_on_data = 0,
         .flags.octal_mode = 0,
@@ -107,6 +265,28 @@ esp_err_t initialize_panel_io()
     return esp_lcd_new_panel_io_spi((esp_lcd_spi_bus_handle_t)BOARD_DISP_HOST, &io_config, &io_handle);
 }
 
+// Panel power and brightness are changed through these two, so the battery load estimate follows them
+static bool display_on = false;
+static uint8_t display_brightness = 0;
+
+void display_set_brightness(uint8_t level)
+{
+    setBrightness(panel_handle, level);
+    display_brightness = level;
+    battery_set_display_load(display_on, level);
+}
+
+esp_err_t display_set_power(bool on)
+{
+    esp_err_t ret = esp_lcd_panel_disp_on_off(panel_handle, on);
+    if (ret == ESP_OK)
+    {
+        display_on = on;
+        battery_set_display_load(on, display_brightness);
+    }
+    return ret;
+}
+
 esp_err_t initialize_panel_jd9613()
 {
     ESP_ERROR_CHECK(initialize_spi_bus());
@@ -123,17 +303,25 @@ esp_err_t initialize_panel_jd9613()
     ESP_ERROR_CHECK(esp_lcd_panel_reset(panel_handle));
     ESP_ERROR_CHECK(esp_lcd_panel_init(panel_handle));
 
-    setBrightness(panel_handle, 255);
+    // The init sequence ends with the panel switched on
+    display_on = true;
+    display_set_brightness(255);
+
+    // Only the bottom 126x126 of the panel is visible through the glass, the rest was blanked by the
+    // panel init. LVGL renders just that window and the driver places it in panel RAM.
+    ESP_ERROR_CHECK(esp_lcd_panel_set_gap(panel_handle, 0, GlassViewable_X_Offset));
 
     /* Add LCD screen */
+    // Only invalidated areas are rendered, stripe by stripe. With two DMA-capable stripes in internal RAM
+    // LVGL renders the next one while the previous is still being sent to the panel.
     ESP_LOGI(TAG, "Add LCD screen");
     const lvgl_port_display_cfg_t disp_cfg = {
         .io_handle = io_handle,
         .panel_handle = panel_handle,
-        .buffer_size = JD9613_WIDTH * JD9613_HEIGHT,
-        .double_buffer = false,
-        .hres = JD9613_WIDTH,
-        .vres = JD9613_HEIGHT,
+        .buffer_size = GlassViewableWidth * LCD_DRAW_BUFF_HEIGHT,
+        .double_buffer = true,
+        .hres = GlassViewableWidth,
+        .vres = GlassViewableHeight,
         .monochrome = false,
         .rotation = {
             .swap_xy = false,
@@ -141,11 +329,11 @@ esp_err_t initialize_panel_jd9613()
             .mirror_y = false,
         },
         .flags = {
-            .buff_dma = false,
+            .buff_dma = true,
             .buff_spiram = false,
             .sw_rotate = true,
             .swap_bytes = false,
-            .full_refresh = true,
+            .full_refresh = false,
             .direct_mode = false,
         }};
 
@@ -155,6 +343,25 @@ esp_err_t initialize_panel_jd9613()
 
     if (disp)
     {
+        lvgl_port_lock(0);
+#if LV_VERSION_CHECK(9, 3, 0)
+        // LVGL renders big endian RGB565 itself, the driver sends its draw buffers untouched
+        lv_display_set_color_format(disp, LV_COLOR_FORMAT_RGB565_SWAPPED);
+        panel_jd9613_set_byte_order(panel_handle, JD9613_BYTE_ORDER_NATIVE);
+#endif
+        // Flushes complete from the SPI DMA done interrupt, LVGL renders the next stripe meanwhile
+        const esp_lcd_panel_io_callbacks_t cbs = {
+            .on_color_trans_done = display_flush_done_cb,
+        };
+        esp_lcd_panel_io_register_event_callbacks(io_handle, &cbs, disp);
+        lv_display_add_event_cb(disp, display_flush_event_cb, LV_EVENT_FLUSH_START, NULL);
+        lv_display_add_event_cb(disp, display_flush_event_cb, LV_EVENT_FLUSH_WAIT_START, NULL);
+        lv_display_add_event_cb(disp, display_flush_event_cb, LV_EVENT_FLUSH_WAIT_FINISH, NULL);
+
+        lv_display_add_event_cb(disp, display_refr_event_cb, LV_EVENT_REFR_START, NULL);
+        lv_display_add_event_cb(disp, display_refr_event_cb, LV_EVENT_RENDER_START, NULL);
+        lv_display_add_event_cb(disp, display_refr_event_cb, LV_EVENT_REFR_READY, NULL);
+        lvgl_port_unlock();
         return ESP_OK;
     }
 
@@ -266,21 +473,21 @@ void base_view(lv_obj_t *parent)
     lvgl_port_unlock();
 }
 
-const char *get_battery_icon(float voltage)
+const char *get_battery_icon(int percentage)
 {
-    if (voltage >= 4.0)
+    if (percentage >= 90)
     {
         return LV_SYMBOL_BATTERY_FULL; // Full battery
     }
-    else if (voltage >= 3.85)
+    else if (percentage >= 75)
     {
         return LV_SYMBOL_BATTERY_3; // 3 bars
     }
-    else if (voltage >= 3.70)
+    else if (percentage >= 50)
     {
         return LV_SYMBOL_BATTERY_2; // 2 bars
     }
-    else if (voltage >= 3.50)
+    else if (percentage >= 10)
     {
         return LV_SYMBOL_BATTERY_1; // 1 bar
     }
@@ -290,24 +497,54 @@ const char *get_battery_icon(float voltage)
     }
 }
 
+// Sets the text only if the label shows something else, an unchanged label is not invalidated
+static void label_set_text_if_changed(lv_obj_t *label, const char *text)
+{
+    if (strcmp(lv_label_get_text(label), text) == 0)
+    {
+        label_skips++;
+        return;
+    }
+    lv_label_set_text(label, text);
+    label_updates++;
+}
+
+// Runs on the LVGL task, which already holds the LVGL lock
 void sys_timer_fn(lv_timer_t *timer)
 {
-    lvgl_port_lock(0);
-    float battery_voltage = battery_measurement_read();
-    // Convert voltage to percentage
-    int battery_percentage = battery_voltage_to_percentage(battery_voltage);
-    // ESP_LOGI(TAG, "Battery Voltage: %.2f V, Battery Percentage: %d%%\n", battery_voltage, battery_percentage);
-
-    char battery_info[100];
-    snprintf(battery_info, sizeof(battery_info), "%.2fV, %d%% %s", battery_voltage, battery_percentage, get_battery_icon(battery_voltage));
-    lv_label_set_text(battery_label, battery_info);
-    lvgl_port_unlock();
+    // The sampler filters the readings already, the shown voltage only follows once the battery really moved.
+    // The percentage also moves with the load compensation, which the voltage does not show.
+    static int shown_mv = -1;
+    static int shown_percentage = -1;
+    battery_snapshot_t battery;
+    if (battery_measurement_get(&battery) &&
+        (shown_mv < 0 || abs(battery.voltage_mv - shown_mv) >= BATTERY_HYSTERESIS_MV || battery.percentage != shown_percentage))
+    {
+        shown_mv = battery.voltage_mv;
+        shown_percentage = battery.percentage;
+        int centivolts = (shown_mv + 5) / 10;
+
+        char battery_info[100];
+        snprintf(battery_info, sizeof(battery_info), "%d.%02dV, %d%% %s", centivolts / 100, centivolts % 100, battery.percentage, get_battery_icon(battery.percentage));
+        label_set_text_if_changed(battery_label, battery_info);
+    }
+    else
+    {
+        label_skips++;
+    }
+
+    static int stats_ticks = 0;
+    if (++stats_ticks >= DISPLAY_STATS_INTERVAL_S)
+    {
+        stats_ticks = 0;
+        log_display_stats();
+    }
 }
 
 void create_lv_canvas(lv_obj_t *parent)
 {
-    // Allocate buffer in PSRAM for RGB565 format
-    canvas_buf = (lv_color_t *)heap_caps_malloc(GlassViewableWidth * GlassViewableHeight * sizeof(lv_color_t), MALLOC_CAP_SPIRAM);
+    // Allocate buffer in PSRAM for RGB565 format, black until the first image arrives
+    canvas_buf = (uint16_t *)heap_caps_calloc(1, IMAGE_MAX_SIZE, MALLOC_CAP_SPIRAM);
 
     if (!canvas_buf)
     {
@@ -319,7 +556,7 @@ void create_lv_canvas(lv_obj_t *parent)
     img_dsc.header.w = GlassViewableWidth;
     img_dsc.header.h = GlassViewableHeight;
     img_dsc.data = (const uint8_t *)canvas_buf;
-    img_dsc.data_size = GlassViewableWidth * GlassViewableHeight * sizeof(lv_color_t);
+    img_dsc.data_size = IMAGE_MAX_SIZE;
 
     // Create LVGL canvas
     canvas = lv_image_create(parent);
@@ -366,6 +603,7 @@ esp_err_t init_tglass()
 
     base_view(base_ui);
     base_timer = lv_timer_create(sys_timer_fn, 1000, NULL);
+    lv_timer_create(ui_command_timer_fn, UI_COMMAND_PERIOD_MS, NULL);
 
     lvgl_port_unlock();
     return ESP_OK;
@@ -373,23 +611,159 @@ esp_err_t init_tglass()
 
 void lv_gui_ble_status(bool isOn)
 {
-    lvgl_port_lock(0);
-    lv_obj_set_style_text_color(ble_label, isOn ? lv_palette_main(LV_PALETTE_BLUE) : font_color, 0);
-    lvgl_port_unlock();
+    portENTER_CRITICAL(&ui_command_lock);
+    if (pending_ble_status >= 0)
+    {
+        ui_stats.coalesced++;
+    }
+    pending_ble_status = isOn;
+    portEXIT_CRITICAL(&ui_command_lock);
 }
 
+void lv_gui_post_frame(uint8_t *frame)
+{
+    uint8_t *superseded[1 + IMAGE_RX_FRAME_COUNT];
+    int superseded_count = 0;
 
-void update_canvas_with_rgb565(uint8_t *data, size_t len)
+    portENTER_CRITICAL(&ui_command_lock);
+    if (pending_frame)
+    {
+        superseded[superseded_count++] = pending_frame;
+    }
+    for (int i = 0; i < pending_tile_count; i++)
+    {
+        superseded[superseded_count++] = pending_tiles[i].buffer;
+    }
+    pending_frame = frame;
+    pending_tile_count = 0;
+    ui_stats.frames_posted++;
+    ui_stats.coalesced += superseded_count;
+    portEXIT_CRITICAL(&ui_command_lock);
+
+    // Never shown, straight back to the receiver
+    for (int i = 0; i < superseded_count; i++)
+    {
+        image_receiver_release_frame(superseded[i]);
+    }
+}
+
+void lv_gui_post_tiles(uint8_t *buffer, uint16_t count)
 {
-    if (!canvas_buf)
-        return;
-    lvgl_port_lock(0);
-    memcpy(canvas_buf, data, len); // Copy BLE image data into the buffer
+    bool queued = false;
 
-    // Update the image descriptor with new data
-    img_dsc.data = (const uint8_t *)canvas_buf;
+    portENTER_CRITICAL(&ui_command_lock);
+    // Every frame buffer but the one on screen fits, a full slot list would mean a lost buffer
+    if (pending_tile_count < IMAGE_RX_FRAME_COUNT)
+    {
+        pending_tiles[pending_tile_count].buffer = buffer;
+        pending_tiles[pending_tile_count].count = count;
+        pending_tile_count++;
+        ui_stats.tiles_posted++;
+        queued = true;
+    }
+    portEXIT_CRITICAL(&ui_command_lock);
 
-    // Refresh LVGL object
+    if (!queued)
+    {
+        image_receiver_release_frame(buffer);
+    }
+}
+
+void lv_gui_get_command_stats(ui_command_stats_t *stats)
+{
+    portENTER_CRITICAL(&ui_command_lock);
+    *stats = ui_stats;
+    portEXIT_CRITICAL(&ui_command_lock);
+}
+
+// Only the pointer changes hands, LVGL reads the new buffer on its next refresh. Returns the buffer that was on screen.
+static uint8_t *show_canvas_frame(uint8_t *frame)
+{
+    uint8_t *previous = (uint8_t *)canvas_buf;
+    canvas_buf = (uint16_t *)frame;
+    img_dsc.data = frame;
+    lv_image_cache_drop(&img_dsc);
     lv_obj_invalidate(canvas);
-    lvgl_port_unlock();
-}
\ No newline at end of file
+    return previous;
+}
+
+// Patches tile records into the canvas and redraws only those areas
+static void patch_canvas_tiles(const uint8_t *tiles, uint16_t count)
+{
+    // Bounding columns touched in each tile row, invalidated as one area per row
+    uint8_t row_min[IMAGE_TILE_ROWS];
+    uint8_t row_max[IMAGE_TILE_ROWS];
+    memset(row_min, 0xFF, sizeof(row_min));
+    memset(row_max, 0, sizeof(row_max));
+
+    uint16_t *pixels = canvas_buf;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint8_t tx = *tiles++;
+        uint8_t ty = *tiles++;
+        size_t w = image_tile_span(tx, GlassViewableWidth);
+        size_t h = image_tile_span(ty, GlassViewableHeight);
+
+        uint16_t *dst = &pixels[ty * IMAGE_TILE_SIZE * GlassViewableWidth + tx * IMAGE_TILE_SIZE];
+        for (size_t y = 0; y < h; y++)
+        {
+            memcpy(dst, tiles, w * sizeof(uint16_t));
+            dst += GlassViewableWidth;
+            tiles += w * sizeof(uint16_t);
+        }
+
+        if (tx < row_min[ty])
+            row_min[ty] = tx;
+        if (tx > row_max[ty])
+            row_max[ty] = tx;
+    }
+
+    // Invalidation works in screen coordinates
+    lv_area_t coords;
+    lv_obj_get_coords(canvas, &coords);
+    for (int ty = 0; ty < IMAGE_TILE_ROWS; ty++)
+    {
+        if (row_min[ty] > row_max[ty])
+            continue;
+        lv_area_t area = {
+            .x1 = coords.x1 + row_min[ty] * IMAGE_TILE_SIZE,
+            .y1 = coords.y1 + ty * IMAGE_TILE_SIZE,
+            .x2 = coords.x1 + row_max[ty] * IMAGE_TILE_SIZE + image_tile_span(row_max[ty], GlassViewableWidth) - 1,
+            .y2 = coords.y1 + ty * IMAGE_TILE_SIZE + image_tile_span(ty, GlassViewableHeight) - 1,
+        };
+        lv_obj_invalidate_area(canvas, &area);
+    }
+}
+
+// Runs on the LVGL task, which already holds the LVGL lock
+static void ui_command_timer_fn(lv_timer_t *timer)
+{
+    portENTER_CRITICAL(&ui_command_lock);
+    uint8_t *frame = pending_frame;
+    ui_tiles_t tiles[IMAGE_RX_FRAME_COUNT];
+    int tile_count = pending_tile_count;
+    memcpy(tiles, pending_tiles, tile_count * sizeof(tiles[0]));
+    int ble_status = pending_ble_status;
+    pending_frame = NULL;
+    pending_tile_count = 0;
+    pending_ble_status = -1;
+    portEXIT_CRITICAL(&ui_command_lock);
+
+    if (ble_status >= 0)
+    {
+        lv_obj_set_style_text_color(ble_label, ble_status ? lv_palette_main(LV_PALETTE_BLUE) : font_color, 0);
+    }
+
+    if (frame)
+    {
+        image_receiver_release_frame(canvas_buf ? show_canvas_frame(frame) : frame);
+    }
+    for (int i = 0; i < tile_count; i++)
+    {
+        if (canvas_buf)
+        {
+            patch_canvas_tiles(&tiles[i].buffer[IMAGE_TILES_HEADER_LEN], tiles[i].count);
+        }
+        image_receiver_release_frame(tiles[i].buffer);
+    }
+}
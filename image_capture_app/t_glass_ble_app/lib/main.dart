@@ -57,6 +57,31 @@ class _MyAppState extends State<MyApp> {
   final String charUUID = "ff01";
   final int desiredMtu = 215;   // [[[You need to check the set MTU size.]]]
 
+  // Image transfer framing, must match image_receiver.h on the T-Glass
+  static const int packetHeaderLength = 6;
+  static const int flagQuery = 0x80;
+  static const int encodingRaw = 0;
+  static const int encodingQ565 = 1;
+  static const int encodingTiles = 2;
+  static const int statusComplete = 0;
+  static const int statusMissing = 1;
+  static const int statusRejected = 3;
+  static const int statusBusy = 4;
+  static const int imageSide = 126;
+  static const int tileSize = 8;
+  static const int maxRetransmitRounds = 5;
+  static const Duration statusTimeout = Duration(seconds: 2);
+  static const Duration busyRetryDelay = Duration(milliseconds: 100);
+
+  int _frameId = 0;
+  int _supportedEncodings = 1 << encodingRaw;
+  StreamSubscription<List<int>>? _statusSubscription;
+  Completer<List<int>>? _statusCompleter;
+
+  // Last image the T-Glass confirmed, delta frames are computed against it
+  Uint8List? _ackedImage;
+  int _ackedFrameId = 0;
+
   String _targetDeviceName = ""; // Target device name entered by user
 
   final AppWindow _appWindow = AppWindow();
@@ -180,6 +205,102 @@ class _MyAppState extends State<MyApp> {
     return rgb565Data;
   }
 
+  /// Encode little endian RGB565 pixels as a Q565 stream (see image_codec.h on the T-Glass)
+  Uint8List encodeQ565(Uint8List rgb565Data) {
+    ByteData pixels = ByteData.sublistView(rgb565Data);
+    int pixelCount = rgb565Data.length ~/ 2;
+    BytesBuilder out = BytesBuilder(copy: false);
+    Uint16List index = Uint16List(64);
+    int prev = 0;
+    int run = 0;
+
+    for (int i = 0; i < pixelCount; i++) {
+      int p = pixels.getUint16(i * 2, Endian.little);
+
+      if (p == prev) {
+        run++;
+        if (run == 62 || i == pixelCount - 1) {
+          out.addByte(0xC0 | (run - 1));
+          run = 0;
+        }
+        continue;
+      }
+      if (run > 0) {
+        out.addByte(0xC0 | (run - 1));
+        run = 0;
+      }
+
+      int r = (p >> 11) & 0x1F, g = (p >> 5) & 0x3F, b = p & 0x1F;
+      int hash = (r * 3 + g * 5 + b * 7) % 64;
+
+      if (index[hash] == p) {
+        out.addByte(hash);
+      } else {
+        int dr = ((r - ((prev >> 11) & 0x1F) + 16) & 0x1F) - 16;
+        int dg = ((g - ((prev >> 5) & 0x3F) + 32) & 0x3F) - 32;
+        int db = ((b - (prev & 0x1F) + 16) & 0x1F) - 16;
+        int drDg = dr - (dg >> 1);
+        int dbDg = db - (dg >> 1);
+
+        if (dr >= -2 && dr <= 1 && dg >= -2 && dg <= 1 && db >= -2 && db <= 1) {
+          out.addByte(0x40 | ((dr + 2) << 4) | ((dg + 2) << 2) | (db + 2));
+        } else if (drDg >= -8 && drDg <= 7 && dbDg >= -8 && dbDg <= 7) {
+          out.addByte(0x80 | (dg + 32));
+          out.addByte(((drDg + 8) << 4) | (dbDg + 8));
+        } else {
+          out.add([0xFE, p & 0xFF, p >> 8]);
+        }
+      }
+      index[hash] = p;
+      prev = p;
+    }
+    return out.takeBytes();
+  }
+
+  /// Collect the 8x8 tiles that differ from the acknowledged image as a TILES payload
+  /// (see image_receiver.h on the T-Glass). Returns an empty list if nothing changed.
+  Uint8List encodeTiles(Uint8List current, Uint8List previous, int baseFrameId) {
+    const int tilesPerSide = (imageSide + tileSize - 1) ~/ tileSize;
+    BytesBuilder out = BytesBuilder(copy: false);
+    int tileCount = 0;
+
+    for (int ty = 0; ty < tilesPerSide; ty++) {
+      int y0 = ty * tileSize;
+      int h = (imageSide - y0 < tileSize) ? imageSide - y0 : tileSize;
+      for (int tx = 0; tx < tilesPerSide; tx++) {
+        int x0 = tx * tileSize;
+        int w = (imageSide - x0 < tileSize) ? imageSide - x0 : tileSize;
+
+        bool dirty = false;
+        for (int y = y0; y < y0 + h && !dirty; y++) {
+          int rowStart = (y * imageSide + x0) * 2;
+          for (int i = rowStart; i < rowStart + w * 2; i++) {
+            if (current[i] != previous[i]) {
+              dirty = true;
+              break;
+            }
+          }
+        }
+        if (!dirty) {
+          continue;
+        }
+
+        out.add([tx, ty]);
+        for (int y = y0; y < y0 + h; y++) {
+          int rowStart = (y * imageSide + x0) * 2;
+          out.add(current.sublist(rowStart, rowStart + w * 2));
+        }
+        tileCount++;
+      }
+    }
+
+    if (tileCount == 0) {
+      return Uint8List(0);
+    }
+    return Uint8List.fromList(
+        [baseFrameId, tileCount & 0xFF, tileCount >> 8, ...out.takeBytes()]);
+  }
+
   /// Function to send data chunk over BLE
   Future<void> _sendChunkToBLE(Uint8List chunk) async {
     // Replace with your actual BLE characteristic write function
@@ -188,13 +309,103 @@ class _MyAppState extends State<MyApp> {
       try {
         await _targetCharacteristic!.write(chunk,
             withoutResponse: true, allowLongWrite: false, timeout: 60);
-        debugPrint("Data written to characteristic.");
       } catch (e) {
         debugPrint("Failed to write data: $e");
       }
     }
   }
 
+  /// Prefix a payload with | FrameID | Flags | Offset | TotalLength |
+  Uint8List _buildPacket(
+      int frameId, int flags, int offset, int total, Uint8List payload) {
+    Uint8List packet = Uint8List(packetHeaderLength + payload.length);
+    ByteData header = ByteData.view(packet.buffer);
+    header.setUint8(0, frameId);
+    header.setUint8(1, flags);
+    header.setUint16(2, offset, Endian.little);
+    header.setUint16(4, total, Endian.little);
+    packet.setRange(packetHeaderLength, packet.length, payload);
+    return packet;
+  }
+
+  /// Send bytes [start, end) of a frame as offset-addressed chunks
+  Future<void> _sendFrameRange(
+      int frameId, int flags, Uint8List data, int start, int end) async {
+    int chunkSize = desiredMtu - packetHeaderLength;
+    for (int i = start; i < end; i += chunkSize) {
+      int chunkEnd = (i + chunkSize < end) ? i + chunkSize : end;
+      await _sendChunkToBLE(_buildPacket(
+          frameId, flags, i, data.length, data.sublist(i, chunkEnd)));
+    }
+  }
+
+  void _onStatusReceived(List<int> value) {
+    if (_statusCompleter != null && !_statusCompleter!.isCompleted) {
+      _statusCompleter!.complete(value);
+    }
+  }
+
+  /// Ask the T-Glass which parts of the frame are still missing
+  Future<List<int>?> _queryFrameStatus(
+      int frameId, int flags, int total) async {
+    _statusCompleter = Completer<List<int>>();
+    await _sendChunkToBLE(
+        _buildPacket(frameId, flags | flagQuery, 0, total, Uint8List(0)));
+    try {
+      List<int> status;
+      do {
+        status = await _statusCompleter!.future.timeout(statusTimeout);
+        // Skip notifications left over from an earlier frame
+        if (status.length >= 3 && status[0] == frameId) {
+          return status;
+        }
+        _statusCompleter = Completer<List<int>>();
+      } while (true);
+    } on TimeoutException {
+      return null;
+    }
+  }
+
+  /// Send a frame, then retransmit only the ranges the T-Glass reports missing
+  Future<bool> _sendFrame(Uint8List data, int flags) async {
+    _frameId = (_frameId + 1) & 0xFF;
+    int frameId = _frameId;
+
+    await _sendFrameRange(frameId, flags, data, 0, data.length);
+
+    for (int round = 0; round < maxRetransmitRounds; round++) {
+      List<int>? status = await _queryFrameStatus(frameId, flags, data.length);
+      if (status == null) {
+        debugPrint("No status for frame $frameId, asking again.");
+        continue;
+      }
+
+      if (status[1] == statusComplete) {
+        return true;
+      } else if (status[1] == statusRejected) {
+        debugPrint("Frame $frameId rejected by the device.");
+        return false;
+      } else if (status[1] == statusBusy) {
+        // Everything arrived, the device is waiting for a free frame buffer
+        debugPrint("Frame $frameId waiting for a frame buffer.");
+        await Future.delayed(busyRetryDelay);
+      } else if (status[1] == statusMissing) {
+        ByteData ranges = ByteData.sublistView(Uint8List.fromList(status));
+        int rangeCount = status[2];
+        debugPrint("Frame $frameId: resending $rangeCount missing ranges.");
+        for (int r = 0; r < rangeCount; r++) {
+          int offset = ranges.getUint16(3 + r * 4, Endian.little);
+          int length = ranges.getUint16(5 + r * 4, Endian.little);
+          await _sendFrameRange(frameId, flags, data, offset, offset + length);
+        }
+      } else {
+        debugPrint("Frame $frameId unknown to the device, resending it.");
+        await _sendFrameRange(frameId, flags, data, 0, data.length);
+      }
+    }
+    return false;
+  }
+
   void _sendImageOverBLE() async {
     if (_lastCapturedData == null || _lastCapturedData!.imagePath == null) {
       print("No image to send.");
@@ -208,19 +419,50 @@ class _MyAppState extends State<MyApp> {
       // Send over BLE or use for display
       print("RGB565 Data Length: ${rgb565Data.length}");
 
-      // Send in chunks (assuming BLE characteristic write method)
-      int chunkSize = desiredMtu; // Adjust based on BLE MTU size
-      for (int i = 0; i < rgb565Data.length; i += chunkSize) {
-        int end = (i + chunkSize < rgb565Data.length)
-            ? i + chunkSize
-            : rgb565Data.length;
-        Uint8List chunk = rgb565Data.sublist(i, end);
+      // Compress when the T-Glass supports it and it actually saves airtime
+      Uint8List payload = rgb565Data;
+      int encoding = encodingRaw;
+      if (_supportedEncodings & (1 << encodingQ565) != 0) {
+        Uint8List compressed = encodeQ565(rgb565Data);
+        if (compressed.length < rgb565Data.length) {
+          payload = compressed;
+          encoding = encodingQ565;
+        }
+      }
+      Uint8List fullPayload = payload;
+      int fullEncoding = encoding;
+
+      // Only send the tiles that changed since the last image the T-Glass confirmed
+      if (_ackedImage != null &&
+          _supportedEncodings & (1 << encodingTiles) != 0) {
+        Uint8List tiles = encodeTiles(rgb565Data, _ackedImage!, _ackedFrameId);
+        if (tiles.isEmpty) {
+          print("Image unchanged, nothing to send.");
+          return;
+        }
+        if (tiles.length < payload.length) {
+          payload = tiles;
+          encoding = encodingTiles;
+        }
+      }
+      print("Payload Length: ${payload.length} (encoding $encoding)");
 
-        // Send the chunk over BLE (example method, replace with your actual BLE library)
-        await _sendChunkToBLE(chunk);
+      bool sent = await _sendFrame(payload, encoding);
+      if (!sent && encoding == encodingTiles) {
+        // The device no longer shows the base image, start over with a full frame
+        print("Delta frame not applied, sending the full image.");
+        sent = await _sendFrame(fullPayload, fullEncoding);
       }
+      if (!sent) {
+        _ackedImage = null;
+        print("Image transfer incomplete.");
+        return;
+      }
+      _ackedImage = rgb565Data;
+      _ackedFrameId = _frameId;
     } catch (e) {
       print("Error: $e");
+      return;
     }
 
     print("Image sent over BLE successfully!");
@@ -229,6 +471,8 @@ class _MyAppState extends State<MyApp> {
   void _toggleScanOrDisconnect() async {
     if (_isConnected) {
       // Disconnect
+      await _statusSubscription?.cancel();
+      _statusSubscription = null;
       await _connectedDevice?.disconnect();
       debugPrint("Disconnected from device.");
 
@@ -302,6 +546,20 @@ class _MyAppState extends State<MyApp> {
                       _targetCharacteristic = characteristic;
                       debugPrint(
                           "Found target characteristic: ${characteristic.uuid.toString()}");
+
+                      // The characteristic value lists the payload encodings the device can decode
+                      List<int> capabilities = await characteristic.read();
+                      _supportedEncodings = capabilities.isNotEmpty
+                          ? capabilities[0]
+                          : 1 << encodingRaw;
+
+                      // Transfer status is reported through notifications
+                      _frameId = 0;
+                      _ackedImage = null;
+                      await _statusSubscription?.cancel();
+                      _statusSubscription = characteristic.onValueReceived
+                          .listen(_onStatusReceived);
+                      await characteristic.setNotifyValue(true);
                     }
                   }
                 }